@@ -0,0 +1,58 @@
+#ifndef ACTIVITY_SCHEDULER_H
+#define ACTIVITY_SCHEDULER_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Activity-driven sampling policy, one entry per active sampling slot.
+//
+// Each slot tracks an exponentially weighted mean and variance of its raw
+// conversions in integer counts; setScale() turns ADAPTIVE_ACTIVITY_KG into
+// counts squared when the bin's scale factor changes, so no float math runs
+// per conversion. A spread above it marks the bin active: it is read at
+// every conversion and asks the HX711s for the fast rate. After
+// ADAPTIVE_HOLD_MS without movement it drops back to idle and is read at
+// most every ADAPTIVE_IDLE_INTERVAL_MS. Raw input lets an idle bin wake on
+// the first read after a load change instead of waiting for the outlier
+// filter to accept the new level; a conversion that moves only counts once
+// the next one (read at once) agrees, so lone spikes wake nothing. Free of
+// Arduino dependencies so the policy runs unchanged in the native simulator.
+class ActivityScheduler {
+public:
+    ActivityScheduler();
+
+    // Start count slots (up to SENSOR_MAX_CHANNELS), all active so the
+    // first readings after boot or a change of the active set come quickly
+    void reset(int count, uint32_t nowMs);
+
+    // Derive the slot's threshold from its scale factor (counts per kg).
+    // Slots start at HX711_DEFAULT_SCALE_FACTOR
+    void setScale(int slot, float countsPerKg);
+
+    // Feed one raw conversion; returns true if the slot changed mode
+    bool observe(int slot, int32_t counts, uint32_t nowMs);
+
+    // Demote slots whose hold has run out; returns true if any changed
+    bool expire(uint32_t nowMs);
+
+    bool isActive(int slot) const { return (activeSlots & (1UL << slot)) != 0; }
+    uint32_t getActiveSlots() const { return activeSlots; }
+    bool wantsHighRate() const { return activeSlots != 0; }
+
+    // Minimum time between reads of the slot; 0 means every conversion
+    uint32_t getIntervalUs(int slot) const;
+    uint32_t getTransitions() const { return transitions; }
+
+private:
+    int count;
+    uint32_t activeSlots;
+    uint32_t seededSlots;
+    uint32_t suspectSlots;      // Last conversion moved; waiting for the next to confirm
+    uint32_t transitions;
+    int32_t mean[SENSOR_MAX_CHANNELS];
+    uint64_t variance[SENSOR_MAX_CHANNELS];     // Counts squared
+    uint64_t threshold[SENSOR_MAX_CHANNELS];    // ADAPTIVE_ACTIVITY_KG in counts, squared
+    uint32_t lastMovementMs[SENSOR_MAX_CHANNELS];
+};
+
+#endif // ACTIVITY_SCHEDULER_H
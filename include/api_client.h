@@ -3,32 +3,121 @@
 
 #include <Arduino.h>
 #include <HTTPClient.h>
+#include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
-#include <Preferences.h>
 #include "config.h"
+#include "config_store.h"
+#include "weight_event_detector.h"
+#include "rollup_tracker.h"
+#include "sensor_payload.h"
+#if API_GZIP_ENABLED
+#include "gzip_writer.h"
+#endif
+
+// Connection reuse and latency. A request either reuses the open
+// connection or first pays for a TCP connect and TLS handshake; the two
+// are timed separately, in ms
+struct ApiConnectionStats {
+    uint32_t requests;
+    uint32_t handshakes;
+    uint32_t failedHandshakes;
+    uint32_t staleConnections;  // Reused connections found closed by the server
+    uint32_t lastHandshakeMs;
+    uint32_t maxHandshakeMs;
+    uint32_t totalHandshakeMs;
+    uint32_t lastRequestMs;     // Request sent until response read, handshake excluded
+    uint32_t maxRequestMs;
+    uint32_t totalRequestMs;
+    uint32_t compressedRequests;    // Bodies sent gzipped, and their size before and after
+    uint32_t uncompressedBytes;
+    uint32_t compressedBytes;
+    uint32_t totalCompressUs;
+};
 
 class APIClient {
 public:
-    APIClient();
+    explicit APIClient(ConfigStore& config);
     void init();
     bool authenticate();
-    bool submitSensorData(SensorReading* readings, int count);
+    // Readings taken in the given boot (ConfigStore::countBoot()), e.g.
+    // ones the reading log kept from before a restart
+    bool submitSensorData(SensorReading* readings, int count, uint32_t boot);
+    
+    // Sensor-data batching: each frame (a snapshot of all bins) is held,
+    // and one POST carries the frames once the configured number is
+    // waiting or the oldest has waited the configured delay (ConfigStore,
+    // BLE set_upload_batch). Frames stay held when a flush fails
+    bool addSensorFrame(const SensorReading* readings, int count);  // False when the batch is full
+    bool isBatchDue();
+    bool flushSensorFrames();
+    const SensorReading* getHeldReadings(int& count);
+    int getHeldFrameCount();
+    void clearHeldFrames();
+    
+    bool submitEvents(const WeightEvent* events, int count);
+    bool submitRollups(const Rollup* rollups, int count);
     bool isAuthenticated();
     String getDeviceId();
     String getApiKey();
     String getApiUrl();
     void setCredentials(const String& apiKey, const String& apiUrl, const String& deviceId);
+    void disconnect();              // Close the kept-open connection, e.g. when WiFi drops
+    ApiConnectionStats getConnectionStats();
 
 private:
-    Preferences preferences;
+    ConfigStore& config;
     String apiKey;
     String apiUrl;
     String deviceId;
     bool authenticated;
     HTTPClient http;
     
+    // The connection HTTPClient runs on, kept open between requests
+    WiFiClientSecure tlsClient;
+    WiFiClient plainClient;
+    unsigned long lastRequestEnd;
+    ApiConnectionStats connectionStats;
+    
+    // Held frames; each is a run of valid readings in batchReadings
+    SensorFrame batchFrames[UPLOAD_BATCH_MAX_FRAMES];
+    SensorReading batchReadings[UPLOAD_BATCH_MAX_READINGS];
+    int batchFrameCount;
+    int batchReadingCount;
+    int lastFrameSize;
+    unsigned long batchStart;
+    
+    // Sensor-data bodies are written here rather than into a String, so
+    // the upload path does not allocate
+    uint8_t payloadBuffer[API_PAYLOAD_BUFFER_BYTES];
+    
+    // Sensor-data wire format: JSON by default. With API_MSGPACK_ENABLED,
+    // MessagePack until the server turns it down (415, or 400/422 before
+    // it has accepted any), then JSON until the next authenticate()
+    PayloadFormat sensorFormat;
+    bool binaryAccepted;
+    int lastStatusCode;
+    
+#if API_GZIP_ENABLED
+    // With API_GZIP_ENABLED, POST bodies of API_GZIP_MIN_BYTES or more go
+    // gzipped (Content-Encoding) until the server turns that down the same
+    // way. Without it the encoder and its buffer (about 18 KB) are left out
+    GzipWriter gzip;
+    uint8_t compressedBuffer[API_GZIP_BUFFER_BYTES];
+    bool compressRequests;
+    bool gzipAccepted;
+#endif
+    
+    WiFiClient& transport();
+    bool openConnection();
     bool makeRequest(const String& endpoint, const String& method, const String& payload, String& response);
-    String createSensorDataPayload(SensorReading* readings, int count);
+    bool makeRequest(const char* endpoint, const char* method, const uint8_t* body, size_t length,
+                     const char* contentType, String& response);
+    bool sendRequest(const char* endpoint, const char* method, const uint8_t* body, size_t length,
+                     const char* contentType, const char* contentEncoding, String& response);
+    bool postSensorPayload(const SensorReading* readings, int count, const SensorFrame* frames, int frameCount,
+                           uint32_t boot);
+    String createEventsPayload(const WeightEvent* events, int count);
+    String createRollupsPayload(const Rollup* rollups, int count);
     void loadCredentials();
     bool testConnection();
 };
@@ -7,8 +7,9 @@
 #include <BLEUtils.h>
 #include <BLE2902.h>
 #include <ArduinoJson.h>
-#include <Preferences.h>
 #include "config.h"
+#include "config_store.h"
+#include "ring_buffer.h"
 
 // Forward declaration
 class SensorManager;
@@ -21,7 +22,7 @@ class SensorManager;
 
 class BluetoothProvisioning : public BLEServerCallbacks, public BLECharacteristicCallbacks {
 public:
-    BluetoothProvisioning();
+    explicit BluetoothProvisioning(ConfigStore& config);
     void init();
     void start();
     void startSettingsMode();
@@ -30,7 +31,7 @@ public:
     bool isSetupComplete();
     bool isInProvisioningMode();
     bool isInSettingsMode();
-    void update(); // Call in main loop
+    void update(); // Call in main loop; runs the queued commands
     void broadcastDeviceStatus(const String& wifiStatus, const String& apiStatus, const String& sensorStatus);
     void setSensorManager(SensorManager* sensorMgr);
 
@@ -40,6 +41,11 @@ public:
     void onWrite(BLECharacteristic* pCharacteristic) override;
 
 private:
+    // A command as written by the client, NUL-terminated
+    struct Command {
+        char text[BLUETOOTH_COMMAND_MAX_BYTES + 1];
+    };
+
     BLEServer* pServer;
     BLEService* pService;
     BLECharacteristic* pCommandCharacteristic;
@@ -47,7 +53,7 @@ private:
     BLECharacteristic* pStatusCharacteristic;
     BLEAdvertising* pAdvertising;
     
-    Preferences preferences;
+    ConfigStore& config;
     bool active;
     bool setupComplete;
     bool deviceConnected;
@@ -58,6 +64,10 @@ private:
     bool isSettingsMode;
     SensorManager* pSensorManager;
     
+    // Written on the BLE task, run on the loop task, so that ConfigStore and
+    // SensorManager are only ever used from the main loop
+    RingBuffer<Command, BLUETOOTH_COMMAND_QUEUE_SIZE> commandQueue;
+    
     void setupBLEServer();
     void processCommand(const String& command);
     void sendResponse(const String& status, const String& message);
@@ -69,11 +79,16 @@ private:
     void handleGetScaleFactorCommand(JsonDocument& doc);
     void handleGetAllScaleFactorsCommand();
     void handleCalibrateSensorCommand(JsonDocument& doc);
+    void handleTareSensorCommand(JsonDocument& doc);
+    void handleCalibrationBeginCommand(JsonDocument& doc);
+    void handleCalibrationAddPointCommand(JsonDocument& doc);
+    void handleCalibrationFinishCommand();
+    void handleGetSamplingStatsCommand();
+    void handleUploadBatchCommand(JsonDocument& doc);
+    void handleTraceCommand(const String& cmd);
     bool testWiFiConnection(const String& ssid, const String& password);
     bool testAPIConnection(const String& apiKey, const String& apiUrl);
     String generateDeviceId();
-    void saveCredentials(const String& key, const String& value);
-    String loadCredentials(const String& key);
 };
 
 #endif // BLUETOOTH_PROVISIONING_H
@@ -1,15 +1,21 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+// Also included by host-side tools, which build without the Arduino core
+#ifdef ARDUINO
 #include <Arduino.h>
+#endif
+#include <stdint.h>
 
 // Device Configuration
 #define DEVICE_NAME "SmartBin"
 #define FIRMWARE_VERSION "1.0.0"
-#define MAX_BINS 6
+#define MAX_BINS 6                // On-board HX711 channels
+#define SENSOR_MAX_CHANNELS 32    // Channel registry limit (masks are 32 bits)
 
 // Testing Configuration
 #define TESTING_MODE false  // Set to false when actual sensors are connected
+#define SYNTHETIC_SEED 20240601  // Scenario seed for TESTING_MODE data (see synthetic_scenario.h)
 
 // GPIO Pin Definitions for HX711 Load Cells
 // Each HX711 requires 2 pins: CLK (Clock) and DOUT (Data)
@@ -27,6 +33,14 @@
 #define HX711_6_CLK_PIN 21
 #define HX711_6_DOUT_PIN 22
 
+// Optional HX711s behind a 74HC165 chain: DOUTs on the register inputs, one
+// shared CLK. Their channels are numbered after the MAX_BINS on-board ones
+#define HX711_EXPANSION_CHANNELS 0      // 0 disables; 8 per register, up to SENSOR_MAX_CHANNELS - MAX_BINS
+#define EXPANSION_LOAD_PIN 23           // 74HC165 PL (active low)
+#define EXPANSION_CLOCK_PIN 25          // 74HC165 CP
+#define EXPANSION_DATA_PIN 26           // Q7 of the register wired to the ESP32
+#define EXPANSION_HX711_CLK_PIN 27      // Shared PD_SCK of the expansion HX711s
+
 // Built-in LED Pin for Heartbeat
 #define BUILTIN_LED_PIN 2  // Built-in blue LED on ESP32 WROOM-32 dev boards
 
@@ -44,6 +58,8 @@
 #define BLUETOOTH_PROVISIONING_TIMEOUT 300000    // 5 minutes for initial provisioning
 #define BLUETOOTH_SETTINGS_TIMEOUT 0              // 0 = no timeout for settings mode (always available)
 #define BLUETOOTH_INACTIVITY_TIMEOUT 1800000      // 30 minutes of inactivity before power optimization
+#define BLUETOOTH_COMMAND_MAX_BYTES 512           // Longest command accepted (the BLE attribute limit)
+#define BLUETOOTH_COMMAND_QUEUE_SIZE 4            // Commands waiting for the main loop (power of two)
 
 // WiFi Configuration
 #define WIFI_MAX_RETRIES 3
@@ -52,15 +68,35 @@
 // API Configuration
 #define API_BASE_URL "https://smart-bins-api-uay7w.ondigitalocean.app/smart-bins-api2"
 #define API_SENSOR_DATA_ENDPOINT "/api/v1/sensor-data"
+#define API_EVENTS_ENDPOINT "/api/v1/bin-events"
+#define API_ROLLUPS_ENDPOINT "/api/v1/bin-rollups"
 #define MAX_API_RETRIES 3
 #define API_RETRY_DELAY 2000
+#define UPLOAD_BATCH_FRAMES 10          // Snapshots per sensor-data POST; 1 posts each one (BLE: set_upload_batch)
+#define UPLOAD_BATCH_MAX_DELAY_MS 10000 // ...or fewer, once the oldest has waited this long
+#define UPLOAD_BATCH_MAX_FRAMES 30      // Upper limit for the runtime batch size
+#define UPLOAD_BATCH_DELAY_LIMIT_MS 600000 // Upper limit for the runtime delay
+#define UPLOAD_BATCH_MAX_READINGS 192   // Valid readings held across the frames of a batch
+#define API_PAYLOAD_BUFFER_BYTES 16384  // Preallocated request body, sized for a full batch
+#define API_WEIGHT_DECIMALS 3           // Weight resolution in uploads (1 g)
+#define API_MSGPACK_ENABLED 0           // Offer MessagePack sensor data; set to 1 only for a server that reads it
+#define API_MSGPACK_CONTENT_TYPE "application/msgpack"
+#define API_GZIP_ENABLED 0              // gzip request bodies; set to 1 only for a server that inflates them
+#define API_GZIP_MIN_BYTES 1024         // Smaller bodies go out uncompressed
+#define API_GZIP_WINDOW_BYTES 2048      // LZ77 history; the encoder holds about 5x this
+#define API_GZIP_BUFFER_BYTES 8192      // Compressed body; a body that does not shrink into it goes plain
+#define API_KEEP_ALIVE 1                // Keep one connection open across requests
+#define API_CONNECTION_MAX_IDLE_MS 30000 // Reconnect rather than reuse a connection idle this long
 
 // Bluetooth Configuration
 #define BT_DEVICE_NAME_PREFIX "SmartBin_"
 #define BT_BUFFER_SIZE 512
 
-// NVS Storage Keys
+// NVS Storage Keys. Settings live in one CRC-checked blob (config_store.h);
+// the per-setting keys below are only read to migrate older devices
 #define NVS_NAMESPACE "smartbin"
+#define NVS_CONFIG_BLOB "config"
+#define NVS_BOOT_COUNT "boot_count"       // Own key, so counting a boot never rewrites the blob
 #define NVS_WIFI_SSID "wifi_ssid"
 #define NVS_WIFI_PASSWORD "wifi_pass"
 #define NVS_API_KEY "api_key"
@@ -68,20 +104,97 @@
 #define NVS_DEVICE_ID "device_id"
 #define NVS_SETUP_COMPLETE "setup_done"
 #define NVS_SCALE_FACTOR_PREFIX "scale_"  // Will be used as "scale_0", "scale_1", etc.
+#define NVS_TARE_OFFSET_PREFIX "tare_"    // Raw zero offsets: "tare_0", "tare_1", etc.
+#define NVS_SENSOR_MASK "sensor_mask"     // Bitmask of bins detected on the last boot
+
+// Setting lengths kept in the config blob (characters, without the terminator)
+#define CONFIG_WIFI_SSID_MAX 32
+#define CONFIG_WIFI_PASSWORD_MAX 64
+#define CONFIG_API_KEY_MAX 128
+#define CONFIG_API_URL_MAX 128
+#define CONFIG_DEVICE_ID_MAX 32
 
 // Sensor Configuration
 #define HX711_DEFAULT_SCALE_FACTOR 1000.0  // Default calibration factor
-#define WEIGHT_SMOOTHING_SAMPLES 3
+#define HX711_SAMPLES_PER_READING 6    // Conversions filtered into one published reading
+#define HX711_TARE_SAMPLES 10          // Conversions averaged for the first-boot zero (HX711::tare default)
+
+// Raw-count filter pipeline (see filter_pipeline.h and SensorFilter in sensor_manager.h)
+#define FILTER_HAMPEL_WINDOW 15         // Odd window of raw conversions for the outlier test
+#define FILTER_HAMPEL_K10 30            // Reject beyond 3.0 scaled MADs (tenths)
+#define FILTER_HAMPEL_MIN_MAD 16        // MAD floor in counts, so quiet cells still pass real steps
+#define FILTER_MEDIAN_WINDOW 3          // Odd window, removes single-conversion spikes
+#define FILTER_EMA_SHIFT 2              // EMA alpha = 1/4
+#define FILTER_KALMAN_Q 4               // Kalman process noise (counts^2), when the stage is selected
+#define FILTER_KALMAN_R 400             // Kalman measurement noise (counts^2)
 #define MIN_WEIGHT_CHANGE 0.1      // Minimum weight change to consider significant (kg)
-#define SENSOR_DETECTION_TIMEOUT 2000  // Timeout for sensor detection (ms)
+#define SETTLE_WINDOW_MS 3000           // Readings must hold steady this long to be settled
+#define SETTLE_MIN_READINGS 3           // ...over at least this many readings
+#define SETTLE_MAX_STDDEV_KG 0.05       // Max standard deviation of a steady window
+#define UPLOAD_SETTLED_ONLY 1           // Upload each bin's last settled weight, not its latest reading
+#define SENSOR_DETECTION_TIMEOUT 2000  // Timeout for sensor detection (ms), shared by all channels
+#define SENSOR_RESCAN_TIMEOUT 600      // Warm boot: timeout for bins not in the cached set (ms)
 #define MIN_REQUIRED_SENSORS 1     // Minimum number of sensors required to operate
+#define CALIBRATION_SAMPLES_PER_POINT 20  // Raw conversions averaged per calibration point
+#define CALIBRATION_CAPTURE_TIMEOUT 5000   // Max time to collect one calibration point (ms)
+#define CALIBRATION_MIN_COUNTS 1000        // Smallest change from tare a single-point calibration accepts
+
+// Deposit/removal event detection (CUSUM on each bin's filtered weight)
+#define EVENT_DETECTION_ENABLED 1
+#define EVENT_CUSUM_SLACK_KG 0.05       // Per-reading deviation absorbed before the CUSUM grows
+#define EVENT_CUSUM_THRESHOLD_KG 0.5    // Accumulated deviation that opens a change
+#define EVENT_SETTLE_BAND_KG 0.1        // Max spread of the readings that close a change
+#define EVENT_SETTLE_MS 2000            // ...held for this long
+#define EVENT_SETTLE_MIN_READINGS 3     // ...over at least this many readings
+#define EVENT_MIN_DELTA_KG 0.2          // Smaller settled changes are absorbed as drift
+#define EVENT_EMPTY_KG 0.5              // A removal that leaves less than this is a collection
+#define EVENT_QUEUE_SIZE 16             // Events waiting for upload (power of two)
+#define EVENT_UPLOAD_BATCH 8            // Events per request
+#define EVENT_UPLOAD_RETRY_MS 5000      // Wait after a failed event upload
+
+// Per-bin min/max/mean rollups over fixed windows (see rollup_tracker.h)
+#define ROLLUP_ENABLED 1
+#define ROLLUP_WINDOWS_MS { 60000, 900000, 3600000 }  // Each aligned to a multiple of its length
+#define ROLLUP_WINDOW_COUNT 3           // Entries in ROLLUP_WINDOWS_MS
+#define ROLLUP_QUEUE_SIZE 64            // Closed rollups waiting for upload (power of two)
+#define ROLLUP_UPLOAD_BATCH 24          // Rollups per request
+#define ROLLUP_UPLOAD_INTERVAL_MS 60000 // Max time a closed rollup waits for a fuller batch
+#define UPLOAD_ROLLUPS_ONLY 0           // 1 sends rollups instead of a reading every SENSOR_READ_INTERVAL
 
 // Default scale factors for each sensor (used if NVS is empty)
 #define HX711_DEFAULT_SCALE_FACTORS { 140400, 1000.0, 1000.0, 1000.0, 1000.0, 1000.0 }
 
-// Data Buffer Configuration
-#define MAX_BUFFERED_READINGS 100
-#define BUFFER_SAVE_INTERVAL 60000  // Save buffer to NVS every minute
+// Sampling Task Configuration
+#define SAMPLING_TASK_CORE 1            // APP_CPU; the WiFi/BLE stacks run on core 0
+#define SAMPLING_TASK_PRIORITY 2        // Above the Arduino loop task (priority 1)
+#define SAMPLING_TASK_STACK_SIZE 4096
+#define SAMPLING_TASK_IDLE_TIMEOUT_MS 250  // Fallback poll if no data-ready interrupt arrives
+#define SAMPLING_TASK_POLL_INTERVAL_MS 10  // Poll period while any channel has no data-ready interrupt
+#define HX711_CONVERSION_PERIOD_US 100000   // 10 SPS (RATE pin low), used to count missed conversions
+#define HX711_FAST_CONVERSION_PERIOD_US 12500  // 80 SPS (RATE pin high)
+#define HX711_RATE_PIN -1               // Drives RATE on every HX711 (high = 80 SPS); -1 when tied low
+#define SAMPLE_QUEUE_SIZE 128           // Sampling task -> main loop ring buffer slots (power of two)
+
+// Adaptive Sampling
+#define ADAPTIVE_SAMPLING_ENABLED 1     // 0 reads every bin at every conversion at 10 SPS
+#define ADAPTIVE_ACTIVITY_KG 0.1        // Conversion spread (std dev) that marks a bin active
+#define ADAPTIVE_HOLD_MS 30000          // An active bin stays active this long after it last moved
+#define ADAPTIVE_IDLE_INTERVAL_MS 1000  // An idle bin is read at most this often
+
+// Raw Trace Recording (LittleFS on the "spiffs" partition of partitions.csv)
+#define TRACE_FILE_PATH "/trace.bin"
+#define TRACE_MAX_BYTES 524288          // Recording stops at this file size
+#define TRACE_QUEUE_SIZE 128            // Sampling task -> flash writer slots (power of two)
+
+// Data Buffer Configuration: readings that could not be uploaded go to a
+// store-and-forward log on the "readlog" partition (see reading_log.h)
+#define MAX_BUFFERED_READINGS 100   // Readings held in RAM per flash append
+#define BUFFER_SAVE_INTERVAL 60000  // Append buffered readings to flash at least every minute
+#define READING_LOG_PARTITION "readlog"
+#define READING_LOG_MAX_SECTORS 64      // Sectors used; 64 x 4 KB holds about 70,000 readings
+#define READING_LOG_BLOCK_BYTES 512     // Compressed batch buffer; a full one is appended early
+#define READING_CODEC_UNITS_PER_KG 1000 // Logged weight resolution (1 g, see reading_codec.h)
+#define READING_LOG_DRAIN_INTERVAL 2000 // Min time between uploads of logged readings (ms)
 
 // Device States
 enum DeviceState {
@@ -100,11 +213,13 @@ struct SensorReading {
     bool valid;
 };
 
+#ifdef ARDUINO
 // API Response Structure
 struct ApiResponse {
     bool success;
     int status_code;
     String message;
 };
+#endif
 
 #endif // CONFIG_H
@@ -0,0 +1,127 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include "config.h"
+#include "hal.h"
+
+// Device settings, held in RAM after one load at boot.
+//
+// Reads never touch NVS. Setters only mark the changed group of fields
+// dirty; commit() writes the whole set as a single blob under
+// NVS_CONFIG_BLOB in one NVS commit:
+//
+//     0  u16      format version
+//     2  u16      length of the settings that follow
+//     4  ...      StoredSettings
+//     n  u32      CRC-32 of everything before it
+//
+// A blob that is missing, truncated or fails its CRC is ignored. Devices
+// set up by older firmware have one NVS key per setting; load() reads
+// those, commits them as a blob and removes them once the blob is saved;
+// if one of their strings does not fit its field, they are left in place.
+// Free of Arduino dependencies.
+//
+// Not thread-safe, and neither is the NVS store behind it: only setup()
+// and the main loop use it. BLE commands are queued to the loop for this.
+class ConfigStore {
+public:
+    // Groups of fields tracked for commit()
+    enum Field {
+        FIELD_WIFI = 1 << 0,
+        FIELD_API = 1 << 1,
+        FIELD_SETUP = 1 << 2,
+        FIELD_SENSOR_MASK = 1 << 3,
+        FIELD_CALIBRATION = 1 << 4,
+        FIELD_UPLOAD = 1 << 5
+    };
+
+    enum Source {
+        SOURCE_DEFAULTS,        // Nothing stored, or the blob was corrupt
+        SOURCE_BLOB,
+        SOURCE_LEGACY           // Migrated from per-setting keys
+    };
+
+    explicit ConfigStore(KeyValueStore& store);
+
+    // Read the settings from NVS; false if none were found and the
+    // defaults are in use
+    bool load();
+
+    // Write the settings if any changed; true if nothing was left unsaved
+    bool commit();
+
+    // Increment the boot counter under NVS_BOOT_COUNT and return it. It
+    // tells readings logged in different boots apart, since their
+    // timestamps are millis(). Returns 0 (unknown) if NVS cannot be written
+    uint32_t countBoot();
+    uint32_t getBootCount() const { return bootCount; }
+
+    uint32_t getDirtyFields() const { return dirtyFields; }
+    Source getSource() const { return source; }
+    uint32_t getCommitCount() const { return commitCount; }
+
+    const char* getWifiSsid() const { return settings.wifiSsid; }
+    const char* getWifiPassword() const { return settings.wifiPassword; }
+    const char* getApiKey() const { return settings.apiKey; }
+    const char* getApiUrl() const { return settings.apiUrl; }
+    const char* getDeviceId() const { return settings.deviceId; }
+    bool isSetupComplete() const { return settings.setupComplete != 0; }
+    uint16_t getUploadBatchFrames() const { return settings.uploadBatchFrames; }
+    uint32_t getUploadBatchMaxDelayMs() const { return settings.uploadBatchMaxDelayMs; }
+
+    // False when nothing has been saved for the bin
+    bool getSensorMask(uint32_t& mask) const;
+    bool getScaleFactor(int binId, float& scaleFactor) const;
+    bool getTareOffset(int binId, int32_t& offset) const;
+
+    // Strings longer than the CONFIG_*_MAX limits are refused
+    bool setWifiCredentials(const char* ssid, const char* password);
+    bool setApiCredentials(const char* apiKey, const char* apiUrl, const char* deviceId);
+    void setSetupComplete(bool complete);
+    void setSensorMask(uint32_t mask);
+    void setScaleFactor(int binId, float scaleFactor);
+    void setTareOffset(int binId, int32_t offset);
+    // Frames outside 1..UPLOAD_BATCH_MAX_FRAMES or a delay above
+    // UPLOAD_BATCH_DELAY_LIMIT_MS are refused
+    bool setUploadBatch(uint16_t frames, uint32_t maxDelayMs);
+
+private:
+    // Blob payload; raw little-endian layout, so any change to it needs a
+    // new CONFIG_BLOB_VERSION. Fields are only ever appended, so an older
+    // version is a prefix and loads with defaults for the rest
+    struct StoredSettings {
+        char wifiSsid[CONFIG_WIFI_SSID_MAX + 1];
+        char wifiPassword[CONFIG_WIFI_PASSWORD_MAX + 1];
+        char apiKey[CONFIG_API_KEY_MAX + 1];
+        char apiUrl[CONFIG_API_URL_MAX + 1];
+        char deviceId[CONFIG_DEVICE_ID_MAX + 1];
+        uint8_t setupComplete;
+        uint32_t sensorMask;
+        uint32_t sensorMaskValid;
+        uint32_t scaleMask;         // Bins with a saved scale factor
+        uint32_t tareMask;          // Bins with a saved zero offset
+        float scaleFactors[SENSOR_MAX_CHANNELS];
+        int32_t tareOffsets[SENSOR_MAX_CHANNELS];
+        // Version 2
+        uint16_t uploadBatchFrames;
+        uint32_t uploadBatchMaxDelayMs;
+    };
+
+    KeyValueStore& store;
+    StoredSettings settings;
+    uint32_t dirtyFields;
+    Source source;
+    uint32_t commitCount;
+    uint32_t bootCount;
+    bool removeLegacyKeys;
+
+    void setDefaults();
+    bool decodeBlob(const uint8_t* blob, size_t length);
+    bool loadLegacyKeys(bool& complete);
+    bool loadLegacyString(const char* key, char* target, size_t size, bool& complete);
+    bool removeLegacy();
+    static void copyString(char* target, size_t size, const char* value, bool& changed);
+};
+
+#endif // CONFIG_STORE_H
@@ -0,0 +1,266 @@
+#ifndef FILTER_PIPELINE_H
+#define FILTER_PIPELINE_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Integer filter stages for raw HX711 counts.
+//
+// Every stage exposes process(int32_t) -> int32_t and reset(). Stages are
+// combined at compile time with FilterChain<...>, so the whole pipeline is
+// inlined with no virtual calls and no floating point. Conversion to
+// kilograms happens once, after the chain.
+//
+// HX711 counts are signed 24-bit, which leaves 7 bits of headroom in an
+// int32_t for fractional state.
+
+// Median of the last N samples (N odd). Removes single-sample spikes
+template <int N>
+class MedianStage {
+    static_assert(N > 0 && (N % 2) == 1, "MedianStage window must be odd");
+
+public:
+    MedianStage() { reset(); }
+
+    int32_t process(int32_t sample) {
+        window[pos] = sample;
+        pos = (pos + 1) % N;
+        if (count < N) count++;
+
+        // Insertion sort of at most N elements; N is small
+        int32_t sorted[N];
+        for (int i = 0; i < count; i++) {
+            int32_t v = window[i];
+            int j = i - 1;
+            while (j >= 0 && sorted[j] > v) {
+                sorted[j + 1] = sorted[j];
+                j--;
+            }
+            sorted[j + 1] = v;
+        }
+        return sorted[count / 2];
+    }
+
+    void reset() {
+        count = 0;
+        pos = 0;
+    }
+
+private:
+    int32_t window[N];
+    int count;
+    int pos;
+};
+
+// Hampel identifier over a sliding window of the last N raw samples (N odd).
+// A sample further than K10/10 scaled MADs (1.4826 * MAD, the normal-
+// consistent sigma) from the window median is replaced by the median, so a
+// bit-slipped conversion that is still in range never reaches later stages.
+// A genuine step is passed through once it fills half the window. MinMad
+// (counts) keeps a quiet, quantised signal from rejecting every change.
+//
+// The window is kept sorted alongside the ring: each sample costs two binary
+// searches and a memmove of at most N - 1 words, and the MAD is the k-th
+// smallest of two already-sorted deviation runs, found in O(log N)
+template <int N, int K10, int32_t MinMad>
+class HampelStage {
+    static_assert(N >= 3 && (N % 2) == 1, "HampelStage window must be odd and at least 3");
+    static_assert(K10 > 0 && MinMad > 0, "HampelStage threshold must be positive");
+
+public:
+    HampelStage() { reset(); }
+
+    int32_t process(int32_t sample) {
+        if (count == N) {
+            removeSorted(window[pos]);
+        }
+        insertSorted(sample);
+        window[pos] = sample;
+        pos = (pos + 1) % N;
+
+        // Nothing is judged until the window is full
+        rejected = false;
+        if (count < N) {
+            return sample;
+        }
+
+        int32_t median = sorted[N / 2];
+        int32_t mad = medianDeviation(median);
+        if (mad < MinMad) mad = MinMad;
+
+        // |x - median| > K * 1.4826 * MAD, in integers
+        int64_t deviation = sample >= median ? (int64_t)sample - median : (int64_t)median - sample;
+        if (deviation * 100000 > (int64_t)K10 * 14826 * mad) {
+            rejected = true;
+            return median;
+        }
+        return sample;
+    }
+
+    void reset() {
+        count = 0;
+        pos = 0;
+        rejected = false;
+    }
+
+    // True when the last sample was replaced by the median
+    bool lastRejected() const { return rejected; }
+
+private:
+    int32_t window[N];   // Ring of raw samples, oldest at pos once full
+    int32_t sorted[N];   // Same samples in ascending order
+    int count;
+    int pos;
+    bool rejected;
+
+    // First index whose value is not below v
+    int lowerBound(int32_t v) const {
+        int lo = 0, hi = count;
+        while (lo < hi) {
+            int mid = (lo + hi) >> 1;
+            if (sorted[mid] < v) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    void insertSorted(int32_t v) {
+        int at = lowerBound(v);
+        memmove(&sorted[at + 1], &sorted[at], (count - at) * sizeof(int32_t));
+        sorted[at] = v;
+        count++;
+    }
+
+    void removeSorted(int32_t v) {
+        int at = lowerBound(v);
+        count--;
+        memmove(&sorted[at], &sorted[at + 1], (count - at) * sizeof(int32_t));
+    }
+
+    // Deviations below the median, nearest first: ascending
+    int32_t below(int j) const { return sorted[N / 2] - sorted[N / 2 - 1 - j]; }
+    // Deviations above the median, nearest first: ascending
+    int32_t above(int j) const { return sorted[N / 2 + 1 + j] - sorted[N / 2]; }
+
+    // Median of |x - median| over the full window. The median's own zero is
+    // the smallest deviation, so the answer is the H-th smallest of the two
+    // runs of H = N / 2 deviations each, by binary search on the split
+    int32_t medianDeviation(int32_t median) const {
+        const int h = N / 2;
+        int lo = 0, hi = h;
+        while (lo <= hi) {
+            int i = (lo + hi) >> 1; // Taken from below, h - i from above
+            int j = h - i;
+            if (i < h && j > 0 && above(j - 1) > below(i)) {
+                lo = i + 1;
+            } else if (i > 0 && j < h && below(i - 1) > above(j)) {
+                hi = i - 1;
+            } else {
+                int32_t fromBelow = i > 0 ? below(i - 1) : INT32_MIN;
+                int32_t fromAbove = j > 0 ? above(j - 1) : INT32_MIN;
+                return fromBelow > fromAbove ? fromBelow : fromAbove;
+            }
+        }
+        return 0;
+    }
+};
+
+// Exponential moving average with alpha = 1 / 2^Shift. State is kept with
+// FracBits fractional bits so small steps are not lost to truncation.
+// Seeded from the first sample rather than from zero
+template <int Shift, int FracBits = 6>
+class EmaStage {
+    static_assert(Shift >= 0 && Shift < 16, "EmaStage shift out of range");
+    static_assert(FracBits >= 0 && FracBits <= 7, "EmaStage needs FracBits <= 7 for 24-bit input");
+
+public:
+    EmaStage() { reset(); }
+
+    int32_t process(int32_t sample) {
+        int32_t scaled = sample * (1 << FracBits);
+
+        if (!seeded) {
+            state = scaled;
+            seeded = true;
+        } else {
+            state += (scaled - state) >> Shift;
+        }
+        return (state + (1 << FracBits >> 1)) >> FracBits;
+    }
+
+    void reset() {
+        state = 0;
+        seeded = false;
+    }
+
+private:
+    int32_t state;
+    bool seeded;
+};
+
+// Scalar Kalman filter for a constant signal. ProcessNoise (Q) and
+// MeasurementNoise (R) are variances in counts^2; the gain is Q16
+template <uint32_t ProcessNoise, uint32_t MeasurementNoise>
+class KalmanStage {
+    static_assert(MeasurementNoise > 0, "KalmanStage needs a non-zero measurement noise");
+
+public:
+    KalmanStage() { reset(); }
+
+    int32_t process(int32_t sample) {
+        if (!seeded) {
+            estimate = sample;
+            errorVariance = MeasurementNoise;
+            seeded = true;
+            return estimate;
+        }
+
+        uint32_t predicted = errorVariance + ProcessNoise;
+        uint32_t gain = (uint32_t)(((uint64_t)predicted << 16) / ((uint64_t)predicted + MeasurementNoise));
+
+        estimate += (int32_t)(((int64_t)gain * (sample - estimate)) >> 16);
+        errorVariance = (uint32_t)(((uint64_t)(65536 - gain) * predicted) >> 16);
+        return estimate;
+    }
+
+    void reset() {
+        estimate = 0;
+        errorVariance = 0;
+        seeded = false;
+    }
+
+private:
+    int32_t estimate;
+    uint32_t errorVariance;
+    bool seeded;
+};
+
+// Compile-time composition: samples pass through the stages left to right
+template <typename... Stages>
+class FilterChain;
+
+template <>
+class FilterChain<> {
+public:
+    int32_t process(int32_t sample) { return sample; }
+    void reset() {}
+};
+
+template <typename First, typename... Rest>
+class FilterChain<First, Rest...> {
+public:
+    int32_t process(int32_t sample) {
+        return rest.process(stage.process(sample));
+    }
+
+    void reset() {
+        stage.reset();
+        rest.reset();
+    }
+
+private:
+    First stage;
+    FilterChain<Rest...> rest;
+};
+
+#endif // FILTER_PIPELINE_H
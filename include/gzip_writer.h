@@ -0,0 +1,63 @@
+#ifndef GZIP_WRITER_H
+#define GZIP_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+#if (API_GZIP_WINDOW_BYTES & (API_GZIP_WINDOW_BYTES - 1)) || API_GZIP_WINDOW_BYTES < 512 || \
+    API_GZIP_WINDOW_BYTES > 16384
+#error "API_GZIP_WINDOW_BYTES must be a power of two from 512 to 16384"
+#endif
+
+// Streaming gzip (RFC 1952) into a caller-owned buffer, with no heap use.
+// Input is fed in any number of write() calls and compressed in one pass:
+// greedy LZ77 over the last API_GZIP_WINDOW_BYTES of input, with hash
+// chains, coded as a single fixed-Huffman deflate block. All state lives
+// in the object (about 5 x API_GZIP_WINDOW_BYTES), so it costs nothing
+// per request. Output that does not fit sets overflowed(). Free of
+// Arduino dependencies.
+class GzipWriter {
+public:
+    GzipWriter();
+
+    void begin(uint8_t* output, size_t capacity);
+    void write(const uint8_t* data, size_t length);
+    void finish();      // Ends the stream; length() is then the whole body
+
+    size_t length() const { return used; }
+    bool overflowed() const { return overflow; }
+
+private:
+    static const int HASH_BITS = 10;
+    static const uint16_t NONE = 0xFFFF;
+
+    uint8_t* output;
+    size_t capacity;
+    size_t used;
+    bool overflow;
+    uint32_t bitBuffer;
+    int bitCount;
+    uint32_t crc;
+    uint32_t inputSize;
+
+    // Input history: window holds up to two windows of input, pos is the
+    // next byte to encode. Positions in head and prev are window offsets
+    uint8_t window[2 * API_GZIP_WINDOW_BYTES];
+    size_t filled;
+    size_t pos;
+    uint16_t head[1 << HASH_BITS];
+    uint16_t prev[API_GZIP_WINDOW_BYTES];
+
+    void encode(bool flush);
+    void slide();
+    uint32_t hash(size_t at) const;
+    void insert(size_t at);
+    void putByte(uint8_t byte);
+    void putBits(uint32_t value, int count);
+    void putCode(uint32_t code, int count);     // Huffman codes go most significant bit first
+    void putLiteral(int symbol);
+    void putMatch(int length, int distance);
+};
+
+#endif // GZIP_WRITER_H
@@ -0,0 +1,94 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hardware abstraction used by SensorManager and the reading log. The ESP32
+// implementations live in hal_esp32.h; hal_native.h provides a simulated
+// HX711 bank, a virtual clock, an in-memory store and a file-backed flash so
+// the sensor stack runs on a development machine (env:native).
+
+// Bank of load-cell ADC channels, one per bin, sampled as bitmasks
+class LoadCellAdc {
+public:
+    typedef void (*DataReadyHandler)(void* arg);
+
+    virtual ~LoadCellAdc() {}
+    virtual void begin() = 0;
+    virtual int getChannelCount() = 0;
+
+    // Bit i set when channel i has a conversion waiting
+    virtual uint32_t readyMask() = 0;
+
+    // Read one conversion from every channel in channelMask. values[i] is
+    // written for each channel read; returns the mask actually read
+    virtual uint32_t read(uint32_t channelMask, int32_t* values) = 0;
+
+    // Channels in use. Backends whose channels share hardware (e.g. a common
+    // CLK line) stop waiting on the others; the default ignores it
+    virtual void setActiveChannels(uint32_t channelMask) {}
+
+    // Switch the conversion rate between 10 SPS and 80 SPS (HX711 RATE
+    // pin). Returns false when the rate is fixed by the wiring
+    virtual bool setHighRate(bool high) { return false; }
+
+    // Call handler(arg) from interrupt context when the channel has a new
+    // conversion. Returns false when the backend cannot signal data-ready,
+    // in which case the caller polls readyMask()
+    virtual bool attachDataReady(int channel, DataReadyHandler handler, void* arg) { return false; }
+};
+
+// Monotonic time source; both counters wrap like millis()/micros()
+class Clock {
+public:
+    virtual ~Clock() {}
+    virtual uint32_t millis() = 0;
+    virtual uint32_t micros() = 0;
+    virtual void delay(uint32_t ms) = 0;
+};
+
+// Namespaced key-value settings, modelled on Preferences. Writes made between
+// begin() and end() are committed together by end(), which returns false if
+// the commit failed
+class KeyValueStore {
+public:
+    virtual ~KeyValueStore() {}
+    virtual bool begin(const char* name, bool readOnly) = 0;
+    virtual bool end() = 0;
+    virtual bool isKey(const char* key) = 0;
+    virtual float getFloat(const char* key, float defaultValue) = 0;
+    virtual bool putFloat(const char* key, float value) = 0;
+    virtual int32_t getInt(const char* key, int32_t defaultValue) = 0;
+    virtual bool putInt(const char* key, int32_t value) = 0;
+    virtual uint32_t getUInt(const char* key, uint32_t defaultValue) = 0;
+    virtual bool putUInt(const char* key, uint32_t value) = 0;
+    virtual bool getBool(const char* key, bool defaultValue) = 0;
+
+    // Strings as written by Preferences::putString; false if missing or
+    // longer than size - 1
+    virtual bool getString(const char* key, char* buffer, size_t size) = 0;
+
+    // Blobs: getBytes returns the stored length, 0 if missing or larger
+    // than size
+    virtual size_t getBytes(const char* key, void* buffer, size_t size) = 0;
+    virtual bool putBytes(const char* key, const void* data, size_t length) = 0;
+
+    // Removing a key that does not exist succeeds
+    virtual bool remove(const char* key) = 0;
+};
+
+// Raw access to a region of NOR flash. Erasing a sector sets every byte to
+// 0xFF; writing can only clear bits, so a byte is written once per erase.
+// Offsets are relative to the start of the region
+class FlashDevice {
+public:
+    virtual ~FlashDevice() {}
+    virtual uint32_t getSize() = 0;         // 0 when the region is missing
+    virtual uint32_t getSectorSize() = 0;
+    virtual bool read(uint32_t offset, void* data, uint32_t length) = 0;
+    virtual bool write(uint32_t offset, const void* data, uint32_t length) = 0;
+    virtual bool eraseSector(uint32_t sector) = 0;
+};
+
+#endif // HAL_H
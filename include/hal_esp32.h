@@ -0,0 +1,90 @@
+#ifndef HAL_ESP32_H
+#define HAL_ESP32_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <nvs.h>
+#include <esp_partition.h>
+#include "config.h"
+#include "hal.h"
+#include "load_cell_bank.h"
+#include "shift_register_port.h"
+
+// The HX711 bank wired to the HX711_n_CLK/DOUT pins, read in lockstep
+class Esp32LoadCellAdc : public Hx711BankAdc {
+public:
+    Esp32LoadCellAdc();
+    void begin() override;
+    bool attachDataReady(int channel, DataReadyHandler handler, void* arg) override;
+    bool setHighRate(bool high) override; // HX711_RATE_PIN, shared by every HX711
+
+private:
+    Esp32GpioPort gpioPort;
+};
+
+// HX711_EXPANSION_CHANNELS HX711s on one shared CLK, their DOUTs read
+// through a 74HC165 chain. No data-ready interrupts; the sampler polls them
+class Esp32ExpansionAdc : public Hx711BankAdc {
+public:
+    Esp32ExpansionAdc();
+
+private:
+    Esp32GpioPort gpioPort;
+    ShiftRegisterInputPort inputs;
+};
+
+class ArduinoClock : public Clock {
+public:
+    uint32_t millis() override;
+    uint32_t micros() override;
+    void delay(uint32_t ms) override;
+};
+
+// NVS namespace access with one commit per begin()/end(). Values use the
+// same encodings as Preferences (float as a 4-byte blob, putLong as i32), so
+// settings written by either remain readable
+class NvsKeyValueStore : public KeyValueStore {
+public:
+    NvsKeyValueStore();
+    bool begin(const char* name, bool readOnly) override;
+    bool end() override;
+    bool isKey(const char* key) override;
+    float getFloat(const char* key, float defaultValue) override;
+    bool putFloat(const char* key, float value) override;
+    int32_t getInt(const char* key, int32_t defaultValue) override;
+    bool putInt(const char* key, int32_t value) override;
+    uint32_t getUInt(const char* key, uint32_t defaultValue) override;
+    bool putUInt(const char* key, uint32_t value) override;
+    bool getBool(const char* key, bool defaultValue) override;
+    bool getString(const char* key, char* buffer, size_t size) override;
+    size_t getBytes(const char* key, void* buffer, size_t size) override;
+    bool putBytes(const char* key, const void* data, size_t length) override;
+    bool remove(const char* key) override;
+
+private:
+    nvs_handle_t handle;
+    bool opened;
+    bool dirty;
+    bool failed;
+
+    bool track(esp_err_t err);
+};
+
+// A data partition found by label, accessed through esp_partition_*
+class Esp32PartitionFlash : public FlashDevice {
+public:
+    explicit Esp32PartitionFlash(const char* label);
+    bool begin();
+    uint32_t getSize() override;
+    uint32_t getSectorSize() override;
+    bool read(uint32_t offset, void* data, uint32_t length) override;
+    bool write(uint32_t offset, const void* data, uint32_t length) override;
+    bool eraseSector(uint32_t sector) override;
+
+private:
+    const char* label;
+    const esp_partition_t* partition;
+};
+#endif
+
+#endif // HAL_ESP32_H
@@ -0,0 +1,167 @@
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#ifndef ARDUINO
+#include <map>
+#include <string>
+#include <vector>
+#include "native_platform.h"
+#include "hal.h"
+
+#define SIMULATED_MAX_CHANNELS 32
+
+// Time advanced explicitly by the simulation; delay() just moves it forward,
+// so blocking waits in the sensor code cost no wall time
+class VirtualClock : public Clock {
+public:
+    VirtualClock();
+    uint32_t millis() override;
+    uint32_t micros() override;
+    void delay(uint32_t ms) override;
+    void advanceMicros(uint32_t us);
+    uint64_t nowMicros() const { return nowUs; }
+
+private:
+    uint64_t nowUs;
+};
+
+// Behaviour of one simulated HX711 and its load cell
+struct SimulatedLoadCell {
+    bool present;             // False: DOUT never goes low
+    bool stuck;               // Output railed at full scale
+    int32_t zeroCounts;       // Raw output with nothing on the cell
+    float countsPerKg;
+    float loadKg;
+    float noiseCounts;        // Gaussian noise sigma
+    float driftCountsPerHour; // Linear zero drift
+    float dropoutRate;        // Probability a conversion never signals ready
+    float glitchRate;         // Probability a conversion carries a spike
+    int32_t glitchCounts;     // Spike amplitude, random sign
+    uint32_t periodUs;        // Conversion period (10 SPS by default)
+};
+
+// Bank of simulated HX711 channels driven by a Clock. A conversion becomes
+// ready every periodUs; one not read before the next completes is
+// overwritten, as on the real part. Random behaviour comes from a seeded
+// xorshift generator, so a run is reproducible.
+class SimulatedLoadCellBank : public LoadCellAdc {
+public:
+    SimulatedLoadCellBank(Clock& clock, int channelCount, uint32_t seed = 1);
+    void begin() override;
+    int getChannelCount() override;
+    uint32_t readyMask() override;
+    uint32_t read(uint32_t channelMask, int32_t* values) override;
+    bool setHighRate(bool high) override;
+
+    SimulatedLoadCell& cell(int channel);
+    void setLoad(int channel, float kg);
+    uint32_t getCompletedConversions(int channel); // Including overwritten ones
+    void setRatePinWired(bool wired) { ratePinWired = wired; }
+    bool isHighRate() const { return highRate; }
+
+private:
+    Clock& clock;
+    int channelCount;
+    uint32_t rngState;
+    uint32_t startUs;
+    SimulatedLoadCell cells[SIMULATED_MAX_CHANNELS];
+    uint32_t nextConversionUs[SIMULATED_MAX_CHANNELS];
+    uint32_t completed[SIMULATED_MAX_CHANNELS];
+    uint32_t pending;
+    bool ratePinWired;
+    bool highRate;
+
+    void advance(uint32_t nowUs);
+    int32_t sample(int channel, uint32_t nowUs);
+    uint32_t nextRandom();
+    float nextUniform();
+    float nextGaussian();
+};
+
+// Settings kept in memory for the lifetime of the process. Writes are staged
+// and applied by end(), matching the one-commit semantics of the NVS store
+class MemoryKeyValueStore : public KeyValueStore {
+public:
+    MemoryKeyValueStore();
+    bool begin(const char* name, bool readOnly) override;
+    bool end() override;
+    bool isKey(const char* key) override;
+    float getFloat(const char* key, float defaultValue) override;
+    bool putFloat(const char* key, float value) override;
+    int32_t getInt(const char* key, int32_t defaultValue) override;
+    bool putInt(const char* key, int32_t value) override;
+    uint32_t getUInt(const char* key, uint32_t defaultValue) override;
+    bool putUInt(const char* key, uint32_t value) override;
+    bool getBool(const char* key, bool defaultValue) override;
+    bool getString(const char* key, char* buffer, size_t size) override;
+    size_t getBytes(const char* key, void* buffer, size_t size) override;
+    bool putBytes(const char* key, const void* data, size_t length) override;
+    bool remove(const char* key) override;
+    uint32_t getCommitCount() const { return commits; }
+
+    // A full partition: every put fails, and so does the end() of its
+    // session, while removals still go through, as with NVS
+    void setFull(bool full) { this->full = full; }
+
+    // Preferences-style values the interface only reads, for seeding
+    // settings left by older firmware
+    bool putString(const char* key, const char* value);
+    bool putBool(const char* key, bool value);
+
+private:
+    struct StagedValue {
+        bool removed;
+        std::string bytes;
+    };
+
+    std::map<std::string, std::string> committed;
+    std::map<std::string, StagedValue> staged;
+    std::string prefix;
+    bool opened;
+    bool writable;
+    bool full;
+    bool failed;
+    uint32_t commits;
+
+    bool lookup(const char* key, std::string& bytes);
+    bool lookupU32(const char* key, uint32_t& bits);
+    bool stage(const char* key, const void* data, size_t length, bool removed = false);
+};
+
+// NOR flash kept in an image file (created erased if missing). Writes AND
+// into the existing bytes, as on the real part. cutPowerAfter() arms a power
+// cut: once that many more bytes have been written or erased, the operation
+// in progress stops partway and every later one fails until restorePower(),
+// which stands in for the reboot
+class FileFlashDevice : public FlashDevice {
+public:
+    FileFlashDevice(const char* path, uint32_t size, uint32_t sectorSize);
+    ~FileFlashDevice();
+    uint32_t getSize() override;
+    uint32_t getSectorSize() override;
+    bool read(uint32_t offset, void* data, uint32_t length) override;
+    bool write(uint32_t offset, const void* data, uint32_t length) override;
+    bool eraseSector(uint32_t sector) override;
+
+    void cutPowerAfter(uint32_t bytes);
+    void restorePower();
+    bool isPowered() const { return powered; }
+    uint64_t getBytesWritten() const { return bytesWritten; }
+    uint32_t getEraseCount(uint32_t sector) const;
+
+private:
+    FILE* file;
+    std::vector<uint8_t> image;
+    std::vector<uint32_t> eraseCounts;
+    uint32_t sectorSize;
+    bool powered;
+    bool cutArmed;
+    uint32_t cutBudget;
+    uint64_t bytesWritten;
+
+    uint32_t takeBudget(uint32_t length);
+    void persist(uint32_t offset, uint32_t length);
+};
+#endif
+
+#endif // HAL_NATIVE_H
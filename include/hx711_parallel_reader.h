@@ -0,0 +1,91 @@
+#ifndef HX711_PARALLEL_READER_H
+#define HX711_PARALLEL_READER_H
+
+#include <stdint.h>
+
+// Lockstep reader for several HX711 amplifiers that each have their own
+// CLK/DOUT pair. All selected CLK lines are pulsed together and every DOUT
+// line is sampled with a single port read per bit, so one 24-bit conversion
+// is collected from every channel in the time a single HX711 normally takes.
+//
+// The reader only talks to hardware through GpioPort, which keeps the bit
+// unpacking kernel free of Arduino dependencies. Channels may share a CLK
+// line (e.g. several HX711s whose DOUTs sit behind a shift register); such a
+// group is only read when every active member has a conversion waiting.
+
+#define HX711_PARALLEL_MAX_CHANNELS 32
+#define HX711_DATA_BITS 24
+
+// Minimal GPIO access for pins 0-31 expressed as bitmasks. Output and input
+// bit numbers may refer to different pin spaces (see ShiftRegisterInputPort)
+class GpioPort {
+public:
+    virtual ~GpioPort() {}
+    virtual void configurePins(uint32_t outputMask, uint32_t inputMask) {} // Directions, outputs start low
+    virtual void setOutputs(uint32_t pinMask) = 0;   // Drive pins high
+    virtual void clearOutputs(uint32_t pinMask) = 0; // Drive pins low
+    virtual uint32_t readInputs() = 0;               // Level of all input pins
+    virtual void settle() {}                         // Hold a CLK level long enough for the HX711
+    virtual void beginFrame() {}                     // Enter the timing critical section
+    virtual void clearEdges(uint32_t pinMask) {}     // Drop edge interrupts latched by a readout
+    virtual void endFrame() {}                       // Leave the timing critical section
+};
+
+class HX711ParallelReader {
+public:
+    HX711ParallelReader();
+
+    // Pins are indexed by channel; gainPulses is 1/2/3 for gain 128/32/64
+    void begin(GpioPort* gpioPort, const int* clkPins, const int* doutPins, int channelCount, uint8_t gainPulses = 1);
+
+    // Bit i set when channel i can be read: its DOUT is low, and so is the
+    // DOUT of every other active channel on the same CLK line
+    uint32_t readyMask();
+
+    // Clock one conversion out of every channel in channelMask in lockstep.
+    // Channels sharing a CLK line with a selected channel are read as well.
+    // values[i] is written for each channel read; returns the mask actually read
+    uint32_t read(uint32_t channelMask, long* values);
+
+    // Channels taking part in shared-CLK groups; an absent or disabled HX711
+    // left out here no longer holds back the rest of its group
+    void setActiveChannels(uint32_t channelMask);
+
+    int getChannelCount() const { return channelCount; }
+    uint32_t getGroupMask(int channel) const { return groupMasks[channel]; }
+
+    // Transpose HX711_DATA_BITS port snapshots (MSB first) into one signed
+    // 24-bit value per channel
+    static void unpackFrames(const uint32_t* frames, const uint8_t* doutPins, int channelCount,
+                             uint32_t channelMask, long* values);
+
+private:
+    GpioPort* port;
+    int channelCount;
+    uint8_t gainPulses;
+    uint8_t doutPins[HX711_PARALLEL_MAX_CHANNELS];
+    uint32_t clkMasks[HX711_PARALLEL_MAX_CHANNELS];
+    uint32_t doutMasks[HX711_PARALLEL_MAX_CHANNELS];
+    uint32_t groupMasks[HX711_PARALLEL_MAX_CHANNELS]; // Active channels sharing the CLK line
+    bool sharedClock;
+
+    uint32_t clkMaskFor(uint32_t channelMask);
+    uint32_t doutMaskFor(uint32_t channelMask);
+};
+
+#ifdef ARDUINO
+// Direct register access to the ESP32 GPIO block (pins 0-31)
+class Esp32GpioPort : public GpioPort {
+public:
+    void setOutputs(uint32_t pinMask) override;
+    void clearOutputs(uint32_t pinMask) override;
+    uint32_t readInputs() override;
+    void configurePins(uint32_t outputMask, uint32_t inputMask) override;
+    void settle() override;
+    void beginFrame() override;
+    void clearEdges(uint32_t pinMask) override;
+    void endFrame() override;
+};
+#endif
+
+#endif // HX711_PARALLEL_READER_H
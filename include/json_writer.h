@@ -0,0 +1,46 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact JSON written straight into a caller-owned buffer, with no heap
+// use. Commas are placed automatically; nesting is not checked. Element
+// counts are accepted for symmetry with MsgPackWriter and ignored. Output
+// that does not fit sets overflowed() and the rest is dropped, so a
+// caller checks once at the end. Floats are written in fixed point
+// with trailing zeros trimmed (2.45, not 2.4500001). Free of Arduino
+// dependencies.
+class JsonWriter {
+public:
+    JsonWriter(char* buffer, size_t capacity);
+
+    void beginObject(size_t members = 0);
+    void endObject();
+    void beginArray(size_t items = 0);
+    void endArray();
+    void key(const char* name);     // name is written as is, without escaping
+
+    void value(const char* text);
+    void value(uint32_t number);
+    void value(int32_t number);
+    void value(float number, int decimals);  // null for NaN and infinities
+
+    // Bytes written, without a terminator (one is kept if there is room)
+    size_t length() const { return used; }
+    bool overflowed() const { return overflow; }
+
+private:
+    char* buffer;
+    size_t capacity;
+    size_t used;
+    bool overflow;
+    bool needComma;
+
+    void separate();
+    void put(char c);
+    void put(const char* text);
+    void putUnsigned(uint64_t number);
+};
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,70 @@
+#ifndef LINEAR_FIT_H
+#define LINEAR_FIT_H
+
+#include <math.h>
+
+// Incremental least-squares fit of y = offset + gain * x.
+//
+// Points are folded into running means and centred sums of squares
+// (Welford's method), so no history is kept and large raw HX711 counts do
+// not lose precision to cancellation.
+class LinearFit {
+public:
+    LinearFit() { reset(); }
+
+    void reset() {
+        n = 0;
+        meanX = 0.0;
+        meanY = 0.0;
+        sxx = 0.0;
+        sxy = 0.0;
+        syy = 0.0;
+    }
+
+    void add(double x, double y) {
+        n++;
+        double dx = x - meanX;
+        double dy = y - meanY;
+        meanX += dx / n;
+        meanY += dy / n;
+        sxx += dx * (x - meanX);
+        sxy += dx * (y - meanY);
+        syy += dy * (y - meanY);
+    }
+
+    int count() const { return n; }
+
+    // Needs at least two distinct x values
+    bool isSolvable() const { return n >= 2 && sxx > 0.0; }
+
+    double gain() const { return isSolvable() ? sxy / sxx : 0.0; }
+    double offset() const { return meanY - gain() * meanX; }
+
+    // Sum of squared residuals of the fitted line
+    double residualSumSquares() const {
+        if (!isSolvable()) return 0.0;
+        double ss = syy - gain() * sxy;
+        return ss > 0.0 ? ss : 0.0;
+    }
+
+    // Root-mean-square residual, in units of y
+    double residualRms() const {
+        return n > 0 ? sqrt(residualSumSquares() / n) : 0.0;
+    }
+
+    // Coefficient of determination; 1.0 for a perfect fit
+    double rSquared() const {
+        if (!isSolvable() || syy <= 0.0) return 0.0;
+        return 1.0 - residualSumSquares() / syy;
+    }
+
+private:
+    int n;
+    double meanX;
+    double meanY;
+    double sxx;
+    double sxy;
+    double syy;
+};
+
+#endif // LINEAR_FIT_H
@@ -0,0 +1,55 @@
+#ifndef LOAD_CELL_BANK_H
+#define LOAD_CELL_BANK_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "hx711_parallel_reader.h"
+
+#define COMPOSITE_MAX_BANKS 4
+
+// HX711 channels on any GpioPort, read in lockstep. Channels are added in
+// order; several may share one CLK pin
+class Hx711BankAdc : public LoadCellAdc {
+public:
+    Hx711BankAdc(GpioPort& port, uint8_t gainPulses = 1);
+    bool addChannel(int clkPin, int doutPin);
+
+    void begin() override;
+    int getChannelCount() override;
+    uint32_t readyMask() override;
+    uint32_t read(uint32_t channelMask, int32_t* values) override;
+    void setActiveChannels(uint32_t channelMask) override;
+
+protected:
+    GpioPort& port;
+    HX711ParallelReader reader;
+    int clkPins[HX711_PARALLEL_MAX_CHANNELS];
+    int doutPins[HX711_PARALLEL_MAX_CHANNELS];
+    int channelCount;
+    uint8_t gainPulses;
+};
+
+// Several banks presented as one, channels numbered bank after bank
+// (e.g. the on-board HX711s followed by the ones behind a shift register)
+class CompositeLoadCellAdc : public LoadCellAdc {
+public:
+    CompositeLoadCellAdc();
+    bool addBank(LoadCellAdc& bank);
+
+    void begin() override;
+    int getChannelCount() override;
+    uint32_t readyMask() override;
+    uint32_t read(uint32_t channelMask, int32_t* values) override;
+    bool attachDataReady(int channel, DataReadyHandler handler, void* arg) override;
+    void setActiveChannels(uint32_t channelMask) override;
+    bool setHighRate(bool high) override;
+
+private:
+    LoadCellAdc* banks[COMPOSITE_MAX_BANKS];
+    int offsets[COMPOSITE_MAX_BANKS];
+    uint32_t masks[COMPOSITE_MAX_BANKS]; // Bank channels in composite numbering
+    int bankCount;
+    int channelCount;
+};
+
+#endif // LOAD_CELL_BANK_H
@@ -0,0 +1,41 @@
+#ifndef MSGPACK_WRITER_H
+#define MSGPACK_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// MessagePack written straight into a caller-owned buffer, with no heap
+// use. Same calls as JsonWriter, so one payload template serves both,
+// except that maps and arrays need their element count up front.
+// Integers take the smallest encoding and floats are float32. Output that
+// does not fit sets overflowed(). Free of Arduino dependencies.
+class MsgPackWriter {
+public:
+    MsgPackWriter(uint8_t* buffer, size_t capacity);
+
+    void beginObject(size_t members);
+    void endObject() {}
+    void beginArray(size_t items);
+    void endArray() {}
+    void key(const char* name);
+
+    void value(const char* text);
+    void value(uint32_t number);
+    void value(int32_t number);
+    void value(float number, int decimals);  // decimals is ignored; float32
+
+    size_t length() const { return used; }
+    bool overflowed() const { return overflow; }
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    bool overflow;
+
+    void put(uint8_t byte);
+    void putBig(uint32_t value, int bytes);
+    void putContainer(size_t count, uint8_t fixBase, int fixLimit, uint8_t code16, uint8_t code32);
+};
+
+#endif // MSGPACK_WRITER_H
@@ -0,0 +1,45 @@
+#ifndef NATIVE_PLATFORM_H
+#define NATIVE_PLATFORM_H
+
+// Minimal stand-ins for the Arduino/FreeRTOS names the portable sensor code
+// uses, for env:native builds. Timing goes through the Clock HAL, so nothing
+// here keeps time.
+#ifndef ARDUINO
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+class NativeSerial {
+public:
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int written = vprintf(format, args);
+        va_end(args);
+        return written;
+    }
+
+    void print(const char* text) { fputs(text, stdout); }
+    void println(const char* text) { puts(text); }
+    void println() { putchar('\n'); }
+};
+
+static NativeSerial Serial __attribute__((unused));
+
+// Single-threaded on the host: no sampling task, no ISRs
+typedef void* TaskHandle_t;
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define IRAM_ATTR
+
+// Arduino random(min, max): min inclusive, max exclusive
+inline long random(long minValue, long maxValue) {
+    return maxValue > minValue ? minValue + rand() % (maxValue - minValue) : minValue;
+}
+#endif
+
+#endif // NATIVE_PLATFORM_H
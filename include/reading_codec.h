@@ -0,0 +1,98 @@
+#ifndef READING_CODEC_H
+#define READING_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+// MSB-first bit stream over a caller-owned buffer
+class BitWriter {
+public:
+    BitWriter(uint8_t* buffer, size_t capacity);
+    void reset();
+
+    // Append the low `bits` bits of value (1..32); false if it does not fit
+    bool write(uint32_t value, int bits);
+
+    size_t getBitCount() const { return bitCount; }
+    size_t getByteCount() const { return (bitCount + 7) / 8; }
+    size_t getRemainingBits() const { return capacity * 8 - bitCount; }
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t bitCount;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t length);
+
+    // Read `bits` bits (1..32) into value; false past the end
+    bool read(int bits, uint32_t& value);
+
+private:
+    const uint8_t* data;
+    size_t length;
+    size_t bitCount;
+};
+
+// Compressed block of sensor readings, decodable on its own.
+//
+// Per reading, with the previous reading of the same bin as reference:
+//   bin        '0' = previous reading's bin + 1, else '1' + 5 bits
+//   valid      1 bit
+//   timestamp  delta-of-delta of millis(), zigzag coded:
+//              '0' = 0, '10' + 7 bits, '110' + 9, '1110' + 12, '1111' + 32
+//   weight     delta of the weight in 1/READING_CODEC_UNITS_PER_KG kg,
+//              zigzag coded: '0' = 0, '10' + 4 bits, '110' + 8, '1110' + 16,
+//              '1111' + 32
+// The first reading of a bin in a block stores timestamp and weight as raw
+// 32-bit values. A bin reporting every 10 s with a steady weight costs
+// 4 bits; weights are rounded to the codec resolution (1 g by default).
+// Fixed-point deltas beat XOR-ing the float bits here because filtered
+// weights change in their low mantissa bits on every reading (see
+// tools/codec_bench).
+class ReadingEncoder {
+public:
+    // Worst case for one reading, so a full buffer is detected up front
+    static const int MAX_READING_BITS = 6 + 1 + 36 + 36;
+
+    ReadingEncoder(uint8_t* buffer, size_t capacity);
+    void reset();
+
+    // False (and nothing written) when the block has no room for it
+    bool add(const SensorReading& reading);
+
+    int getCount() const { return count; }
+    size_t getByteCount() const { return bits.getByteCount(); }
+
+private:
+    BitWriter bits;
+    int count;
+    int lastBin;
+    uint32_t seenBins;
+    uint32_t prevTimestamp[SENSOR_MAX_CHANNELS];
+    int32_t prevDelta[SENSOR_MAX_CHANNELS];
+    int32_t prevWeight[SENSOR_MAX_CHANNELS];
+};
+
+class ReadingDecoder {
+public:
+    // count is the number of readings the block holds, stored by the caller
+    ReadingDecoder(const uint8_t* data, size_t length, int count);
+
+    // False at the end of the block or on a corrupt stream
+    bool next(SensorReading& reading);
+
+private:
+    BitReader bits;
+    int remaining;
+    int lastBin;
+    uint32_t seenBins;
+    uint32_t prevTimestamp[SENSOR_MAX_CHANNELS];
+    int32_t prevDelta[SENSOR_MAX_CHANNELS];
+    int32_t prevWeight[SENSOR_MAX_CHANNELS];
+};
+
+#endif // READING_CODEC_H
@@ -0,0 +1,127 @@
+#ifndef READING_LOG_H
+#define READING_LOG_H
+
+#include <stdint.h>
+#include "config.h"
+#include "hal.h"
+#include "reading_codec.h"
+
+// Store-and-forward log of sensor readings on a dedicated flash region.
+//
+// Readings are compressed into a RAM block (reading_codec.h) and appended
+// to flash as one batch when MAX_BUFFERED_READINGS are waiting, the block
+// is full or the oldest has waited BUFFER_SAVE_INTERVAL. The uploader
+// drains the log oldest first with peek()/consume(). Reading timestamps
+// are millis() of the boot that logged them, so every batch records that
+// boot's number (ConfigStore::countBoot()) and a peek() never mixes boots.
+// All fields are little-endian.
+//
+//   Sector (one erase sector each, used as a ring in sequence order)
+//     0  u32      magic "SBL2" (sectors of the format without a boot
+//                 number, "SBRL", are not read and get reused)
+//     4  u32      sequence number, one higher for every sector opened
+//     8  u32      ~sequence
+//    12  batches, back to back; 0xFF up to the end of the sector
+//
+//   Batch header (16 bytes), followed by the compressed block
+//     0  u16      reading count (0xFFFF: nothing written here yet)
+//     2  u16      ~count
+//     4  u32      CRC-32 of the boot number and the block
+//     8  u16      0xFFFF while pending, cleared to 0 once uploaded
+//    10  u16      block length in bytes, at most READING_LOG_BLOCK_BYTES
+//    12  u32      boot number the readings were taken in; 0 if unknown
+//
+// Crash consistency comes from write order rather than a journal: a
+// batch's block is written before its header, so a power cut leaves
+// either a complete batch or one whose header is blank, torn or fails its
+// CRC, and those are skipped. A sector header is written only after the
+// sector is erased, and a sector is erased only when it is reused, so wear
+// spreads evenly over the ring. Marking a batch uploaded clears bits in
+// place. A power cut between an upload and its mark sends that batch
+// again; nothing is lost. When the ring is full the oldest sector is
+// reused and its pending readings are counted as dropped.
+class ReadingLog {
+public:
+    ReadingLog(FlashDevice& flash, Clock& clock);
+
+    // Scan the region and recover the append point and the oldest pending
+    // batch. Batches appended from now on are stamped with boot. Returns
+    // false if the region is missing or too small
+    bool mount(uint32_t boot);
+    bool isMounted() const { return mounted; }
+
+    // Queue readings in RAM; invalid ones are skipped. Appends a batch to
+    // flash once the block is full. Returns false if a flash write failed
+    bool append(const SensorReading* readings, int count);
+
+    // Append the RAM buffer if its oldest reading has waited long enough
+    bool service();
+
+    // Append whatever is in the RAM buffer now
+    bool flush();
+
+    // Oldest pending readings on flash, whole batches of a single boot
+    // only, at most maxReadings (at least MAX_BUFFERED_READINGS so any
+    // batch fits); boot is the boot they were taken in. consume() then
+    // marks the readings returned by the last peek() sent
+    int peek(SensorReading* out, int maxReadings, uint32_t& boot);
+    bool consume();
+
+    bool isEmpty() const { return encoder.getCount() == 0 && pendingCount == 0; }
+    uint32_t getPendingCount() const { return pendingCount; }   // On flash
+    int getBufferedCount() const { return encoder.getCount(); } // In RAM
+    uint32_t getDroppedCount() const { return droppedCount; }
+    uint32_t getCapacityBytes() const;                           // Block bytes
+
+private:
+    struct Position {
+        int sector;             // -1: none
+        uint32_t offset;
+    };
+
+    struct BatchHeader {
+        uint16_t count;
+        uint16_t countCheck;
+        uint32_t crc;
+        uint16_t state;
+        uint16_t length;
+        uint32_t boot;
+    };
+
+    FlashDevice& flash;
+    Clock& clock;
+    bool mounted;
+    uint32_t boot;
+    uint32_t sectorSize;
+    int sectorCount;
+
+    // Per-sector sequence number; 0 marks a sector without a valid header
+    uint32_t sectorSeq[READING_LOG_MAX_SECTORS];
+    uint32_t nextSeq;
+    int headSector;             // Sector being appended to, -1 if none
+    uint32_t appendOffset;      // sectorSize once the head is closed
+
+    Position cursor;            // Oldest batch that may still be pending
+    int peekBatches;            // Pending batches from the cursor returned by peek()
+
+    uint32_t pendingCount;
+    uint32_t droppedCount;
+
+    uint8_t block[READING_LOG_BLOCK_BYTES];
+    ReadingEncoder encoder;
+    uint32_t bufferedSinceMs;
+
+    bool readBatchHeader(const Position& pos, BatchHeader& header);
+    bool isValidBatch(const Position& pos, const BatchHeader& header);
+    static uint32_t batchCrc(uint32_t boot, const uint8_t* data, uint16_t length);
+    bool nextBatch(Position& pos, BatchHeader& header);
+    int nextSectorInOrder(int sector);
+    int oldestSector();
+    uint32_t countPending(int sector);
+    bool openNextSector();
+    bool writeBatch(const uint8_t* data, uint16_t length, int count);
+    bool markSent(const Position& pos);
+    bool isErased(uint32_t offset, uint32_t length);
+};
+
+#endif // READING_LOG_H
@@ -0,0 +1,64 @@
+#ifndef ROLLUP_TRACKER_H
+#define ROLLUP_TRACKER_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Summary of one bin's readings over one closed window. Times are device
+// millis()
+struct Rollup {
+    uint8_t binId;
+    uint8_t window;             // Index into ROLLUP_WINDOWS_MS
+    uint32_t startMs;           // Window start, a multiple of its length
+    uint32_t lengthMs;
+    uint32_t count;             // Readings in the window, at least one
+    float minKg;
+    float maxKg;
+    float meanKg;
+    float lastKg;
+    uint32_t lastMs;            // Time of the last reading
+};
+
+// Min/max/mean/count/last of one bin's filtered weight over each of the
+// ROLLUP_WINDOWS_MS window lengths.
+//
+// Every reading updates each open window in constant time (the mean is a
+// running mean, so it does not lose precision over an hour of readings).
+// A window runs from a multiple of its length to the next one and closes
+// when a reading or closeExpired() arrives past its end; a window that saw
+// no readings is not reported, and the next one opens at the next reading.
+// Free of Arduino dependencies.
+class RollupTracker {
+public:
+    RollupTracker();
+
+    // Drop the open windows, e.g. after the bin's zero or scale changed
+    void reset();
+
+    // Feed one reading. Windows it falls past the end of are written to
+    // closed (room for ROLLUP_WINDOW_COUNT, binId left to the caller)
+    // before it is counted; returns how many
+    int addReading(float weightKg, uint32_t timestampMs, Rollup* closed);
+
+    // Close the windows that ended by nowMs; same output as addReading()
+    int closeExpired(uint32_t nowMs, Rollup* closed);
+
+    static uint32_t windowLength(int window);
+
+private:
+    struct Window {
+        uint32_t startMs;
+        uint32_t count;
+        float minKg;
+        float maxKg;
+        float meanKg;
+        float lastKg;
+        uint32_t lastMs;
+    };
+
+    Window windows[ROLLUP_WINDOW_COUNT];
+    uint32_t openMask;          // Windows holding at least one reading
+    uint32_t nextEndMs;         // Earliest end of an open window
+};
+
+#endif // ROLLUP_TRACKER_H
@@ -0,0 +1,44 @@
+#ifndef SAMPLE_PROCESSOR_H
+#define SAMPLE_PROCESSOR_H
+
+#include <stdint.h>
+#include "config.h"
+#include "filter_pipeline.h"
+
+// Outlier rejection ahead of the filter, so a spike never enters its state
+typedef HampelStage<FILTER_HAMPEL_WINDOW, FILTER_HAMPEL_K10, FILTER_HAMPEL_MIN_MAD> OutlierStage;
+
+// Per-bin filter applied to every raw conversion. Swap or reorder stages here,
+// e.g. add KalmanStage<FILTER_KALMAN_Q, FILTER_KALMAN_R>
+typedef FilterChain<MedianStage<FILTER_MEDIAN_WINDOW>, EmaStage<FILTER_EMA_SHIFT> > SensorFilter;
+
+// Raw-count processing for one bin: outlier rejection, filtering, decimation to one reading per
+// HX711_SAMPLES_PER_READING conversions, conversion to kg and validation.
+// Free of Arduino dependencies so host tools replay exactly what the
+// firmware does.
+class SampleProcessor {
+public:
+    SampleProcessor();
+    
+    // Feed one raw conversion. Returns true when a reading is due, with the
+    // filtered count in filteredRaw
+    bool addConversion(int32_t raw, int32_t& filteredRaw);
+    void reset();
+    
+    // True when the last conversion was rejected as an outlier
+    bool lastRejected() const { return outliers.lastRejected(); }
+    
+    // Last conversion after outlier rejection, before the filter
+    int32_t lastSample() const { return cleaned; }
+    
+    static float toWeight(int32_t filteredRaw, int32_t offset, float scale);
+    static bool isValidWeight(float weight);
+
+private:
+    OutlierStage outliers;
+    SensorFilter filter;
+    int32_t cleaned;
+    uint8_t conversions;
+};
+
+#endif // SAMPLE_PROCESSOR_H
@@ -0,0 +1,125 @@
+#ifndef SAMPLE_TRACE_H
+#define SAMPLE_TRACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Binary trace of raw HX711 conversions, shared by the firmware recorder and
+// the host replay tool. All fields are little-endian.
+//
+//   Header (12 + 8 * N bytes; N = 8 in version 1, 32 in version 2)
+//     0  char[4]  magic "SBTR"
+//     4  u16      format version
+//     6  u8       number of bins described below
+//     7  u8       reserved (0)
+//     8  u32      device millis() when recording started
+//    12  i32[N]   tare offset per bin (raw counts)
+//  12+4N f32[N]   scale factor per bin (counts per kg)
+//
+//   Records (8 bytes each), in capture order
+//     0  u32      device millis() of the conversion
+//     4  u8       bin id
+//     5  i24      raw conversion
+
+#define SAMPLE_TRACE_MAGIC "SBTR"
+#define SAMPLE_TRACE_VERSION 2
+#define SAMPLE_TRACE_MAX_BINS 32
+#define SAMPLE_TRACE_HEADER_SIZE 268
+#define SAMPLE_TRACE_V1_BINS 8
+#define SAMPLE_TRACE_RECORD_SIZE 8
+
+struct SampleTraceHeader {
+    uint16_t version;
+    uint8_t binCount;
+    uint32_t startMillis;
+    int32_t offsets[SAMPLE_TRACE_MAX_BINS];
+    float scales[SAMPLE_TRACE_MAX_BINS];
+};
+
+struct SampleTraceRecord {
+    uint32_t timestampMs;
+    uint8_t binId;
+    int32_t raw;
+};
+
+inline void traceWriteU32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+inline uint32_t traceReadU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// Bins described by a header of the given version; 0 if unknown
+inline int traceHeaderBins(uint16_t version) {
+    if (version == 1) return SAMPLE_TRACE_V1_BINS;
+    if (version == SAMPLE_TRACE_VERSION) return SAMPLE_TRACE_MAX_BINS;
+    return 0;
+}
+
+inline size_t traceHeaderSize(uint16_t version) {
+    return 12 + 8 * traceHeaderBins(version);
+}
+
+inline void encodeTraceHeader(const SampleTraceHeader& header, uint8_t* out) {
+    memcpy(out, SAMPLE_TRACE_MAGIC, 4);
+    out[4] = (uint8_t)header.version;
+    out[5] = (uint8_t)(header.version >> 8);
+    out[6] = header.binCount;
+    out[7] = 0;
+    traceWriteU32(out + 8, header.startMillis);
+
+    for (int i = 0; i < SAMPLE_TRACE_MAX_BINS; i++) {
+        uint32_t scaleBits;
+        memcpy(&scaleBits, &header.scales[i], sizeof(scaleBits));
+        traceWriteU32(out + 12 + i * 4, (uint32_t)header.offsets[i]);
+        traceWriteU32(out + 12 + SAMPLE_TRACE_MAX_BINS * 4 + i * 4, scaleBits);
+    }
+}
+
+// Accepts version 1 traces too; in must hold traceHeaderSize(version) bytes,
+// which is at most SAMPLE_TRACE_HEADER_SIZE
+inline bool decodeTraceHeader(const uint8_t* in, SampleTraceHeader& header) {
+    if (memcmp(in, SAMPLE_TRACE_MAGIC, 4) != 0) {
+        return false;
+    }
+
+    header.version = (uint16_t)(in[4] | (in[5] << 8));
+    header.binCount = in[6];
+    header.startMillis = traceReadU32(in + 8);
+
+    int bins = traceHeaderBins(header.version);
+    for (int i = 0; i < SAMPLE_TRACE_MAX_BINS; i++) {
+        header.offsets[i] = 0;
+        header.scales[i] = 0.0f;
+        if (i >= bins) continue;
+
+        uint32_t scaleBits = traceReadU32(in + 12 + bins * 4 + i * 4);
+        header.offsets[i] = (int32_t)traceReadU32(in + 12 + i * 4);
+        memcpy(&header.scales[i], &scaleBits, sizeof(scaleBits));
+    }
+
+    return bins > 0 && header.binCount <= bins;
+}
+
+inline void encodeTraceRecord(const SampleTraceRecord& record, uint8_t* out) {
+    traceWriteU32(out, record.timestampMs);
+    out[4] = record.binId;
+    out[5] = (uint8_t)record.raw;
+    out[6] = (uint8_t)(record.raw >> 8);
+    out[7] = (uint8_t)(record.raw >> 16);
+}
+
+inline void decodeTraceRecord(const uint8_t* in, SampleTraceRecord& record) {
+    record.timestampMs = traceReadU32(in);
+    record.binId = in[4];
+
+    // Sign-extend the 24-bit conversion
+    uint32_t raw = (uint32_t)in[5] | ((uint32_t)in[6] << 8) | ((uint32_t)in[7] << 16);
+    record.raw = (int32_t)(raw << 8) >> 8;
+}
+
+#endif // SAMPLE_TRACE_H
@@ -1,51 +1,213 @@
 #ifndef SENSOR_MANAGER_H
 #define SENSOR_MANAGER_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
-#include <HX711.h>
-#include <Preferences.h>
+#else
+#include "native_platform.h"
+#endif
 #include "config.h"
+#include "hal.h"
+#include "config_store.h"
+#include "ring_buffer.h"
+#include "sample_processor.h"
+#include "linear_fit.h"
+#include "trace_recorder.h"
+#include "synthetic_scenario.h"
+#include "activity_scheduler.h"
+#include "weight_event_detector.h"
+#include "stability_tracker.h"
+#include "rollup_tracker.h"
+
+// Time from an HX711 data-ready edge until the conversion is clocked out,
+// in microseconds. Jitter is maxLatencyUs - minLatencyUs
+struct SamplingJitterStats {
+    uint32_t captures;
+    uint32_t minLatencyUs;
+    uint32_t maxLatencyUs;
+    float meanLatencyUs;
+    uint32_t droppedSamples;  // Samples lost because the queue was full
+};
+
+// Per-bin conversion accounting for the interrupt-driven sampler
+struct ConversionCounters {
+    uint32_t captured;
+    uint32_t missed;          // Conversions overwritten before they were read
+    uint32_t rejected;        // Conversions replaced by the outlier stage
+};
+
+// Outcome of a multi-point calibration session (raw = offset + scale * kg)
+struct CalibrationResult {
+    int binId;
+    int points;
+    float scaleFactor;        // Counts per kg
+    int32_t offset;           // Raw counts at 0 kg
+    float residualKg;         // RMS fit residual
+    float rSquared;
+};
 
 class SensorManager {
 public:
-    SensorManager();
+    SensorManager(LoadCellAdc& adc, Clock& clock, ConfigStore& config);
     void init();
     void update();
     SensorReading readSensor(int binId);
     SensorReading* getAllReadings();
     bool isSensorEnabled(int binId);
     void enableSensor(int binId, bool enabled);
-    void calibrateSensor(int binId, float knownWeight);
-    float generateDummyWeight(int binId); // For testing without actual sensors
+    // False, with the scale factor unchanged, if no reading came, it did not
+    // move CALIBRATION_MIN_COUNTS from tare, or it could not be saved
+    bool calibrateSensor(int binId, float knownWeight);
+    float generateDummyWeight(int binId); // Synthetic weight for TESTING_MODE, advanced by update()
     void setScaleFactor(int binId, float scaleFactor);
     float getScaleFactor(int binId);
     void saveScaleFactors();
     void loadScaleFactors();
+    void saveTareOffsets();
+    void loadTareOffsets();
+    bool requestTare(int binId);
+    
+    // Raw conversion trace on the flash filesystem (see sample_trace.h)
+    bool startTrace();
+    void stopTrace();
+    TraceRecorder& getTraceRecorder();
+    
+    // Multi-point calibration: begin, add two or more known weights (0 kg
+    // included), then finish to fit offset and scale and persist both
+    bool beginCalibration(int binId);
+    bool addCalibrationPoint(float knownWeight, int32_t* rawAverage = nullptr);
+    bool finishCalibration(CalibrationResult& result);
+    void cancelCalibration();
+    int getCalibrationBin();
+    int getChannelCount();          // Channels in the registry; valid bin ids are 0..count-1
     int getConnectedSensorCount();
     bool detectConnectedSensors();
+    bool startSamplingTask();
+    SamplingJitterStats getJitterStats();
+    ConversionCounters getConversionCounters(int binId);
+    bool isBinActive(int binId);    // Read at every conversion rather than at the idle interval
+    bool isHighRate();              // HX711s switched to 80 SPS
+    
+    // Last weight that held steady (see stability_tracker.h); false until
+    // the bin has settled since boot, a re-tare or a recalibration
+    bool getLastSettledWeight(int binId, float& weightKg, unsigned long* settledAt = nullptr);
+    bool isSettled(int binId);      // Steady now rather than mid-change
+    
+    // Deposit/removal/collection events detected by update(), oldest first
+    bool popEvent(WeightEvent& event);
+    uint32_t getDroppedEventCount();
+    
+    // Per-window min/max/mean rollups closed by update(), oldest first
+    bool popRollup(Rollup& rollup);
+    uint32_t getDroppedRollupCount();
 
 private:
-    HX711 sensors[MAX_BINS];
-    bool sensorEnabled[MAX_BINS];
-    float lastReadings[MAX_BINS];
-    unsigned long lastReadTime[MAX_BINS];
-    SensorReading readings[MAX_BINS];
-    float scaleFactors[MAX_BINS];
-    Preferences preferences;
-    
-    // Pin mappings for each sensor
-    int clkPins[MAX_BINS] = {
-        HX711_1_CLK_PIN, HX711_2_CLK_PIN, HX711_3_CLK_PIN,
-        HX711_4_CLK_PIN, HX711_5_CLK_PIN, HX711_6_CLK_PIN
-    };
+    LoadCellAdc& adc;
+    Clock& clock;
+    ConfigStore& config;
+    
+    // Per-channel registry, sized from the ADC at init(). Enabling is a
+    // request; the sampling context applies it to the active set
+    int channelCount;
+    volatile uint32_t enabledMask;
+    SensorReading* readings;
+    float* scaleFactors;
+    int32_t* tareOffsets;
+    bool* tareLoaded;
+    
+    // Hot per-sample state, dense over the active channels only, so a
+    // sampling cycle costs the same whatever the registry size. Indexed by
+    // slot; slotOf maps a channel to its slot (-1 when inactive). Owned by
+    // the sampling context
+    uint32_t activeMask;
+    int activeCount;
+    uint8_t* activeChannels;
+    int8_t* slotOf;
+    SampleProcessor* processors;
+    uint32_t* lastCaptureUs;
+    ConversionCounters* conversionCounters;
+    uint32_t pollOnlyMask;      // Active channels without a data-ready interrupt
+    uint32_t interruptMask;     // Channels with the ISR attached
+    
+    // Adaptive sampling: bins that are moving are read at every conversion
+    // and hold the HX711s at 80 SPS; idle bins are read every
+    // ADAPTIVE_IDLE_INTERVAL_MS. nextReadUs is indexed by slot
+    ActivityScheduler activity;
+    uint32_t* nextReadUs;
+    volatile uint32_t fullRateMask;
+    uint32_t resyncMask;        // Channels whose next capture restarts miss counting
+    volatile bool highRate;
+    uint32_t conversionPeriodUs;
+    
+    // Acquisition runs in its own task; completed samples reach the main
+    // loop through this queue and are applied to readings[] in update().
+    // Native builds have no task and poll from update()
+    TaskHandle_t samplingTask;
+    RingBuffer<SensorReading, SAMPLE_QUEUE_SIZE> sampleQueue;
+    SamplingJitterStats jitterStats;
+    double latencySumUs;
+    portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
     
-    int doutPins[MAX_BINS] = {
-        HX711_1_DOUT_PIN, HX711_2_DOUT_PIN, HX711_3_DOUT_PIN,
-        HX711_4_DOUT_PIN, HX711_5_DOUT_PIN, HX711_6_DOUT_PIN
+    // Data-ready interrupts: a falling edge on DOUT marks the bin pending
+    // and wakes the sampling task, which otherwise sleeps
+    struct DataReadyContext {
+        SensorManager* manager;
+        uint8_t binId;
     };
+    DataReadyContext* readyContexts;
+    volatile uint32_t pendingReady;
+    volatile uint32_t* readyAtUs;
+    portMUX_TYPE isrMux = portMUX_INITIALIZER_UNLOCKED;
+    
+    // Re-tare requests are applied by the sampling task on the bin's next
+    // reading; the new offsets are written to NVS from update()
+    volatile uint32_t tareRequests;
+    volatile uint32_t tareSavePending;
+    
+    // Bins whose scale factor changed; the sampling context rederives their
+    // activity threshold before the next conversion it reads
+    volatile uint32_t scaleUpdates;
+    
+    // Calibration session and raw-average capture (filled by the sampling task)
+    LinearFit calibrationFit;
+    int calibrationBin;
+    int captureBin;
+    int captureRemaining;
+    int64_t captureSum;
+    
+    // Reading history on the main loop side: a settled-weight tracker, an
+    // event detector and rollup windows per channel. A bin whose zero or
+    // scale changes starts all three over
+    StabilityTracker* stability;
+    WeightEventDetector* eventDetectors;
+    RingBuffer<WeightEvent, EVENT_QUEUE_SIZE> eventQueue;
+    RollupTracker* rollups;
+    RingBuffer<Rollup, ROLLUP_QUEUE_SIZE> rollupQueue;
+    volatile uint32_t historyResetRequests;
+    
+    TraceRecorder traceRecorder;
+    SyntheticScenario syntheticBins;
     
-    float smoothReading(int binId, float newReading);
-    bool isValidReading(float reading);
+    bool allocateChannels(int count);
+    void applyActiveChannels();
+    static void samplingTaskEntry(void* param);
+    void samplingLoop();
+    static void dataReadyIsr(void* arg);
+    void attachDataReadyInterrupts();
+    void recordCapture(int slot, uint32_t nowUs, bool fromInterrupt, uint32_t readyAt, bool rejected);
+    void pollSensors();
+    uint32_t dueChannels(uint32_t nowUs);
+    void updateSchedule(uint32_t nowMs);
+    void publishReading(int binId, int32_t filteredRaw);
+    void applyHistoryResets();
+    void requestScaleUpdate(int binId);
+    void recordHistory(const SensorReading& reading);
+    void closeRollups(uint32_t nowMs);
+    void queueRollups(int binId, Rollup* closed, int count);
+    void requestHistoryReset(int binId);
+    bool captureRawAverage(int binId, int samples, int32_t& average);
+    bool averageConversions(uint32_t mask, int samples, int32_t* averages);
+    bool saveCalibration(int binId);
 };
 
 #endif // SENSOR_MANAGER_H
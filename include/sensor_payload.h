@@ -0,0 +1,38 @@
+#ifndef SENSOR_PAYLOAD_H
+#define SENSOR_PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+// One snapshot of all bins in a batched upload: a run of valid readings
+struct SensorFrame {
+    uint32_t timestamp;
+    uint16_t first;             // Index of its first reading
+    uint16_t count;
+};
+
+// Wire formats of the sensor-data schema
+enum PayloadFormat {
+    PAYLOAD_JSON = 0,           // Weights with API_WEIGHT_DECIMALS decimals
+    PAYLOAD_MSGPACK             // Same maps and keys, weights as float32
+};
+
+const char* payloadContentType(PayloadFormat format);
+
+// Sensor-data request bodies, written into a caller-owned buffer without
+// heap use (see json_writer.h, msgpack_writer.h). Both return the
+// length, or 0 if the buffer is too small. Reading timestamps are
+// millis() of boot (ConfigStore::countBoot()); timestamp is millis() now,
+// and only relates to them when boot is the current boot.
+
+// {"sensor_data": [...], "device_id", "boot", "timestamp"}; invalid readings are left out
+size_t writeSensorData(PayloadFormat format, uint8_t* buffer, size_t capacity, const char* deviceId,
+                       uint32_t boot, uint32_t timestamp, const SensorReading* readings, int count);
+
+// {"device_id", "boot", "timestamp", "frames": [{"timestamp", "sensor_data": [...]}]}
+size_t writeSensorFrames(PayloadFormat format, uint8_t* buffer, size_t capacity, const char* deviceId,
+                         uint32_t boot, uint32_t timestamp, const SensorFrame* frames, int frameCount,
+                         const SensorReading* readings);
+
+#endif // SENSOR_PAYLOAD_H
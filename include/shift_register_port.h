@@ -0,0 +1,35 @@
+#ifndef SHIFT_REGISTER_PORT_H
+#define SHIFT_REGISTER_PORT_H
+
+#include <stdint.h>
+#include "hx711_parallel_reader.h"
+
+#define SHIFT_REGISTER_MAX_INPUTS 32
+
+// Inputs read through a chain of 74HC165 parallel-in/serial-out registers
+// driven from a base GpioPort. Outputs pass straight through to the base
+// port, so HX711 CLK lines stay on native pins while their DOUTs come in
+// through the chain. Input bit 8*r + k is input Dk of register r, register 0
+// being the one whose Q7 is wired to dataPin.
+class ShiftRegisterInputPort : public GpioPort {
+public:
+    ShiftRegisterInputPort(GpioPort& base, int loadPin, int clockPin, int dataPin, int inputCount);
+
+    void configurePins(uint32_t outputMask, uint32_t inputMask) override;
+    void setOutputs(uint32_t pinMask) override;
+    void clearOutputs(uint32_t pinMask) override;
+    uint32_t readInputs() override;
+    void settle() override;
+    void beginFrame() override;
+    void endFrame() override;
+    // No edge interrupts come through the chain, so clearEdges() stays a no-op
+
+private:
+    GpioPort& base;
+    uint32_t loadMask;
+    uint32_t clockMask;
+    uint32_t dataMask;
+    int registerCount;
+};
+
+#endif // SHIFT_REGISTER_PORT_H
@@ -0,0 +1,48 @@
+#ifndef STABILITY_TRACKER_H
+#define STABILITY_TRACKER_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Settled-weight tracker for one bin's filtered readings.
+//
+// Readings are collected into a window with a running mean and variance.
+// A reading that takes the standard deviation of the window above
+// SETTLE_MAX_STDDEV_KG (a bag still swinging, an item being put in) starts
+// the window over from itself. Once a window has lasted SETTLE_WINDOW_MS
+// with at least SETTLE_MIN_READINGS readings, its mean is settled and the
+// next window begins. The reported settled weight only moves when a new
+// mean differs from it by MIN_WEIGHT_CHANGE or more, so slow jitter does
+// not show up as a change. Free of Arduino dependencies.
+class StabilityTracker {
+public:
+    StabilityTracker();
+    void reset();
+
+    // Feed one reading; returns true when the settled weight changed
+    bool addReading(float weightKg, uint32_t timestampMs);
+
+    // Steady now: the current window has not been broken since the last
+    // settle. False while a change is in progress
+    bool isSettled() const { return settled; }
+
+    // Last settled weight and when it was last confirmed; false if the bin
+    // has not settled since the last reset
+    bool getLastSettled(float& weightKg, uint32_t* timestampMs = nullptr) const;
+
+private:
+    bool settled;
+    bool hasSettled;
+    float settledKg;
+    uint32_t settledMs;
+
+    // Current window (Welford running mean and sum of squared deviations)
+    uint32_t windowStartMs;
+    uint16_t windowCount;
+    float windowMean;
+    float windowM2;
+
+    void restartWindow(float weightKg, uint32_t timestampMs);
+};
+
+#endif // STABILITY_TRACKER_H
@@ -0,0 +1,68 @@
+#ifndef SYNTHETIC_SCENARIO_H
+#define SYNTHETIC_SCENARIO_H
+
+#include <stdint.h>
+
+// Deterministic synthetic bin weights for TESTING_MODE and host load tests.
+//
+// Every bin gets a profile and parameters derived only from (seed, bin
+// index), so bin k behaves the same whatever the fleet size. State is kept
+// as one array per field and step() runs a straight-line pass over all bins
+// for the level and noise updates, which compilers vectorize; only the rare
+// collection/restock/deposit events take a branchy pass. The same seed and
+// the same sequence of step() times reproduce the same stream.
+
+enum SyntheticProfile {
+    SYNTHETIC_STEADY = 0,  // Constant level, noise only
+    SYNTHETIC_FILLING,     // Steady fill, collected when it reaches capacity
+    SYNTHETIC_EMPTYING,    // Steady draw-down, restocked when empty
+    SYNTHETIC_DEPOSITS,    // Discrete deposits at random intervals, collected when full
+    SYNTHETIC_PROFILE_COUNT
+};
+
+class SyntheticScenario {
+public:
+    SyntheticScenario();
+    ~SyntheticScenario();
+
+    // Allocate and seed binCount bins; the scenario starts at startMs
+    bool begin(uint32_t binCount, uint64_t seed, uint32_t startMs);
+    void end();
+
+    // Advance every bin to nowMs and draw a new noisy weight for each
+    void step(uint32_t nowMs);
+
+    uint32_t getBinCount() const { return binCount; }
+    const float* weights() const { return output; }   // Noisy weights of the last step, kg
+    float weight(uint32_t bin) const { return bin < binCount ? output[bin] : 0.0f; }
+    float trueLevel(uint32_t bin) const { return bin < binCount ? level[bin] : 0.0f; }
+    SyntheticProfile profile(uint32_t bin) const;
+    uint32_t getEventCount() const { return events; } // Collections, restocks and deposits so far
+
+private:
+    uint32_t binCount;
+    uint32_t lastMs;
+    uint32_t events;
+
+    // Per-bin state, one array per field
+    uint8_t* profiles;
+    float* level;          // Noise-free weight, kg
+    float* ratePerMs;      // Fill (+) or draw-down (-) rate, kg/ms
+    float* capacity;       // Collected at (filling, deposits) or restocked to (emptying), kg
+    float* residual;       // Left in the bin after a collection, kg
+    float* noiseSigma;     // kg
+    float* depositMean;    // kg
+    uint32_t* depositIntervalMs;
+    uint32_t* nextEventMs;
+    uint32_t* rngState;
+    float* output;
+
+    SyntheticScenario(const SyntheticScenario&);
+    SyntheticScenario& operator=(const SyntheticScenario&);
+
+    void applyEvents(uint32_t bin, uint32_t nowMs);
+    static uint32_t nextRandom(uint32_t& state);
+    static float nextUnit(uint32_t& state);
+};
+
+#endif // SYNTHETIC_SCENARIO_H
@@ -0,0 +1,55 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <FS.h>
+#else
+#include "native_platform.h"
+#endif
+#include "config.h"
+#include "ring_buffer.h"
+#include "sample_trace.h"
+
+// Records raw HX711 conversions to TRACE_FILE_PATH on LittleFS.
+//
+// record() is called from the sampling task and only queues the sample;
+// service() runs in the main loop and does the flash writes, so filesystem
+// latency never reaches acquisition. Native builds write the same format to
+// the working directory.
+class TraceRecorder {
+public:
+    TraceRecorder();
+    bool start(const SampleTraceHeader& header);
+    void stop();
+    bool isRecording();
+    void record(uint32_t timestampMs, uint8_t binId, int32_t raw);
+    void service();
+    uint32_t getRecordCount();
+    uint32_t getDroppedCount();
+    size_t getFileSize();
+#ifdef ARDUINO
+    void dump(Print& out); // Hex dump of the last trace for the replay tool
+#endif
+
+private:
+    RingBuffer<SampleTraceRecord, TRACE_QUEUE_SIZE> queue;
+#ifdef ARDUINO
+    File file;
+#else
+    FILE* file;
+#endif
+    volatile bool recording;
+    bool stopRequested;
+    bool fsMounted;
+    uint32_t recordCount;
+    size_t bytesWritten;
+
+    bool mount();
+    bool openFile();
+    void writeFile(const uint8_t* data, size_t length);
+    void closeFile();
+    void drainQueue();
+};
+
+#endif // TRACE_RECORDER_H
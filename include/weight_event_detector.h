@@ -0,0 +1,67 @@
+#ifndef WEIGHT_EVENT_DETECTOR_H
+#define WEIGHT_EVENT_DETECTOR_H
+
+#include <stdint.h>
+#include "config.h"
+
+enum WeightEventType {
+    WEIGHT_EVENT_DEPOSIT = 0,   // Weight went up
+    WEIGHT_EVENT_REMOVAL,       // Weight went down, something is left
+    WEIGHT_EVENT_COLLECTION     // Weight went down to (near) empty
+};
+
+// A settled change of a bin's weight. Times are device millis()
+struct WeightEvent {
+    uint8_t binId;
+    uint8_t type;               // WeightEventType
+    float beforeKg;             // Settled weight before the change
+    float afterKg;              // Settled weight after it
+    uint32_t startMs;           // Last quiet reading before the change
+    uint32_t settledMs;         // When the new weight settled
+};
+
+// Change-point detector for one bin's filtered weight.
+//
+// While the weight is settled, a two-sided CUSUM accumulates deviations
+// from the baseline beyond EVENT_CUSUM_SLACK_KG per reading; crossing
+// EVENT_CUSUM_THRESHOLD_KG opens a change. The change closes once the
+// readings stay within EVENT_SETTLE_BAND_KG for EVENT_SETTLE_MS, and an
+// event is emitted if the settled weight moved by at least
+// EVENT_MIN_DELTA_KG; smaller moves (drift) just become the new baseline.
+// Free of Arduino dependencies so recorded traces replay through it.
+class WeightEventDetector {
+public:
+    WeightEventDetector();
+    void reset();
+
+    // Feed one reading; returns true with event filled (binId left to the
+    // caller) when a change has settled
+    bool addReading(float weightKg, uint32_t timestampMs, WeightEvent& event);
+
+    bool isSettled() const { return state == STATE_SETTLED; }
+    float getBaseline() const { return baseline; }
+
+    static const char* typeName(uint8_t type);
+
+private:
+    enum State { STATE_STARTING, STATE_SETTLED, STATE_CHANGING };
+
+    uint8_t state;
+    float baseline;
+    float cusumHigh;
+    float cusumLow;
+    uint32_t lastQuietMs;       // Last reading with both CUSUMs at zero
+    uint32_t changeStartMs;
+
+    // Settle window: readings since windowStartMs, all within the band
+    uint32_t windowStartMs;
+    uint16_t windowCount;
+    float windowMin;
+    float windowMax;
+    float windowSum;
+
+    void restartWindow(float weightKg, uint32_t timestampMs);
+    bool settle(float weightKg, uint32_t timestampMs, float& settledKg);
+};
+
+#endif // WEIGHT_EVENT_DETECTOR_H
@@ -0,0 +1,103 @@
+#include "activity_scheduler.h"
+#include <math.h>
+
+// Weight of a new conversion in the running mean and variance: 1/8
+#define ACTIVITY_EWMA_SHIFT 3
+
+ActivityScheduler::ActivityScheduler() {
+    reset(0, 0);
+}
+
+void ActivityScheduler::reset(int count, uint32_t nowMs) {
+    if (count < 0) count = 0;
+    if (count > SENSOR_MAX_CHANNELS) count = SENSOR_MAX_CHANNELS;
+
+    this->count = count;
+    activeSlots = count >= 32 ? 0xFFFFFFFFUL : (1UL << count) - 1;
+    seededSlots = 0;
+    suspectSlots = 0;
+    transitions = 0;
+
+    for (int i = 0; i < SENSOR_MAX_CHANNELS; i++) {
+        mean[i] = 0;
+        variance[i] = 0;
+        lastMovementMs[i] = nowMs;
+        setScale(i, HX711_DEFAULT_SCALE_FACTOR);
+    }
+}
+
+void ActivityScheduler::setScale(int slot, float countsPerKg) {
+    if (slot < 0 || slot >= SENSOR_MAX_CHANNELS) {
+        return;
+    }
+    // A spread of ADAPTIVE_ACTIVITY_KG is at least one count
+    double counts = fabs(ADAPTIVE_ACTIVITY_KG * (double)countsPerKg);
+    if (counts < 1.0) counts = 1.0;
+    if (counts > 16777216.0) counts = 16777216.0;     // The 24-bit range
+    threshold[slot] = (uint64_t)(counts * counts);
+}
+
+bool ActivityScheduler::observe(int slot, int32_t counts, uint32_t nowMs) {
+    if (slot < 0 || slot >= count) {
+        return false;
+    }
+
+    uint32_t bit = 1UL << slot;
+    if (!(seededSlots & bit)) {
+        mean[slot] = counts;
+        variance[slot] = 0;
+        seededSlots |= bit;
+        return false;
+    }
+
+    // West's incremental EWMA variance: a step shows up at once, noise
+    // settles near its own variance. Conversions are 24-bit, so a squared
+    // delta fits 49 bits
+    int32_t delta = counts - mean[slot];
+    uint64_t grown = variance[slot] + (((uint64_t)((int64_t)delta * delta)) >> ACTIVITY_EWMA_SHIFT);
+    uint64_t nextVariance = grown - (grown >> ACTIVITY_EWMA_SHIFT);
+    bool moving = nextVariance > threshold[slot];
+
+    // Conversions arrive unfiltered, so one that moves is held back until
+    // the next conversion (read at once) agrees; a lone spike is dropped
+    if (moving && !(suspectSlots & bit)) {
+        suspectSlots |= bit;
+        return false;
+    }
+    suspectSlots &= ~bit;
+
+    mean[slot] += delta / (1 << ACTIVITY_EWMA_SHIFT);
+    variance[slot] = nextVariance;
+
+    if (!moving) {
+        return false;
+    }
+
+    lastMovementMs[slot] = nowMs;
+    if (activeSlots & bit) {
+        return false;
+    }
+    activeSlots |= bit;
+    transitions++;
+    return true;
+}
+
+bool ActivityScheduler::expire(uint32_t nowMs) {
+    bool changed = false;
+    for (uint32_t bits = activeSlots; bits; bits &= bits - 1) {
+        int slot = __builtin_ctz(bits);
+        if (nowMs - lastMovementMs[slot] >= ADAPTIVE_HOLD_MS) {
+            activeSlots &= ~(1UL << slot);
+            transitions++;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+uint32_t ActivityScheduler::getIntervalUs(int slot) const {
+    if (isActive(slot) || (suspectSlots & (1UL << slot))) {
+        return 0;
+    }
+    return (uint32_t)ADAPTIVE_IDLE_INTERVAL_MS * 1000;
+}
@@ -1,15 +1,35 @@
 #include "api_client.h"
 #include <WiFi.h>
 
-APIClient::APIClient() {
+// Worst case of a full batch: about 75 bytes per reading, 45 per frame
+// (JSON; MessagePack is smaller)
+static_assert(API_PAYLOAD_BUFFER_BYTES >= UPLOAD_BATCH_MAX_READINGS * 75 + UPLOAD_BATCH_MAX_FRAMES * 45 + 256,
+              "API_PAYLOAD_BUFFER_BYTES cannot hold a full upload batch");
+
+APIClient::APIClient(ConfigStore& config) : config(config) {
     authenticated = false;
     apiKey = "";
     apiUrl = "";
     deviceId = "";
+    lastRequestEnd = 0;
+    memset(&connectionStats, 0, sizeof(connectionStats));
+    batchFrameCount = 0;
+    batchReadingCount = 0;
+    lastFrameSize = 0;
+    batchStart = 0;
+    sensorFormat = API_MSGPACK_ENABLED ? PAYLOAD_MSGPACK : PAYLOAD_JSON;
+    binaryAccepted = false;
+#if API_GZIP_ENABLED
+    compressRequests = true;
+    gzipAccepted = false;
+#endif
+    lastStatusCode = 0;
 }
 
 void APIClient::init() {
-    preferences.begin(NVS_NAMESPACE, true); // Read-only mode
+    // No CA is configured; HTTPClient::begin(url) did not verify the server either
+    tlsClient.setInsecure();
+    tlsClient.setHandshakeTimeout(API_REQUEST_TIMEOUT / 1000);
     loadCredentials();
     Serial.println("API Client initialized");
 }
@@ -27,6 +47,14 @@ bool APIClient::authenticate() {
     
     Serial.println("Authenticating with API...");
     
+    // When enabled, offer the binary format again; the server may have changed
+    sensorFormat = API_MSGPACK_ENABLED ? PAYLOAD_MSGPACK : PAYLOAD_JSON;
+    binaryAccepted = false;
+#if API_GZIP_ENABLED
+    compressRequests = true;
+    gzipAccepted = false;
+#endif
+    
     // Test connection with a simple health check
     authenticated = testConnection();
     
@@ -39,7 +67,7 @@ bool APIClient::authenticate() {
     return authenticated;
 }
 
-bool APIClient::submitSensorData(SensorReading* readings, int count) {
+bool APIClient::submitSensorData(SensorReading* readings, int count, uint32_t boot) {
     if (!authenticated) {
         Serial.println("Not authenticated, cannot submit data");
         return false;
@@ -50,17 +78,157 @@ bool APIClient::submitSensorData(SensorReading* readings, int count) {
         return false;
     }
     
-    String payload = createSensorDataPayload(readings, count);
+    return postSensorPayload(readings, count, nullptr, 0, boot);
+}
+
+bool APIClient::postSensorPayload(const SensorReading* readings, int count, const SensorFrame* frames, int frameCount,
+                                  uint32_t boot) {
     String response;
+    for (;;) {
+        size_t length = frames ?
+            writeSensorFrames(sensorFormat, payloadBuffer, sizeof(payloadBuffer), deviceId.c_str(), boot,
+                              millis(), frames, frameCount, readings) :
+            writeSensorData(sensorFormat, payloadBuffer, sizeof(payloadBuffer), deviceId.c_str(), boot,
+                            millis(), readings, count);
+        if (length == 0) {
+            Serial.printf("Sensor data for %d readings does not fit the payload buffer\n", count);
+            return false;
+        }
+        
+        Serial.printf("Submitting sensor data: %d frames, %d readings, %u bytes %s\n", frames ? frameCount : 1,
+                     count, (unsigned)length, sensorFormat == PAYLOAD_MSGPACK ? "MessagePack" : "JSON");
+        
+        bool success = makeRequest(API_SENSOR_DATA_ENDPOINT, "POST", payloadBuffer, length,
+                                   payloadContentType(sensorFormat), response);
+        if (success) {
+            binaryAccepted |= sensorFormat == PAYLOAD_MSGPACK;
+            Serial.printf("Sensor data submitted successfully: %s\n", response.c_str());
+            return true;
+        }
+        
+        // A server without MessagePack support gets the same data as JSON right away
+        bool refused = lastStatusCode == 415 ||
+                       (!binaryAccepted && (lastStatusCode == 400 || lastStatusCode == 422));
+        if (sensorFormat == PAYLOAD_MSGPACK && refused) {
+            Serial.printf("Server refused MessagePack (HTTP %d), sending JSON from now on\n", lastStatusCode);
+            sensorFormat = PAYLOAD_JSON;
+            continue;
+        }
+        Serial.printf("Failed to submit sensor data: %s\n", response.c_str());
+        return false;
+    }
+}
+
+bool APIClient::addSensorFrame(const SensorReading* readings, int count) {
+    int valid = 0;
+    for (int i = 0; i < count; i++) {
+        if (readings[i].valid) valid++;
+    }
+    if (valid == 0) {
+        return true;    // Nothing to upload in this frame
+    }
+    if (batchFrameCount >= UPLOAD_BATCH_MAX_FRAMES || batchReadingCount + valid > UPLOAD_BATCH_MAX_READINGS) {
+        return false;
+    }
     
-    Serial.printf("Submitting sensor data: %s\n", payload.c_str());
+    if (batchFrameCount == 0) {
+        batchStart = millis();
+    }
+    SensorFrame& frame = batchFrames[batchFrameCount++];
+    frame.timestamp = millis();
+    frame.first = batchReadingCount;
+    frame.count = valid;
+    for (int i = 0; i < count; i++) {
+        if (readings[i].valid) {
+            batchReadings[batchReadingCount++] = readings[i];
+        }
+    }
+    lastFrameSize = valid;
+    return true;
+}
+
+bool APIClient::isBatchDue() {
+    if (batchFrameCount == 0) {
+        return false;
+    }
+    // Also due when the next frame of the same size would not fit
+    return batchFrameCount >= config.getUploadBatchFrames() ||
+           batchFrameCount >= UPLOAD_BATCH_MAX_FRAMES ||
+           batchReadingCount + lastFrameSize > UPLOAD_BATCH_MAX_READINGS ||
+           millis() - batchStart >= config.getUploadBatchMaxDelayMs();
+}
+
+bool APIClient::flushSensorFrames() {
+    if (batchFrameCount == 0) {
+        return true;
+    }
+    if (!authenticated || WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+    
+    // A batch of one keeps the single-snapshot schema. Held frames are
+    // always from this boot; after a restart they are in the reading log
+    uint32_t boot = config.getBootCount();
+    bool success = batchFrameCount == 1 ?
+        postSensorPayload(batchReadings, batchReadingCount, nullptr, 0, boot) :
+        postSensorPayload(batchReadings, batchReadingCount, batchFrames, batchFrameCount, boot);
+    if (success) {
+        clearHeldFrames();
+    }
+    return success;
+}
+
+const SensorReading* APIClient::getHeldReadings(int& count) {
+    count = batchReadingCount;
+    return batchReadings;
+}
+
+int APIClient::getHeldFrameCount() {
+    return batchFrameCount;
+}
+
+void APIClient::clearHeldFrames() {
+    batchFrameCount = 0;
+    batchReadingCount = 0;
+}
+
+bool APIClient::submitEvents(const WeightEvent* events, int count) {
+    if (!authenticated || WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+    
+    String payload = createEventsPayload(events, count);
+    String response;
     
-    bool success = makeRequest(API_SENSOR_DATA_ENDPOINT, "POST", payload, response);
+    Serial.printf("Submitting %d bin events: %s\n", count, payload.c_str());
+    
+    bool success = makeRequest(API_EVENTS_ENDPOINT, "POST", payload, response);
     
     if (success) {
-        Serial.printf("Sensor data submitted successfully: %s\n", response.c_str());
+        Serial.printf("Bin events submitted successfully: %s\n", response.c_str());
     } else {
-        Serial.printf("Failed to submit sensor data: %s\n", response.c_str());
+        Serial.printf("Failed to submit bin events: %s\n", response.c_str());
+    }
+    
+    return success;
+}
+
+bool APIClient::submitRollups(const Rollup* rollups, int count) {
+    if (!authenticated || WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+    
+    String payload = createRollupsPayload(rollups, count);
+    String response;
+    
+    Serial.printf("Submitting %d bin rollups: %s\n", count, payload.c_str());
+    
+    bool success = makeRequest(API_ROLLUPS_ENDPOINT, "POST", payload, response);
+    
+    if (success) {
+        Serial.printf("Bin rollups submitted successfully: %s\n", response.c_str());
+    } else {
+        Serial.printf("Failed to submit bin rollups: %s\n", response.c_str());
     }
     
     return success;
@@ -87,53 +255,216 @@ void APIClient::setCredentials(const String& newApiKey, const String& newApiUrl,
     apiUrl = newApiUrl;
     deviceId = newDeviceId;
     authenticated = false; // Reset authentication status
+    disconnect();
+}
+
+void APIClient::disconnect() {
+    tlsClient.stop();
+    plainClient.stop();
+}
+
+ApiConnectionStats APIClient::getConnectionStats() {
+    return connectionStats;
+}
+
+WiFiClient& APIClient::transport() {
+    if (apiUrl.startsWith("https://")) {
+        return tlsClient;
+    }
+    return plainClient;
+}
+
+bool APIClient::openConnection() {
+    // Host and port out of scheme://host[:port]/path
+    bool secure = apiUrl.startsWith("https://");
+    int hostStart = apiUrl.indexOf("://");
+    if (hostStart < 0) {
+        return false;
+    }
+    hostStart += 3;
+    int hostEnd = apiUrl.indexOf('/', hostStart);
+    String host = hostEnd < 0 ? apiUrl.substring(hostStart) : apiUrl.substring(hostStart, hostEnd);
+    uint16_t port = secure ? 443 : 80;
+    int colon = host.indexOf(':');
+    if (colon >= 0) {
+        port = host.substring(colon + 1).toInt();
+        host = host.substring(0, colon);
+    }
+    
+    WiFiClient& client = transport();
+    client.stop();
+    unsigned long start = millis();
+    bool connected = client.connect(host.c_str(), port);
+    uint32_t elapsed = millis() - start;
+    
+    if (!connected) {
+        connectionStats.failedHandshakes++;
+        Serial.printf("API connection to %s:%u failed after %lu ms\n", host.c_str(), port, (unsigned long)elapsed);
+        return false;
+    }
+    connectionStats.handshakes++;
+    connectionStats.lastHandshakeMs = elapsed;
+    connectionStats.totalHandshakeMs += elapsed;
+    if (elapsed > connectionStats.maxHandshakeMs) connectionStats.maxHandshakeMs = elapsed;
+    Serial.printf("API connection to %s:%u opened in %lu ms\n", host.c_str(), port, (unsigned long)elapsed);
+    return true;
 }
 
 bool APIClient::makeRequest(const String& endpoint, const String& method, const String& payload, String& response) {
-    http.begin(apiUrl + endpoint);
-    http.addHeader("Content-Type", "application/json");
-    http.addHeader("Authorization", "Bearer " + apiKey);
-    http.setTimeout(API_REQUEST_TIMEOUT);
+    return makeRequest(endpoint.c_str(), method.c_str(), (const uint8_t*)payload.c_str(), payload.length(),
+                       "application/json", response);
+}
+
+bool APIClient::makeRequest(const char* endpoint, const char* method, const uint8_t* body, size_t length,
+                            const char* contentType, String& response) {
+#if API_GZIP_ENABLED
+    if (!compressRequests || length < API_GZIP_MIN_BYTES || strcmp(method, "POST") != 0) {
+        return sendRequest(endpoint, method, body, length, contentType, nullptr, response);
+    }
     
-    int httpResponseCode;
+    unsigned long start = micros();
+    gzip.begin(compressedBuffer, sizeof(compressedBuffer));
+    gzip.write(body, length);
+    gzip.finish();
+    uint32_t elapsed = micros() - start;
+    if (gzip.overflowed() || gzip.length() >= length) {
+        return sendRequest(endpoint, method, body, length, contentType, nullptr, response);
+    }
     
-    if (method == "POST") {
-        httpResponseCode = http.POST(payload);
-    } else if (method == "GET") {
-        httpResponseCode = http.GET();
-    } else {
-        http.end();
+    connectionStats.compressedRequests++;
+    connectionStats.uncompressedBytes += length;
+    connectionStats.compressedBytes += gzip.length();
+    connectionStats.totalCompressUs += elapsed;
+    Serial.printf("Request body gzipped: %u -> %u bytes in %lu us\n", (unsigned)length, (unsigned)gzip.length(),
+                  (unsigned long)elapsed);
+    if (sendRequest(endpoint, method, compressedBuffer, gzip.length(), contentType, "gzip", response)) {
+        gzipAccepted = true;
+        return true;
+    }
+    
+    // A server that may not take gzip gets the body again uncompressed.
+    // Only if that goes through was it the encoding that was refused
+    bool refused = lastStatusCode == 415 ||
+                   (!gzipAccepted && (lastStatusCode == 400 || lastStatusCode == 422));
+    if (!refused) {
+        return false;
+    }
+    int compressedStatus = lastStatusCode;
+    if (!sendRequest(endpoint, method, body, length, contentType, nullptr, response)) {
+        return false;
+    }
+    Serial.printf("Server refused gzip (HTTP %d), sending uncompressed from now on\n", compressedStatus);
+    compressRequests = false;
+    return true;
+#else
+    return sendRequest(endpoint, method, body, length, contentType, nullptr, response);
+#endif
+}
+
+bool APIClient::sendRequest(const char* endpoint, const char* method, const uint8_t* body, size_t length,
+                            const char* contentType, const char* contentEncoding, String& response) {
+    lastStatusCode = 0;
+    bool post = strcmp(method, "POST") == 0;
+    if (!post && strcmp(method, "GET") != 0) {
         return false;
     }
     
-    if (httpResponseCode > 0) {
-        response = http.getString();
+    // The connection is opened here rather than by HTTPClient so the
+    // handshake is timed on its own. HTTPClient then finds it connected
+    // and, with reuse on, leaves it open after the response unless the
+    // server asked to close. A reused connection the server has dropped
+    // in the meantime is retried once on a new one
+    for (int attempt = 0; attempt < 2; attempt++) {
+        WiFiClient& client = transport();
+        bool reused = API_KEEP_ALIVE && client.connected() &&
+                      millis() - lastRequestEnd < API_CONNECTION_MAX_IDLE_MS;
+        if (!reused && !openConnection()) {
+            response = "HTTP Error: connection failed";
+            return false;
+        }
+        
+        unsigned long start = millis();
+        http.begin(client, apiUrl + endpoint);
+        http.setReuse(API_KEEP_ALIVE);
+        http.addHeader("Content-Type", contentType);
+        if (contentEncoding) {
+            http.addHeader("Content-Encoding", contentEncoding);
+        }
+        http.addHeader("Authorization", "Bearer " + apiKey);
+        http.setTimeout(API_REQUEST_TIMEOUT);
+        
+        int httpResponseCode = post ? http.POST((uint8_t*)body, length) : http.GET();
+        lastStatusCode = httpResponseCode;
+        if (httpResponseCode > 0) {
+            response = http.getString();
+        }
         http.end();
-        return (httpResponseCode >= 200 && httpResponseCode < 300);
-    } else {
+        lastRequestEnd = millis();
+        
+        if (httpResponseCode <= 0 && reused) {
+            connectionStats.staleConnections++;
+            client.stop();
+            continue;
+        }
+        
+        uint32_t elapsed = lastRequestEnd - start;
+        connectionStats.requests++;
+        connectionStats.lastRequestMs = elapsed;
+        connectionStats.totalRequestMs += elapsed;
+        if (elapsed > connectionStats.maxRequestMs) connectionStats.maxRequestMs = elapsed;
+        
+        if (httpResponseCode > 0) {
+            return (httpResponseCode >= 200 && httpResponseCode < 300);
+        }
         response = "HTTP Error: " + String(httpResponseCode);
-        http.end();
+        client.stop();
         return false;
     }
+    response = "HTTP Error: connection lost";
+    return false;
 }
 
-String APIClient::createSensorDataPayload(SensorReading* readings, int count) {
+String APIClient::createEventsPayload(const WeightEvent* events, int count) {
     JsonDocument doc;
-    JsonArray dataArray = doc["sensor_data"].to<JsonArray>();
+    doc["device_id"] = deviceId;
+    doc["timestamp"] = millis();
     
-    // Add device information
+    JsonArray eventArray = doc["events"].to<JsonArray>();
+    for (int i = 0; i < count; i++) {
+        JsonObject event = eventArray.add<JsonObject>();
+        event["bin_id"] = events[i].binId;
+        event["type"] = WeightEventDetector::typeName(events[i].type);
+        event["before"] = events[i].beforeKg;
+        event["after"] = events[i].afterKg;
+        event["delta"] = events[i].afterKg - events[i].beforeKg;
+        event["start_timestamp"] = events[i].startMs;
+        event["timestamp"] = events[i].settledMs;
+        event["unit"] = "kg";
+    }
+    
+    String payload;
+    serializeJson(doc, payload);
+    return payload;
+}
+
+String APIClient::createRollupsPayload(const Rollup* rollups, int count) {
+    JsonDocument doc;
     doc["device_id"] = deviceId;
     doc["timestamp"] = millis();
     
-    // Add sensor readings
+    JsonArray rollupArray = doc["rollups"].to<JsonArray>();
     for (int i = 0; i < count; i++) {
-        if (readings[i].valid) {
-            JsonObject reading = dataArray.add<JsonObject>();
-            reading["bin_id"] = readings[i].bin_id;
-            reading["weight"] = readings[i].weight;
-            reading["timestamp"] = readings[i].timestamp;
-            reading["unit"] = "kg";
-        }
+        JsonObject rollup = rollupArray.add<JsonObject>();
+        rollup["bin_id"] = rollups[i].binId;
+        rollup["window"] = rollups[i].lengthMs / 1000;
+        rollup["start_timestamp"] = rollups[i].startMs;
+        rollup["count"] = rollups[i].count;
+        rollup["min"] = rollups[i].minKg;
+        rollup["max"] = rollups[i].maxKg;
+        rollup["mean"] = rollups[i].meanKg;
+        rollup["last"] = rollups[i].lastKg;
+        rollup["timestamp"] = rollups[i].lastMs;
+        rollup["unit"] = "kg";
     }
     
     String payload;
@@ -142,9 +473,9 @@ String APIClient::createSensorDataPayload(SensorReading* readings, int count) {
 }
 
 void APIClient::loadCredentials() {
-    apiKey = preferences.getString(NVS_API_KEY, "");
-    apiUrl = preferences.getString(NVS_API_URL, API_BASE_URL);
-    deviceId = preferences.getString(NVS_DEVICE_ID, "");
+    apiKey = config.getApiKey();
+    apiUrl = config.getApiUrl();
+    deviceId = config.getDeviceId();
     
     Serial.printf("Loaded API credentials - URL: %s, Device ID: %s\n", 
                  apiUrl.c_str(), deviceId.c_str());
@@ -4,7 +4,7 @@
 #include <HTTPClient.h>
 #include "esp_system.h"
 
-BluetoothProvisioning::BluetoothProvisioning() {
+BluetoothProvisioning::BluetoothProvisioning(ConfigStore& config) : config(config) {
     active = false;
     setupComplete = false;
     deviceConnected = false;
@@ -22,8 +22,6 @@ BluetoothProvisioning::BluetoothProvisioning() {
 }
 
 void BluetoothProvisioning::init() {
-    preferences.begin(NVS_NAMESPACE, false);
-    
     // Generate unique device name using MAC address
     String mac = WiFi.macAddress();
     mac.replace(":", "");
@@ -32,7 +30,7 @@ void BluetoothProvisioning::init() {
     Serial.printf("BLE device name: %s\n", deviceName.c_str());
     
     // Check if setup is already complete
-    setupComplete = preferences.getBool(NVS_SETUP_COMPLETE, false);
+    setupComplete = config.isSetupComplete();
     Serial.printf("Setup complete: %s\n", setupComplete ? "Yes" : "No");
 }
 
@@ -109,6 +107,11 @@ bool BluetoothProvisioning::isSetupComplete() {
 }
 
 void BluetoothProvisioning::update() {
+    Command command;
+    while (commandQueue.pop(command)) {
+        processCommand(String(command.text));
+    }
+    
     if (active) {
         // Update last activity on any connection
         if (deviceConnected) {
@@ -224,9 +227,19 @@ void BluetoothProvisioning::onDisconnect(BLEServer* pServer) {
 
 void BluetoothProvisioning::onWrite(BLECharacteristic* pCharacteristic) {
     if (pCharacteristic == pCommandCharacteristic) {
-        String command = pCharacteristic->getValue().c_str();
-        Serial.printf("Received BLE command: %s\n", command.c_str());
-        processCommand(command);
+        // Runs on the BLE task; the command itself is run by update()
+        String value = pCharacteristic->getValue().c_str();
+        if (value.length() > BLUETOOTH_COMMAND_MAX_BYTES) {
+            sendResponse("error", "Command too long");
+            return;
+        }
+        
+        Command command;
+        memcpy(command.text, value.c_str(), value.length() + 1);
+        Serial.printf("Received BLE command: %s\n", command.text);
+        if (!commandQueue.push(command)) {
+            sendResponse("error", "Busy, command dropped");
+        }
     }
 }
 
@@ -260,6 +273,23 @@ void BluetoothProvisioning::processCommand(const String& command) {
         handleGetAllScaleFactorsCommand();
     } else if (cmd == "calibrate_sensor") {
         handleCalibrateSensorCommand(doc);
+    } else if (cmd == "calibration_begin") {
+        handleCalibrationBeginCommand(doc);
+    } else if (cmd == "calibration_add_point") {
+        handleCalibrationAddPointCommand(doc);
+    } else if (cmd == "calibration_finish") {
+        handleCalibrationFinishCommand();
+    } else if (cmd == "calibration_cancel") {
+        if (pSensorManager) pSensorManager->cancelCalibration();
+        sendResponse("success", "Calibration session cancelled");
+    } else if (cmd == "tare_sensor") {
+        handleTareSensorCommand(doc);
+    } else if (cmd == "get_sampling_stats") {
+        handleGetSamplingStatsCommand();
+    } else if (cmd == "set_upload_batch") {
+        handleUploadBatchCommand(doc);
+    } else if (cmd == "trace_start" || cmd == "trace_stop" || cmd == "trace_status" || cmd == "trace_dump") {
+        handleTraceCommand(cmd);
     } else {
         sendResponse("error", "Unknown command");
     }
@@ -290,11 +320,19 @@ void BluetoothProvisioning::handleWiFiCommand(JsonDocument& doc) {
         return;
     }
     
+    if (ssid.length() > CONFIG_WIFI_SSID_MAX || password.length() > CONFIG_WIFI_PASSWORD_MAX) {
+        sendResponse("error", "SSID or password too long");
+        return;
+    }
+    
     Serial.printf("Testing WiFi connection to: %s\n", ssid.c_str());
     
     if (testWiFiConnection(ssid, password)) {
-        saveCredentials(NVS_WIFI_SSID, ssid);
-        saveCredentials(NVS_WIFI_PASSWORD, password);
+        config.setWifiCredentials(ssid.c_str(), password.c_str());
+        if (!config.commit()) {
+            sendResponse("error", "Failed to save WiFi credentials");
+            return;
+        }
         
         JsonDocument response;
         response["status"] = "wifi_connected";
@@ -328,14 +366,21 @@ void BluetoothProvisioning::handleAPICommand(JsonDocument& doc) {
         apiUrl = API_BASE_URL;
     }
     
+    if (apiKey.length() > CONFIG_API_KEY_MAX || apiUrl.length() > CONFIG_API_URL_MAX) {
+        sendResponse("error", "API key or URL too long");
+        return;
+    }
+    
     Serial.printf("Testing API connection with key: %s...\n", apiKey.substring(0, 8).c_str());
     
     if (testAPIConnection(apiKey, apiUrl)) {
-        saveCredentials(NVS_API_KEY, apiKey);
-        saveCredentials(NVS_API_URL, apiUrl);
-        
+        // Key, URL and device id go out in a single commit
         String deviceId = generateDeviceId();
-        saveCredentials(NVS_DEVICE_ID, deviceId);
+        config.setApiCredentials(apiKey.c_str(), apiUrl.c_str(), deviceId.c_str());
+        if (!config.commit()) {
+            sendResponse("error", "Failed to save API credentials");
+            return;
+        }
         
         JsonDocument response;
         response["status"] = "api_connected";
@@ -378,14 +423,17 @@ void BluetoothProvisioning::handleStatusCommand() {
 
 void BluetoothProvisioning::handleCompleteSetupCommand() {
     // Verify all required credentials are present
-    if (loadCredentials(NVS_WIFI_SSID).length() == 0 ||
-        loadCredentials(NVS_API_KEY).length() == 0) {
+    if (config.getWifiSsid()[0] == '\0' || config.getApiKey()[0] == '\0') {
         sendResponse("error", "WiFi and API credentials required");
         return;
     }
     
+    config.setSetupComplete(true);
+    if (!config.commit()) {
+        sendResponse("error", "Failed to save setup state");
+        return;
+    }
     setupComplete = true;
-    preferences.putBool(NVS_SETUP_COMPLETE, true);
     
     sendResponse("success", "Setup completed successfully");
     
@@ -443,15 +491,6 @@ String BluetoothProvisioning::generateDeviceId() {
     return "smartbin_" + mac;
 }
 
-void BluetoothProvisioning::saveCredentials(const String& key, const String& value) {
-    preferences.putString(key.c_str(), value);
-    Serial.printf("Saved credential: %s\n", key.c_str());
-}
-
-String BluetoothProvisioning::loadCredentials(const String& key) {
-    return preferences.getString(key.c_str(), "");
-}
-
 void BluetoothProvisioning::broadcastDeviceStatus(const String& wifiStatus, const String& apiStatus, const String& sensorStatus) {
     if (!active || !deviceConnected || !pStatusCharacteristic) return;
     
@@ -493,8 +532,8 @@ void BluetoothProvisioning::handleSetScaleFactorCommand(JsonDocument& doc) {
     float scaleFactor = doc["scale_factor"];
     
     // Validate bin ID
-    if (binId < 0 || binId >= MAX_BINS) {
-        sendResponse("error", "Invalid bin_id. Must be 0-" + String(MAX_BINS - 1));
+    if (binId < 0 || binId >= pSensorManager->getChannelCount()) {
+        sendResponse("error", "Invalid bin_id. Must be 0-" + String(pSensorManager->getChannelCount() - 1));
         return;
     }
     
@@ -546,8 +585,8 @@ void BluetoothProvisioning::handleGetScaleFactorCommand(JsonDocument& doc) {
     int binId = doc["bin_id"];
     
     // Validate bin ID
-    if (binId < 0 || binId >= MAX_BINS) {
-        sendResponse("error", "Invalid bin_id. Must be 0-" + String(MAX_BINS - 1));
+    if (binId < 0 || binId >= pSensorManager->getChannelCount()) {
+        sendResponse("error", "Invalid bin_id. Must be 0-" + String(pSensorManager->getChannelCount() - 1));
         return;
     }
     
@@ -585,7 +624,7 @@ void BluetoothProvisioning::handleGetAllScaleFactorsCommand() {
     JsonArray scaleFactors = response.createNestedArray("scale_factors");
     JsonArray sensorStates = response.createNestedArray("sensor_states");
     
-    for (int i = 0; i < MAX_BINS; i++) {
+    for (int i = 0; i < pSensorManager->getChannelCount(); i++) {
         JsonObject factorObj = scaleFactors.createNestedObject();
         factorObj["bin_id"] = i;
         factorObj["scale_factor"] = pSensorManager->getScaleFactor(i);
@@ -618,8 +657,8 @@ void BluetoothProvisioning::handleCalibrateSensorCommand(JsonDocument& doc) {
     float knownWeight = doc["known_weight"];
     
     // Validate bin ID
-    if (binId < 0 || binId >= MAX_BINS) {
-        sendResponse("error", "Invalid bin_id. Must be 0-" + String(MAX_BINS - 1));
+    if (binId < 0 || binId >= pSensorManager->getChannelCount()) {
+        sendResponse("error", "Invalid bin_id. Must be 0-" + String(pSensorManager->getChannelCount() - 1));
         return;
     }
     
@@ -635,8 +674,11 @@ void BluetoothProvisioning::handleCalibrateSensorCommand(JsonDocument& doc) {
         return;
     }
     
-    // Perform calibration
-    pSensorManager->calibrateSensor(binId, knownWeight);
+    // Blocks while the sampling task averages CALIBRATION_SAMPLES_PER_POINT conversions
+    if (!pSensorManager->calibrateSensor(binId, knownWeight)) {
+        sendResponse("error", "Calibration failed: no reading, no change from tare, or not saved");
+        return;
+    }
     
     // Get the updated scale factor
     float newScaleFactor = pSensorManager->getScaleFactor(binId);
@@ -660,3 +702,275 @@ void BluetoothProvisioning::handleCalibrateSensorCommand(JsonDocument& doc) {
     Serial.printf("Sensor %d calibrated via Bluetooth with %.2f kg (new scale: %.2f)\n", 
                  binId, knownWeight, newScaleFactor);
 }
+
+void BluetoothProvisioning::handleCalibrationBeginCommand(JsonDocument& doc) {
+    if (!pSensorManager) {
+        sendResponse("error", "Sensor manager not available");
+        return;
+    }
+    
+    if (!doc.containsKey("bin_id")) {
+        sendResponse("error", "bin_id is required");
+        return;
+    }
+    
+    int binId = doc["bin_id"];
+    
+    // Validate bin ID
+    if (binId < 0 || binId >= pSensorManager->getChannelCount()) {
+        sendResponse("error", "Invalid bin_id. Must be 0-" + String(pSensorManager->getChannelCount() - 1));
+        return;
+    }
+    
+    if (!pSensorManager->beginCalibration(binId)) {
+        sendResponse("error", "Sensor " + String(binId) + " is not enabled or detected");
+        return;
+    }
+    
+    sendResponse("success", "Calibration started for bin " + String(binId) + ". Add known weights, then finish");
+}
+
+void BluetoothProvisioning::handleCalibrationAddPointCommand(JsonDocument& doc) {
+    if (!pSensorManager) {
+        sendResponse("error", "Sensor manager not available");
+        return;
+    }
+    
+    if (pSensorManager->getCalibrationBin() < 0) {
+        sendResponse("error", "No calibration session. Send calibration_begin first");
+        return;
+    }
+    
+    if (!doc.containsKey("known_weight")) {
+        sendResponse("error", "known_weight is required");
+        return;
+    }
+    
+    float knownWeight = doc["known_weight"];
+    
+    // Validate known weight (0 kg is a valid point: the empty bin)
+    if (knownWeight < 0 || knownWeight > 100) {
+        sendResponse("error", "Invalid known_weight. Must be between 0 and 100 kg");
+        return;
+    }
+    
+    // Blocks while the sampling task averages CALIBRATION_SAMPLES_PER_POINT conversions
+    int32_t rawAverage = 0;
+    if (!pSensorManager->addCalibrationPoint(knownWeight, &rawAverage)) {
+        sendResponse("error", "Failed to read sensor for calibration point");
+        return;
+    }
+    
+    JsonDocument response;
+    response["status"] = "success";
+    response["bin_id"] = pSensorManager->getCalibrationBin();
+    response["known_weight"] = knownWeight;
+    response["raw_average"] = rawAverage;
+    response["message"] = "Calibration point recorded";
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    
+    if (pResponseCharacteristic) {
+        pResponseCharacteristic->setValue(responseStr.c_str());
+        pResponseCharacteristic->notify();
+    }
+}
+
+void BluetoothProvisioning::handleCalibrationFinishCommand() {
+    if (!pSensorManager) {
+        sendResponse("error", "Sensor manager not available");
+        return;
+    }
+    
+    CalibrationResult result;
+    if (!pSensorManager->finishCalibration(result)) {
+        sendResponse("error", "Calibration needs at least two different known weights");
+        return;
+    }
+    
+    JsonDocument response;
+    response["status"] = "success";
+    response["bin_id"] = result.binId;
+    response["points"] = result.points;
+    response["new_scale_factor"] = result.scaleFactor;
+    response["offset"] = result.offset;
+    response["residual_kg"] = result.residualKg;
+    response["r_squared"] = result.rSquared;
+    response["message"] = "Sensor calibration completed";
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    
+    if (pResponseCharacteristic) {
+        pResponseCharacteristic->setValue(responseStr.c_str());
+        pResponseCharacteristic->notify();
+    }
+    
+    Serial.printf("Sensor %d calibrated via Bluetooth from %d points (R2 %.6f)\n",
+                 result.binId, result.points, result.rSquared);
+}
+
+void BluetoothProvisioning::handleTareSensorCommand(JsonDocument& doc) {
+    if (!pSensorManager) {
+        sendResponse("error", "Sensor manager not available");
+        return;
+    }
+    
+    if (!doc.containsKey("bin_id")) {
+        sendResponse("error", "bin_id is required");
+        return;
+    }
+    
+    int binId = doc["bin_id"];
+    
+    // Validate bin ID
+    if (binId < 0 || binId >= pSensorManager->getChannelCount()) {
+        sendResponse("error", "Invalid bin_id. Must be 0-" + String(pSensorManager->getChannelCount() - 1));
+        return;
+    }
+    
+    // Check if sensor is enabled
+    if (!pSensorManager->isSensorEnabled(binId)) {
+        sendResponse("error", "Sensor " + String(binId) + " is not enabled or detected");
+        return;
+    }
+    
+    // The new zero is taken from the bin's next reading and saved to NVS
+    if (!pSensorManager->requestTare(binId)) {
+        sendResponse("error", "Tare not available");
+        return;
+    }
+    
+    JsonDocument response;
+    response["status"] = "success";
+    response["bin_id"] = binId;
+    response["message"] = "Tare scheduled for the next reading";
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    
+    if (pResponseCharacteristic) {
+        pResponseCharacteristic->setValue(responseStr.c_str());
+        pResponseCharacteristic->notify();
+    }
+    
+    Serial.printf("Tare for bin %d requested via Bluetooth\n", binId);
+}
+
+void BluetoothProvisioning::handleUploadBatchCommand(JsonDocument& doc) {
+    // Either field may be left out to keep its current value; neither just reports them
+    uint32_t frames = config.getUploadBatchFrames();
+    uint32_t maxDelayMs = config.getUploadBatchMaxDelayMs();
+    if (doc.containsKey("frames")) frames = doc["frames"];
+    if (doc.containsKey("max_delay_ms")) maxDelayMs = doc["max_delay_ms"];
+    
+    if (frames > UPLOAD_BATCH_MAX_FRAMES || !config.setUploadBatch(frames, maxDelayMs)) {
+        sendResponse("error", "frames must be 1-" + String(UPLOAD_BATCH_MAX_FRAMES) +
+                     " and max_delay_ms at most " + String(UPLOAD_BATCH_DELAY_LIMIT_MS));
+        return;
+    }
+    if (!config.commit()) {
+        sendResponse("error", "Failed to save upload batch settings");
+        return;
+    }
+    
+    JsonDocument response;
+    response["status"] = "success";
+    response["frames"] = config.getUploadBatchFrames();
+    response["max_delay_ms"] = config.getUploadBatchMaxDelayMs();
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    
+    if (pResponseCharacteristic) {
+        pResponseCharacteristic->setValue(responseStr.c_str());
+        pResponseCharacteristic->notify();
+    }
+    
+    Serial.printf("Upload batch: %u frames or %u ms\n", config.getUploadBatchFrames(),
+                 config.getUploadBatchMaxDelayMs());
+}
+
+void BluetoothProvisioning::handleGetSamplingStatsCommand() {
+    if (!pSensorManager) {
+        sendResponse("error", "Sensor manager not available");
+        return;
+    }
+    
+    SamplingJitterStats stats = pSensorManager->getJitterStats();
+    
+    JsonDocument response;
+    response["status"] = "success";
+    response["captures"] = stats.captures;
+    response["min_latency_us"] = stats.minLatencyUs;
+    response["max_latency_us"] = stats.maxLatencyUs;
+    response["mean_latency_us"] = stats.meanLatencyUs;
+    response["jitter_us"] = stats.maxLatencyUs - stats.minLatencyUs;
+    response["dropped_samples"] = stats.droppedSamples;
+    response["high_rate"] = pSensorManager->isHighRate();
+    
+    JsonArray bins = response["bins"].to<JsonArray>();
+    for (int i = 0; i < pSensorManager->getChannelCount(); i++) {
+        if (!pSensorManager->isSensorEnabled(i)) continue;
+        
+        ConversionCounters counters = pSensorManager->getConversionCounters(i);
+        JsonObject bin = bins.add<JsonObject>();
+        bin["bin_id"] = i;
+        bin["captured"] = counters.captured;
+        bin["missed"] = counters.missed;
+        bin["rejected"] = counters.rejected;
+        bin["active"] = pSensorManager->isBinActive(i);
+        bin["settled"] = pSensorManager->isSettled(i);
+    }
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    
+    if (pResponseCharacteristic) {
+        pResponseCharacteristic->setValue(responseStr.c_str());
+        pResponseCharacteristic->notify();
+    }
+    
+    Serial.println("Sampling stats requested via Bluetooth");
+}
+
+void BluetoothProvisioning::handleTraceCommand(const String& cmd) {
+    if (!pSensorManager) {
+        sendResponse("error", "Sensor manager not available");
+        return;
+    }
+    
+    TraceRecorder& recorder = pSensorManager->getTraceRecorder();
+    
+    if (cmd == "trace_start") {
+        if (!pSensorManager->startTrace()) {
+            sendResponse("error", "Failed to start trace recording");
+            return;
+        }
+    } else if (cmd == "trace_stop") {
+        pSensorManager->stopTrace();
+    } else if (cmd == "trace_dump") {
+        // Too large for BLE; written to the serial console for the replay tool
+        if (recorder.isRecording()) {
+            sendResponse("error", "Stop the trace before dumping it");
+            return;
+        }
+        recorder.dump(Serial);
+    }
+    
+    JsonDocument response;
+    response["status"] = "success";
+    response["recording"] = recorder.isRecording();
+    response["records"] = recorder.getRecordCount();
+    response["bytes"] = recorder.getFileSize();
+    response["dropped"] = recorder.getDroppedCount();
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    
+    if (pResponseCharacteristic) {
+        pResponseCharacteristic->setValue(responseStr.c_str());
+        pResponseCharacteristic->notify();
+    }
+}
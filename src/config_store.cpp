@@ -0,0 +1,319 @@
+#include "config_store.h"
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "native_platform.h"
+#endif
+#include <stddef.h>
+#include <string.h>
+#include "crc32.h"
+
+#define CONFIG_BLOB_VERSION 2
+#define CONFIG_BLOB_HEADER_SIZE 4
+#define CONFIG_BLOB_SIZE (CONFIG_BLOB_HEADER_SIZE + sizeof(StoredSettings) + 4)
+
+ConfigStore::ConfigStore(KeyValueStore& store) : store(store) {
+    dirtyFields = 0;
+    source = SOURCE_DEFAULTS;
+    commitCount = 0;
+    bootCount = 0;
+    removeLegacyKeys = false;
+    setDefaults();
+}
+
+bool ConfigStore::load() {
+    setDefaults();
+    dirtyFields = 0;
+    source = SOURCE_DEFAULTS;
+    removeLegacyKeys = false;
+
+    // A read-only open fails on a new device, before anything was saved
+    if (!store.begin(NVS_NAMESPACE, true)) {
+        Serial.println("No stored settings, using defaults");
+        return false;
+    }
+
+    uint8_t blob[CONFIG_BLOB_SIZE];
+    bool complete = true;
+    size_t length = store.getBytes(NVS_CONFIG_BLOB, blob, sizeof(blob));
+    if (length > 0 && decodeBlob(blob, length)) {
+        source = SOURCE_BLOB;
+    } else {
+        if (length > 0 || store.isKey(NVS_CONFIG_BLOB)) {
+            Serial.println("ERROR: Stored settings are corrupt or from another version, ignoring them");
+            setDefaults();
+        }
+        if (loadLegacyKeys(complete)) {
+            source = SOURCE_LEGACY;
+        }
+    }
+    store.end();
+
+    // Older firmware kept one key per setting; move them into the blob now.
+    // A string too long for its field stays where it is, and so do the rest
+    if (source == SOURCE_LEGACY && complete) {
+        dirtyFields = FIELD_WIFI | FIELD_API | FIELD_SETUP | FIELD_SENSOR_MASK | FIELD_CALIBRATION | FIELD_UPLOAD;
+        removeLegacyKeys = true;
+        Serial.printf("Migrating per-key settings to one blob: %s\n", commit() ? "done" : "FAILED");
+    } else if (source == SOURCE_LEGACY) {
+        Serial.println("ERROR: A stored setting does not fit, per-key settings left unmigrated");
+    }
+    return source != SOURCE_DEFAULTS;
+}
+
+bool ConfigStore::commit() {
+    if (dirtyFields == 0 && !removeLegacyKeys) {
+        return true;
+    }
+
+    uint8_t blob[CONFIG_BLOB_SIZE];
+    uint16_t version = CONFIG_BLOB_VERSION;
+    uint16_t length = sizeof(StoredSettings);
+    memcpy(blob, &version, sizeof(version));
+    memcpy(blob + 2, &length, sizeof(length));
+    memcpy(blob + CONFIG_BLOB_HEADER_SIZE, &settings, sizeof(settings));
+    uint32_t crc = crc32Update(0, blob, CONFIG_BLOB_HEADER_SIZE + sizeof(settings));
+    memcpy(blob + CONFIG_BLOB_HEADER_SIZE + sizeof(settings), &crc, sizeof(crc));
+
+    if (!store.begin(NVS_NAMESPACE, false)) {
+        Serial.println("ERROR: Failed to open NVS for settings");
+        return false;
+    }
+    bool written = store.putBytes(NVS_CONFIG_BLOB, blob, sizeof(blob));
+    if (!store.end() || !written) {
+        Serial.println("ERROR: Failed to save settings");
+        return false;
+    }
+    dirtyFields = 0;
+    commitCount++;
+
+    // NVS erases a key at once, so the old keys only go once the blob is
+    // known to be saved. A failed removal leaves stale keys that are never
+    // read again, and is retried on the next commit
+    if (removeLegacyKeys && removeLegacy()) {
+        removeLegacyKeys = false;
+    }
+    return true;
+}
+
+bool ConfigStore::removeLegacy() {
+    if (!store.begin(NVS_NAMESPACE, false)) {
+        return false;
+    }
+    const char* keys[] = { NVS_WIFI_SSID, NVS_WIFI_PASSWORD, NVS_API_KEY, NVS_API_URL,
+                           NVS_DEVICE_ID, NVS_SETUP_COMPLETE, NVS_SENSOR_MASK };
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        store.remove(keys[i]);
+    }
+    for (int i = 0; i < SENSOR_MAX_CHANNELS; i++) {
+        char key[24];
+        snprintf(key, sizeof(key), "%s%d", NVS_SCALE_FACTOR_PREFIX, i);
+        store.remove(key);
+        snprintf(key, sizeof(key), "%s%d", NVS_TARE_OFFSET_PREFIX, i);
+        store.remove(key);
+    }
+    return store.end();
+}
+
+uint32_t ConfigStore::countBoot() {
+    if (!store.begin(NVS_NAMESPACE, false)) {
+        Serial.println("ERROR: Failed to open NVS for the boot counter");
+        return bootCount = 0;
+    }
+    uint32_t count = store.getUInt(NVS_BOOT_COUNT, 0) + 1;
+    if (count == 0) {
+        count = 1;      // 0 is kept for unknown
+    }
+    bool saved = store.putUInt(NVS_BOOT_COUNT, count);
+    if (!store.end() || !saved) {
+        Serial.println("ERROR: Failed to save the boot counter");
+        return bootCount = 0;
+    }
+    return bootCount = count;
+}
+
+bool ConfigStore::getSensorMask(uint32_t& mask) const {
+    mask = settings.sensorMask;
+    return settings.sensorMaskValid != 0;
+}
+
+bool ConfigStore::getScaleFactor(int binId, float& scaleFactor) const {
+    if (binId < 0 || binId >= SENSOR_MAX_CHANNELS || !(settings.scaleMask & (1UL << binId))) {
+        return false;
+    }
+    scaleFactor = settings.scaleFactors[binId];
+    return true;
+}
+
+bool ConfigStore::getTareOffset(int binId, int32_t& offset) const {
+    if (binId < 0 || binId >= SENSOR_MAX_CHANNELS || !(settings.tareMask & (1UL << binId))) {
+        return false;
+    }
+    offset = settings.tareOffsets[binId];
+    return true;
+}
+
+bool ConfigStore::setWifiCredentials(const char* ssid, const char* password) {
+    if (strlen(ssid) > CONFIG_WIFI_SSID_MAX || strlen(password) > CONFIG_WIFI_PASSWORD_MAX) {
+        return false;
+    }
+    bool changed = false;
+    copyString(settings.wifiSsid, sizeof(settings.wifiSsid), ssid, changed);
+    copyString(settings.wifiPassword, sizeof(settings.wifiPassword), password, changed);
+    if (changed) dirtyFields |= FIELD_WIFI;
+    return true;
+}
+
+bool ConfigStore::setApiCredentials(const char* apiKey, const char* apiUrl, const char* deviceId) {
+    if (strlen(apiKey) > CONFIG_API_KEY_MAX || strlen(apiUrl) > CONFIG_API_URL_MAX ||
+        strlen(deviceId) > CONFIG_DEVICE_ID_MAX) {
+        return false;
+    }
+    bool changed = false;
+    copyString(settings.apiKey, sizeof(settings.apiKey), apiKey, changed);
+    copyString(settings.apiUrl, sizeof(settings.apiUrl), apiUrl, changed);
+    copyString(settings.deviceId, sizeof(settings.deviceId), deviceId, changed);
+    if (changed) dirtyFields |= FIELD_API;
+    return true;
+}
+
+void ConfigStore::setSetupComplete(bool complete) {
+    if (settings.setupComplete != (complete ? 1 : 0)) {
+        settings.setupComplete = complete ? 1 : 0;
+        dirtyFields |= FIELD_SETUP;
+    }
+}
+
+void ConfigStore::setSensorMask(uint32_t mask) {
+    if (!settings.sensorMaskValid || settings.sensorMask != mask) {
+        settings.sensorMask = mask;
+        settings.sensorMaskValid = 1;
+        dirtyFields |= FIELD_SENSOR_MASK;
+    }
+}
+
+void ConfigStore::setScaleFactor(int binId, float scaleFactor) {
+    if (binId < 0 || binId >= SENSOR_MAX_CHANNELS) return;
+    uint32_t bit = 1UL << binId;
+    if (!(settings.scaleMask & bit) || settings.scaleFactors[binId] != scaleFactor) {
+        settings.scaleFactors[binId] = scaleFactor;
+        settings.scaleMask |= bit;
+        dirtyFields |= FIELD_CALIBRATION;
+    }
+}
+
+void ConfigStore::setTareOffset(int binId, int32_t offset) {
+    if (binId < 0 || binId >= SENSOR_MAX_CHANNELS) return;
+    uint32_t bit = 1UL << binId;
+    if (!(settings.tareMask & bit) || settings.tareOffsets[binId] != offset) {
+        settings.tareOffsets[binId] = offset;
+        settings.tareMask |= bit;
+        dirtyFields |= FIELD_CALIBRATION;
+    }
+}
+
+bool ConfigStore::setUploadBatch(uint16_t frames, uint32_t maxDelayMs) {
+    if (frames < 1 || frames > UPLOAD_BATCH_MAX_FRAMES || maxDelayMs > UPLOAD_BATCH_DELAY_LIMIT_MS) {
+        return false;
+    }
+    if (settings.uploadBatchFrames != frames || settings.uploadBatchMaxDelayMs != maxDelayMs) {
+        settings.uploadBatchFrames = frames;
+        settings.uploadBatchMaxDelayMs = maxDelayMs;
+        dirtyFields |= FIELD_UPLOAD;
+    }
+    return true;
+}
+
+void ConfigStore::setDefaults() {
+    // Zeroed padding keeps the CRC of equal settings equal
+    memset(&settings, 0, sizeof(settings));
+    strncpy(settings.apiUrl, API_BASE_URL, CONFIG_API_URL_MAX);
+    settings.uploadBatchFrames = UPLOAD_BATCH_FRAMES;
+    settings.uploadBatchMaxDelayMs = UPLOAD_BATCH_MAX_DELAY_MS;
+}
+
+bool ConfigStore::decodeBlob(const uint8_t* blob, size_t length) {
+    if (length < CONFIG_BLOB_HEADER_SIZE + 4) {
+        return false;
+    }
+    uint16_t version;
+    uint16_t settingsLength;
+    uint32_t crc;
+    memcpy(&version, blob, sizeof(version));
+    memcpy(&settingsLength, blob + 2, sizeof(settingsLength));
+    
+    // Version 1 ends where the upload batch fields begin
+    size_t expectedLength = version == 1 ? offsetof(StoredSettings, uploadBatchFrames) :
+                            version == CONFIG_BLOB_VERSION ? sizeof(settings) : 0;
+    if (expectedLength == 0 || settingsLength != expectedLength ||
+        length != CONFIG_BLOB_HEADER_SIZE + expectedLength + 4) {
+        return false;
+    }
+    memcpy(&crc, blob + CONFIG_BLOB_HEADER_SIZE + expectedLength, sizeof(crc));
+    if (crc != crc32Update(0, blob, CONFIG_BLOB_HEADER_SIZE + expectedLength)) {
+        return false;
+    }
+
+    // Fields the blob predates keep their defaults
+    memcpy(&settings, blob + CONFIG_BLOB_HEADER_SIZE, expectedLength);
+    return true;
+}
+
+bool ConfigStore::loadLegacyKeys(bool& complete) {
+    bool found = false;
+    found |= loadLegacyString(NVS_WIFI_SSID, settings.wifiSsid, sizeof(settings.wifiSsid), complete);
+    found |= loadLegacyString(NVS_WIFI_PASSWORD, settings.wifiPassword, sizeof(settings.wifiPassword), complete);
+    found |= loadLegacyString(NVS_API_KEY, settings.apiKey, sizeof(settings.apiKey), complete);
+    found |= loadLegacyString(NVS_API_URL, settings.apiUrl, sizeof(settings.apiUrl), complete);
+    found |= loadLegacyString(NVS_DEVICE_ID, settings.deviceId, sizeof(settings.deviceId), complete);
+
+    settings.setupComplete = store.getBool(NVS_SETUP_COMPLETE, false) ? 1 : 0;
+    found |= settings.setupComplete != 0;
+
+    if (store.isKey(NVS_SENSOR_MASK)) {
+        settings.sensorMask = store.getUInt(NVS_SENSOR_MASK, 0);
+        settings.sensorMaskValid = 1;
+        found = true;
+    }
+
+    for (int i = 0; i < SENSOR_MAX_CHANNELS; i++) {
+        char key[24];
+        snprintf(key, sizeof(key), "%s%d", NVS_SCALE_FACTOR_PREFIX, i);
+        float scaleFactor = store.getFloat(key, -1.0f);
+        if (scaleFactor > 0) {
+            settings.scaleFactors[i] = scaleFactor;
+            settings.scaleMask |= 1UL << i;
+            found = true;
+        }
+
+        snprintf(key, sizeof(key), "%s%d", NVS_TARE_OFFSET_PREFIX, i);
+        if (store.isKey(key)) {
+            settings.tareOffsets[i] = store.getInt(key, 0);
+            settings.tareMask |= 1UL << i;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool ConfigStore::loadLegacyString(const char* key, char* target, size_t size, bool& complete) {
+    if (store.getString(key, target, size)) {
+        return true;
+    }
+    // Present but longer than the field: counts as found, and clears complete
+    if (store.isKey(key)) {
+        memset(target, 0, size);
+        Serial.printf("ERROR: Stored %s is longer than %u characters\n", key, (unsigned)(size - 1));
+        complete = false;
+        return true;
+    }
+    return false;
+}
+
+void ConfigStore::copyString(char* target, size_t size, const char* value, bool& changed) {
+    if (strncmp(target, value, size) != 0) {
+        memset(target, 0, size);
+        strncpy(target, value, size - 1);
+        changed = true;
+    }
+}
@@ -0,0 +1,201 @@
+#include "gzip_writer.h"
+#include <string.h>
+#include "crc32.h"
+
+static const int MIN_MATCH = 3;
+static const int MAX_MATCH = 258;
+static const int MAX_CHAIN = 32;    // Candidates tried per position
+static const size_t WINDOW_MASK = API_GZIP_WINDOW_BYTES - 1;
+
+// Deflate length codes 257..285 and distance codes 0..29 (RFC 1951 3.2.5)
+static const uint16_t lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t distanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t distanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+GzipWriter::GzipWriter() {
+    begin(nullptr, 0);
+}
+
+void GzipWriter::begin(uint8_t* output, size_t capacity) {
+    this->output = output;
+    this->capacity = capacity;
+    used = 0;
+    overflow = false;
+    bitBuffer = 0;
+    bitCount = 0;
+    crc = 0;
+    inputSize = 0;
+    filled = 0;
+    pos = 0;
+    memset(head, 0xFF, sizeof(head));
+    if (!output) {
+        return;
+    }
+
+    // Header: deflate, no name or timestamp, unknown OS
+    static const uint8_t header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+    for (size_t i = 0; i < sizeof(header); i++) putByte(header[i]);
+
+    // One final block with the fixed codes carries the whole stream
+    putBits(1, 1);
+    putBits(1, 2);
+}
+
+void GzipWriter::write(const uint8_t* data, size_t length) {
+    crc = crc32Update(crc, data, length);
+    inputSize += length;
+    while (length > 0) {
+        if (filled == sizeof(window)) {
+            slide();
+        }
+        size_t n = sizeof(window) - filled;
+        if (n > length) n = length;
+        memcpy(window + filled, data, n);
+        filled += n;
+        data += n;
+        length -= n;
+        encode(false);
+    }
+}
+
+void GzipWriter::finish() {
+    encode(true);
+    putCode(0, 7);      // End of block (256)
+    if (bitCount > 0) {
+        putByte((uint8_t)bitBuffer);
+        bitBuffer = 0;
+        bitCount = 0;
+    }
+    for (int i = 0; i < 4; i++) putByte((uint8_t)(crc >> (8 * i)));
+    for (int i = 0; i < 4; i++) putByte((uint8_t)(inputSize >> (8 * i)));
+}
+
+void GzipWriter::encode(bool flush) {
+    // Without flush, a full match's worth of input stays ahead of pos
+    while (flush ? pos < filled : filled - pos >= (size_t)MAX_MATCH) {
+        size_t available = filled - pos;
+        if (available < (size_t)MIN_MATCH) {
+            putLiteral(window[pos++]);
+            continue;
+        }
+
+        size_t limit = available < (size_t)MAX_MATCH ? available : MAX_MATCH;
+        int bestLength = 0;
+        size_t bestDistance = 0;
+        uint16_t candidate = head[hash(pos)];
+        for (int chain = 0; candidate != NONE && chain < MAX_CHAIN; chain++) {
+            size_t distance = pos - candidate;
+            if (distance >= API_GZIP_WINDOW_BYTES) {
+                break;
+            }
+            const uint8_t* a = window + candidate;
+            const uint8_t* b = window + pos;
+            size_t length = 0;
+            while (length < limit && a[length] == b[length]) length++;
+            if ((int)length > bestLength) {
+                bestLength = length;
+                bestDistance = distance;
+                if (length == limit) break;
+            }
+            // Chains only run backwards; anything else is a stale entry
+            uint16_t next = prev[candidate & WINDOW_MASK];
+            if (next == NONE || next >= candidate) break;
+            candidate = next;
+        }
+
+        insert(pos);
+        if (bestLength < MIN_MATCH) {
+            putLiteral(window[pos++]);
+            continue;
+        }
+        putMatch(bestLength, bestDistance);
+        for (int i = 1; i < bestLength; i++) {
+            if (pos + i + MIN_MATCH <= filled) insert(pos + i);
+        }
+        pos += bestLength;
+    }
+}
+
+void GzipWriter::slide() {
+    // Called with pos past the first window, so a full window of history stays
+    memmove(window, window + API_GZIP_WINDOW_BYTES, API_GZIP_WINDOW_BYTES);
+    filled -= API_GZIP_WINDOW_BYTES;
+    pos -= API_GZIP_WINDOW_BYTES;
+    for (size_t i = 0; i < sizeof(head) / sizeof(head[0]); i++) {
+        head[i] = head[i] == NONE || head[i] < API_GZIP_WINDOW_BYTES ? NONE : head[i] - API_GZIP_WINDOW_BYTES;
+    }
+    for (size_t i = 0; i < API_GZIP_WINDOW_BYTES; i++) {
+        prev[i] = prev[i] == NONE || prev[i] < API_GZIP_WINDOW_BYTES ? NONE : prev[i] - API_GZIP_WINDOW_BYTES;
+    }
+}
+
+uint32_t GzipWriter::hash(size_t at) const {
+    uint32_t bytes = (uint32_t)window[at] << 16 | (uint32_t)window[at + 1] << 8 | window[at + 2];
+    return (bytes * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void GzipWriter::insert(size_t at) {
+    uint32_t h = hash(at);
+    prev[at & WINDOW_MASK] = head[h];
+    head[h] = (uint16_t)at;
+}
+
+void GzipWriter::putByte(uint8_t byte) {
+    if (used >= capacity) {
+        overflow = true;
+        return;
+    }
+    output[used++] = byte;
+}
+
+void GzipWriter::putBits(uint32_t value, int count) {
+    bitBuffer |= value << bitCount;
+    bitCount += count;
+    while (bitCount >= 8) {
+        putByte((uint8_t)bitBuffer);
+        bitBuffer >>= 8;
+        bitCount -= 8;
+    }
+}
+
+void GzipWriter::putCode(uint32_t code, int count) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < count; i++) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    putBits(reversed, count);
+}
+
+void GzipWriter::putLiteral(int symbol) {
+    // Fixed literal/length code (RFC 1951 3.2.6)
+    if (symbol < 144) putCode(0x30 + symbol, 8);
+    else if (symbol < 256) putCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280) putCode(symbol - 256, 7);
+    else putCode(0xC0 + symbol - 280, 8);
+}
+
+void GzipWriter::putMatch(int length, int distance) {
+    int code = 28;
+    while (lengthBase[code] > length) code--;
+    putLiteral(257 + code);
+    putBits(length - lengthBase[code], lengthExtra[code]);
+
+    code = 29;
+    while (distanceBase[code] > distance) code--;
+    putCode(code, 5);
+    putBits(distance - distanceBase[code], distanceExtra[code]);
+}
@@ -0,0 +1,221 @@
+#ifdef ARDUINO
+#include "hal_esp32.h"
+
+static const int onboardClkPins[MAX_BINS] = {
+    HX711_1_CLK_PIN, HX711_2_CLK_PIN, HX711_3_CLK_PIN,
+    HX711_4_CLK_PIN, HX711_5_CLK_PIN, HX711_6_CLK_PIN
+};
+
+static const int onboardDoutPins[MAX_BINS] = {
+    HX711_1_DOUT_PIN, HX711_2_DOUT_PIN, HX711_3_DOUT_PIN,
+    HX711_4_DOUT_PIN, HX711_5_DOUT_PIN, HX711_6_DOUT_PIN
+};
+
+// The base class only stores the port reference until begin()
+Esp32LoadCellAdc::Esp32LoadCellAdc() : Hx711BankAdc(gpioPort) {
+    for (int i = 0; i < MAX_BINS; i++) {
+        addChannel(onboardClkPins[i], onboardDoutPins[i]);
+    }
+}
+
+void Esp32LoadCellAdc::begin() {
+    if (HX711_RATE_PIN >= 0) {
+        pinMode(HX711_RATE_PIN, OUTPUT);
+        digitalWrite(HX711_RATE_PIN, LOW);
+    }
+    Hx711BankAdc::begin();
+}
+
+bool Esp32LoadCellAdc::setHighRate(bool high) {
+    if (HX711_RATE_PIN < 0) {
+        return false;
+    }
+    digitalWrite(HX711_RATE_PIN, high ? HIGH : LOW);
+    return true;
+}
+
+bool Esp32LoadCellAdc::attachDataReady(int channel, DataReadyHandler handler, void* arg) {
+    if (channel < 0 || channel >= channelCount) {
+        return false;
+    }
+
+    // DOUT falls when a conversion completes
+    attachInterruptArg(digitalPinToInterrupt(doutPins[channel]), handler, arg, FALLING);
+    return true;
+}
+
+Esp32ExpansionAdc::Esp32ExpansionAdc()
+    : Hx711BankAdc(inputs),
+      inputs(gpioPort, EXPANSION_LOAD_PIN, EXPANSION_CLOCK_PIN, EXPANSION_DATA_PIN, HX711_EXPANSION_CHANNELS) {
+    for (int i = 0; i < HX711_EXPANSION_CHANNELS; i++) {
+        addChannel(EXPANSION_HX711_CLK_PIN, i);
+    }
+}
+
+uint32_t ArduinoClock::millis() {
+    return ::millis();
+}
+
+uint32_t ArduinoClock::micros() {
+    return ::micros();
+}
+
+void ArduinoClock::delay(uint32_t ms) {
+    ::delay(ms);
+}
+
+NvsKeyValueStore::NvsKeyValueStore() {
+    handle = 0;
+    opened = false;
+    dirty = false;
+    failed = false;
+}
+
+bool NvsKeyValueStore::begin(const char* name, bool readOnly) {
+    if (opened) {
+        end();
+    }
+
+    opened = nvs_open(name, readOnly ? NVS_READONLY : NVS_READWRITE, &handle) == ESP_OK;
+    dirty = false;
+    failed = !opened;
+    return opened;
+}
+
+bool NvsKeyValueStore::end() {
+    if (!opened) {
+        return false;
+    }
+
+    bool ok = !failed;
+    if (dirty && nvs_commit(handle) != ESP_OK) {
+        ok = false;
+    }
+
+    nvs_close(handle);
+    opened = false;
+    dirty = false;
+    return ok;
+}
+
+bool NvsKeyValueStore::isKey(const char* key) {
+    if (!opened) return false;
+
+    size_t length = 0;
+    int32_t i32;
+    uint32_t u32;
+    return nvs_get_blob(handle, key, nullptr, &length) == ESP_OK ||
+           nvs_get_str(handle, key, nullptr, &length) == ESP_OK ||
+           nvs_get_i32(handle, key, &i32) == ESP_OK ||
+           nvs_get_u32(handle, key, &u32) == ESP_OK;
+}
+
+float NvsKeyValueStore::getFloat(const char* key, float defaultValue) {
+    float value;
+    size_t length = sizeof(value);
+    if (!opened || nvs_get_blob(handle, key, &value, &length) != ESP_OK || length != sizeof(value)) {
+        return defaultValue;
+    }
+    return value;
+}
+
+bool NvsKeyValueStore::putFloat(const char* key, float value) {
+    return opened && track(nvs_set_blob(handle, key, &value, sizeof(value)));
+}
+
+int32_t NvsKeyValueStore::getInt(const char* key, int32_t defaultValue) {
+    int32_t value;
+    if (!opened || nvs_get_i32(handle, key, &value) != ESP_OK) {
+        return defaultValue;
+    }
+    return value;
+}
+
+bool NvsKeyValueStore::putInt(const char* key, int32_t value) {
+    return opened && track(nvs_set_i32(handle, key, value));
+}
+
+uint32_t NvsKeyValueStore::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t value;
+    if (!opened || nvs_get_u32(handle, key, &value) != ESP_OK) {
+        return defaultValue;
+    }
+    return value;
+}
+
+bool NvsKeyValueStore::putUInt(const char* key, uint32_t value) {
+    return opened && track(nvs_set_u32(handle, key, value));
+}
+
+bool NvsKeyValueStore::getBool(const char* key, bool defaultValue) {
+    // Preferences::putBool stores a u8
+    uint8_t value;
+    if (!opened || nvs_get_u8(handle, key, &value) != ESP_OK) {
+        return defaultValue;
+    }
+    return value != 0;
+}
+
+bool NvsKeyValueStore::getString(const char* key, char* buffer, size_t size) {
+    size_t length = size;
+    return opened && size > 0 && nvs_get_str(handle, key, buffer, &length) == ESP_OK;
+}
+
+size_t NvsKeyValueStore::getBytes(const char* key, void* buffer, size_t size) {
+    size_t length = 0;
+    if (!opened || nvs_get_blob(handle, key, nullptr, &length) != ESP_OK || length > size) {
+        return 0;
+    }
+    return nvs_get_blob(handle, key, buffer, &length) == ESP_OK ? length : 0;
+}
+
+bool NvsKeyValueStore::putBytes(const char* key, const void* data, size_t length) {
+    return opened && track(nvs_set_blob(handle, key, data, length));
+}
+
+bool NvsKeyValueStore::remove(const char* key) {
+    if (!opened) return false;
+    esp_err_t err = nvs_erase_key(handle, key);
+    return err == ESP_ERR_NVS_NOT_FOUND || track(err);
+}
+
+bool NvsKeyValueStore::track(esp_err_t err) {
+    // A failed write fails the whole commit reported by end()
+    if (err == ESP_OK) {
+        dirty = true;
+        return true;
+    }
+    failed = true;
+    return false;
+}
+
+Esp32PartitionFlash::Esp32PartitionFlash(const char* label) : label(label) {
+    partition = nullptr;
+}
+
+bool Esp32PartitionFlash::begin() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    return partition != nullptr;
+}
+
+uint32_t Esp32PartitionFlash::getSize() {
+    return partition ? partition->size : 0;
+}
+
+uint32_t Esp32PartitionFlash::getSectorSize() {
+    return SPI_FLASH_SEC_SIZE;
+}
+
+bool Esp32PartitionFlash::read(uint32_t offset, void* data, uint32_t length) {
+    return partition && esp_partition_read(partition, offset, data, length) == ESP_OK;
+}
+
+bool Esp32PartitionFlash::write(uint32_t offset, const void* data, uint32_t length) {
+    return partition && esp_partition_write(partition, offset, data, length) == ESP_OK;
+}
+
+bool Esp32PartitionFlash::eraseSector(uint32_t sector) {
+    return partition &&
+        esp_partition_erase_range(partition, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
+#endif
@@ -0,0 +1,441 @@
+#ifndef ARDUINO
+#include "hal_native.h"
+#include "config.h"
+
+VirtualClock::VirtualClock() {
+    nowUs = 0;
+}
+
+uint32_t VirtualClock::millis() {
+    return (uint32_t)(nowUs / 1000);
+}
+
+uint32_t VirtualClock::micros() {
+    return (uint32_t)nowUs;
+}
+
+void VirtualClock::delay(uint32_t ms) {
+    nowUs += (uint64_t)ms * 1000;
+}
+
+void VirtualClock::advanceMicros(uint32_t us) {
+    nowUs += us;
+}
+
+SimulatedLoadCellBank::SimulatedLoadCellBank(Clock& clock, int channelCount, uint32_t seed)
+    : clock(clock) {
+    this->channelCount = channelCount > SIMULATED_MAX_CHANNELS ? SIMULATED_MAX_CHANNELS : channelCount;
+    rngState = seed ? seed : 1;
+    startUs = 0;
+    pending = 0;
+    ratePinWired = true;
+    highRate = false;
+
+    for (int i = 0; i < SIMULATED_MAX_CHANNELS; i++) {
+        SimulatedLoadCell& c = cells[i];
+        c.present = true;
+        c.stuck = false;
+        c.zeroCounts = 8000 + 1500 * i;
+        c.countsPerKg = HX711_DEFAULT_SCALE_FACTOR;
+        c.loadKg = 0.0f;
+        c.noiseCounts = 0.0f;
+        c.driftCountsPerHour = 0.0f;
+        c.dropoutRate = 0.0f;
+        c.glitchRate = 0.0f;
+        c.glitchCounts = 0;
+        c.periodUs = HX711_CONVERSION_PERIOD_US;
+        nextConversionUs[i] = 0;
+        completed[i] = 0;
+    }
+}
+
+void SimulatedLoadCellBank::begin() {
+    // Free-running HX711s are not phase aligned; spread the first conversions
+    startUs = clock.micros();
+    pending = 0;
+    for (int i = 0; i < channelCount; i++) {
+        nextConversionUs[i] = startUs + cells[i].periodUs / 2 + (nextRandom() % cells[i].periodUs);
+        completed[i] = 0;
+    }
+}
+
+int SimulatedLoadCellBank::getChannelCount() {
+    return channelCount;
+}
+
+uint32_t SimulatedLoadCellBank::readyMask() {
+    advance(clock.micros());
+    return pending;
+}
+
+uint32_t SimulatedLoadCellBank::read(uint32_t channelMask, int32_t* values) {
+    uint32_t now = clock.micros();
+    advance(now);
+
+    // Clocking a channel with no conversion waiting returns the old data on
+    // the real part; the simulation only returns channels that are ready
+    uint32_t readMask = channelMask & pending;
+    for (int i = 0; i < channelCount; i++) {
+        if (readMask & (1UL << i)) {
+            values[i] = sample(i, now);
+        }
+    }
+    pending &= ~readMask;
+    return readMask;
+}
+
+bool SimulatedLoadCellBank::setHighRate(bool high) {
+    if (!ratePinWired) {
+        return false;
+    }
+
+    // The conversion in progress is abandoned; the next one completes a
+    // full period at the new rate from now
+    uint32_t now = clock.micros();
+    advance(now);
+    highRate = high;
+    for (int i = 0; i < channelCount; i++) {
+        cells[i].periodUs = high ? HX711_FAST_CONVERSION_PERIOD_US : HX711_CONVERSION_PERIOD_US;
+        nextConversionUs[i] = now + cells[i].periodUs;
+    }
+    return true;
+}
+
+SimulatedLoadCell& SimulatedLoadCellBank::cell(int channel) {
+    return cells[channel < 0 ? 0 : (channel >= SIMULATED_MAX_CHANNELS ? SIMULATED_MAX_CHANNELS - 1 : channel)];
+}
+
+void SimulatedLoadCellBank::setLoad(int channel, float kg) {
+    cell(channel).loadKg = kg;
+}
+
+uint32_t SimulatedLoadCellBank::getCompletedConversions(int channel) {
+    if (channel < 0 || channel >= channelCount) return 0;
+    return completed[channel];
+}
+
+void SimulatedLoadCellBank::advance(uint32_t nowUs) {
+    for (int i = 0; i < channelCount; i++) {
+        SimulatedLoadCell& c = cells[i];
+        uint32_t bit = 1UL << i;
+
+        if (!c.present) {
+            continue;
+        }
+        if (c.stuck) {
+            pending |= bit;
+            continue;
+        }
+
+        while ((int32_t)(nowUs - nextConversionUs[i]) >= 0) {
+            completed[i]++;
+            if (c.dropoutRate <= 0.0f || nextUniform() >= c.dropoutRate) {
+                pending |= bit;
+            }
+            nextConversionUs[i] += c.periodUs;
+        }
+    }
+}
+
+int32_t SimulatedLoadCellBank::sample(int channel, uint32_t nowUs) {
+    SimulatedLoadCell& c = cells[channel];
+    if (c.stuck) {
+        return 0x7FFFFF;
+    }
+
+    float hours = (float)(nowUs - startUs) / 3600.0e6f;
+    float value = c.zeroCounts + c.loadKg * c.countsPerKg + c.driftCountsPerHour * hours;
+
+    if (c.noiseCounts > 0.0f) {
+        value += c.noiseCounts * nextGaussian();
+    }
+    if (c.glitchRate > 0.0f && nextUniform() < c.glitchRate) {
+        value += (nextRandom() & 1) ? c.glitchCounts : -c.glitchCounts;
+    }
+
+    // Saturate like the 24-bit converter
+    if (value > 0x7FFFFF) return 0x7FFFFF;
+    if (value < -0x800000) return -0x800000;
+    return (int32_t)lroundf(value);
+}
+
+uint32_t SimulatedLoadCellBank::nextRandom() {
+    // xorshift32
+    uint32_t x = rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rngState = x;
+    return x;
+}
+
+float SimulatedLoadCellBank::nextUniform() {
+    return (nextRandom() >> 8) * (1.0f / 16777216.0f);
+}
+
+float SimulatedLoadCellBank::nextGaussian() {
+    // Box-Muller; u1 is kept away from 0 for the log
+    float u1 = ((nextRandom() >> 8) + 1) * (1.0f / 16777217.0f);
+    float u2 = nextUniform();
+    return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+MemoryKeyValueStore::MemoryKeyValueStore() {
+    opened = false;
+    writable = false;
+    full = false;
+    failed = false;
+    commits = 0;
+}
+
+bool MemoryKeyValueStore::begin(const char* name, bool readOnly) {
+    if (opened) {
+        end();
+    }
+
+    prefix = std::string(name) + "/";
+    staged.clear();
+    opened = true;
+    writable = !readOnly;
+    failed = false;
+    return true;
+}
+
+bool MemoryKeyValueStore::end() {
+    if (!opened) {
+        return false;
+    }
+
+    if (!staged.empty()) {
+        for (std::map<std::string, StagedValue>::iterator it = staged.begin(); it != staged.end(); ++it) {
+            if (it->second.removed) {
+                committed.erase(it->first);
+            } else {
+                committed[it->first] = it->second.bytes;
+            }
+        }
+        staged.clear();
+        commits++;
+    }
+    opened = false;
+    return !failed;
+}
+
+bool MemoryKeyValueStore::isKey(const char* key) {
+    std::string bytes;
+    return lookup(key, bytes);
+}
+
+float MemoryKeyValueStore::getFloat(const char* key, float defaultValue) {
+    uint32_t bits;
+    if (!lookupU32(key, bits)) return defaultValue;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool MemoryKeyValueStore::putFloat(const char* key, float value) {
+    return stage(key, &value, sizeof(value));
+}
+
+int32_t MemoryKeyValueStore::getInt(const char* key, int32_t defaultValue) {
+    uint32_t bits;
+    return lookupU32(key, bits) ? (int32_t)bits : defaultValue;
+}
+
+bool MemoryKeyValueStore::putInt(const char* key, int32_t value) {
+    return stage(key, &value, sizeof(value));
+}
+
+uint32_t MemoryKeyValueStore::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t bits;
+    return lookupU32(key, bits) ? bits : defaultValue;
+}
+
+bool MemoryKeyValueStore::putUInt(const char* key, uint32_t value) {
+    return stage(key, &value, sizeof(value));
+}
+
+bool MemoryKeyValueStore::getBool(const char* key, bool defaultValue) {
+    std::string bytes;
+    if (!lookup(key, bytes) || bytes.size() != 1) return defaultValue;
+    return bytes[0] != 0;
+}
+
+bool MemoryKeyValueStore::putBool(const char* key, bool value) {
+    uint8_t byte = value ? 1 : 0;
+    return stage(key, &byte, 1);
+}
+
+bool MemoryKeyValueStore::getString(const char* key, char* buffer, size_t size) {
+    std::string bytes;
+    if (!lookup(key, bytes) || bytes.size() + 1 > size) return false;
+    memcpy(buffer, bytes.data(), bytes.size());
+    buffer[bytes.size()] = '\0';
+    return true;
+}
+
+bool MemoryKeyValueStore::putString(const char* key, const char* value) {
+    return stage(key, value, strlen(value));
+}
+
+size_t MemoryKeyValueStore::getBytes(const char* key, void* buffer, size_t size) {
+    std::string bytes;
+    if (!lookup(key, bytes) || bytes.size() > size) return 0;
+    memcpy(buffer, bytes.data(), bytes.size());
+    return bytes.size();
+}
+
+bool MemoryKeyValueStore::putBytes(const char* key, const void* data, size_t length) {
+    return stage(key, data, length);
+}
+
+bool MemoryKeyValueStore::remove(const char* key) {
+    return stage(key, nullptr, 0, true);
+}
+
+bool MemoryKeyValueStore::lookup(const char* key, std::string& bytes) {
+    if (!opened) return false;
+
+    // Reads see uncommitted writes of the open session, like NVS
+    std::string name = prefix + key;
+    std::map<std::string, StagedValue>::iterator pending = staged.find(name);
+    if (pending != staged.end()) {
+        if (pending->second.removed) return false;
+        bytes = pending->second.bytes;
+        return true;
+    }
+    std::map<std::string, std::string>::iterator it = committed.find(name);
+    if (it == committed.end()) return false;
+    bytes = it->second;
+    return true;
+}
+
+bool MemoryKeyValueStore::lookupU32(const char* key, uint32_t& bits) {
+    std::string bytes;
+    if (!lookup(key, bytes) || bytes.size() != sizeof(bits)) return false;
+    memcpy(&bits, bytes.data(), sizeof(bits));
+    return true;
+}
+
+bool MemoryKeyValueStore::stage(const char* key, const void* data, size_t length, bool removed) {
+    if (!opened || !writable) return false;
+    if (full && !removed) {
+        failed = true;
+        return false;
+    }
+    StagedValue& value = staged[prefix + key];
+    value.removed = removed;
+    if (removed) {
+        value.bytes.clear();
+    } else {
+        value.bytes.assign((const char*)data, length);
+    }
+    return true;
+}
+
+FileFlashDevice::FileFlashDevice(const char* path, uint32_t size, uint32_t sectorSize)
+    : image(size - size % sectorSize, 0xFF), eraseCounts(size / sectorSize, 0) {
+    this->sectorSize = sectorSize;
+    powered = true;
+    cutArmed = false;
+    cutBudget = 0;
+    bytesWritten = 0;
+
+    // Keep an existing image of the same size, otherwise start erased
+    file = fopen(path, "r+b");
+    if (file && (fread(image.data(), 1, image.size(), file) != image.size())) {
+        fclose(file);
+        file = nullptr;
+        memset(image.data(), 0xFF, image.size());
+    }
+    if (!file) {
+        file = fopen(path, "w+b");
+        persist(0, image.size());
+    }
+}
+
+FileFlashDevice::~FileFlashDevice() {
+    if (file) fclose(file);
+}
+
+uint32_t FileFlashDevice::getSize() {
+    return file ? image.size() : 0;
+}
+
+uint32_t FileFlashDevice::getSectorSize() {
+    return sectorSize;
+}
+
+bool FileFlashDevice::read(uint32_t offset, void* data, uint32_t length) {
+    if (!powered || offset + length > image.size()) return false;
+    memcpy(data, image.data() + offset, length);
+    return true;
+}
+
+bool FileFlashDevice::write(uint32_t offset, const void* data, uint32_t length) {
+    if (!powered || offset + length > image.size()) return false;
+
+    // A cut leaves a prefix of the data written
+    uint32_t done = takeBudget(length);
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (uint32_t i = 0; i < done; i++) {
+        image[offset + i] &= bytes[i];
+    }
+    bytesWritten += done;
+    persist(offset, done);
+    return done == length;
+}
+
+bool FileFlashDevice::eraseSector(uint32_t sector) {
+    if (!powered || sector >= eraseCounts.size()) return false;
+
+    // A cut leaves the sector partly erased, scattered over the sector
+    // rather than from the start, so the old headers may survive
+    uint32_t done = takeBudget(sectorSize);
+    uint8_t* base = image.data() + sector * sectorSize;
+    if (done == sectorSize) {
+        memset(base, 0xFF, sectorSize);
+    } else {
+        for (uint32_t i = 0; i < sectorSize; i++) {
+            if ((i * 2654435761u) % sectorSize < done) base[i] = 0xFF;
+        }
+    }
+    eraseCounts[sector]++;
+    persist(sector * sectorSize, sectorSize);
+    return done == sectorSize;
+}
+
+void FileFlashDevice::cutPowerAfter(uint32_t bytes) {
+    cutArmed = true;
+    cutBudget = bytes;
+}
+
+void FileFlashDevice::restorePower() {
+    powered = true;
+    cutArmed = false;
+}
+
+uint32_t FileFlashDevice::getEraseCount(uint32_t sector) const {
+    return sector < eraseCounts.size() ? eraseCounts[sector] : 0;
+}
+
+uint32_t FileFlashDevice::takeBudget(uint32_t length) {
+    if (!cutArmed) return length;
+    if (length < cutBudget) {
+        cutBudget -= length;
+        return length;
+    }
+    uint32_t done = cutBudget;
+    cutBudget = 0;
+    powered = false;
+    return done;
+}
+
+void FileFlashDevice::persist(uint32_t offset, uint32_t length) {
+    if (!file || length == 0) return;
+    fseek(file, offset, SEEK_SET);
+    fwrite(image.data() + offset, 1, length, file);
+    fflush(file);
+}
+#endif
@@ -0,0 +1,205 @@
+#include "hx711_parallel_reader.h"
+
+HX711ParallelReader::HX711ParallelReader() {
+    port = nullptr;
+    channelCount = 0;
+    gainPulses = 1;
+    sharedClock = false;
+
+    for (int i = 0; i < HX711_PARALLEL_MAX_CHANNELS; i++) {
+        doutPins[i] = 0;
+        clkMasks[i] = 0;
+        doutMasks[i] = 0;
+        groupMasks[i] = 0;
+    }
+}
+
+void HX711ParallelReader::begin(GpioPort* gpioPort, const int* clkPins, const int* doutPinList, int count, uint8_t gain) {
+    port = gpioPort;
+    channelCount = count > HX711_PARALLEL_MAX_CHANNELS ? HX711_PARALLEL_MAX_CHANNELS : count;
+    gainPulses = gain;
+
+    for (int i = 0; i < channelCount; i++) {
+        doutPins[i] = (uint8_t)doutPinList[i];
+        clkMasks[i] = 1UL << clkPins[i];
+        doutMasks[i] = 1UL << doutPinList[i];
+    }
+
+    setActiveChannels(0xFFFFFFFFUL);
+}
+
+void HX711ParallelReader::setActiveChannels(uint32_t channelMask) {
+    sharedClock = false;
+
+    for (int i = 0; i < channelCount; i++) {
+        uint32_t group = 1UL << i;
+        for (int j = 0; j < channelCount; j++) {
+            if (j != i && (channelMask & (1UL << j)) && (clkMasks[j] & clkMasks[i])) {
+                group |= 1UL << j;
+            }
+        }
+        groupMasks[i] = group;
+        if (group != (1UL << i)) {
+            sharedClock = true;
+        }
+    }
+}
+
+uint32_t HX711ParallelReader::readyMask() {
+    if (!port) return 0;
+
+    uint32_t levels = port->readInputs();
+    uint32_t ready = 0;
+
+    for (int i = 0; i < channelCount; i++) {
+        if ((levels & doutMasks[i]) == 0) {
+            ready |= 1UL << i;
+        }
+    }
+
+    if (!sharedClock) {
+        return ready;
+    }
+
+    // Clocking a shared line while one member is still converting would
+    // corrupt that member's result, so groups become readable together
+    uint32_t readable = 0;
+    for (int i = 0; i < channelCount; i++) {
+        if ((ready & groupMasks[i]) == groupMasks[i]) {
+            readable |= 1UL << i;
+        }
+    }
+    return readable;
+}
+
+uint32_t HX711ParallelReader::read(uint32_t channelMask, long* values) {
+    channelMask &= channelCount < 32 ? (1UL << channelCount) - 1 : 0xFFFFFFFFUL;
+    if (!port || channelMask == 0) return 0;
+
+    if (sharedClock) {
+        uint32_t expanded = channelMask;
+        for (int i = 0; i < channelCount; i++) {
+            if (channelMask & (1UL << i)) {
+                expanded |= groupMasks[i];
+            }
+        }
+        channelMask = expanded;
+    }
+
+    uint32_t clk = clkMaskFor(channelMask);
+    uint32_t frames[HX711_DATA_BITS];
+
+    // CLK must not stay high for more than 60us or the HX711 powers down,
+    // so the whole frame runs without interruption
+    port->beginFrame();
+
+    // DOUT changes on the rising edge and holds until the next one, so it is
+    // sampled with CLK low; a slow input port then never stretches the pulse
+    for (int bit = 0; bit < HX711_DATA_BITS; bit++) {
+        port->setOutputs(clk);
+        port->settle();
+        port->clearOutputs(clk);
+        port->settle();
+        frames[bit] = port->readInputs();
+    }
+
+    // Extra pulses select gain/channel for the next conversion
+    for (int i = 0; i < gainPulses; i++) {
+        port->setOutputs(clk);
+        port->settle();
+        port->clearOutputs(clk);
+        port->settle();
+    }
+
+    // DOUT toggles while data is shifted out; those edges are not new conversions
+    port->clearEdges(doutMaskFor(channelMask));
+    port->endFrame();
+
+    unpackFrames(frames, doutPins, channelCount, channelMask, values);
+    return channelMask;
+}
+
+void HX711ParallelReader::unpackFrames(const uint32_t* frames, const uint8_t* pins, int count,
+                                       uint32_t channelMask, long* values) {
+    for (int ch = 0; ch < count; ch++) {
+        if (!(channelMask & (1UL << ch))) continue;
+
+        uint8_t pin = pins[ch];
+        uint32_t raw = 0;
+
+        for (int bit = 0; bit < HX711_DATA_BITS; bit++) {
+            raw = (raw << 1) | ((frames[bit] >> pin) & 1UL);
+        }
+
+        // Sign-extend the 24-bit two's complement result
+        values[ch] = (long)((int32_t)(raw << 8) >> 8);
+    }
+}
+
+uint32_t HX711ParallelReader::clkMaskFor(uint32_t channelMask) {
+    uint32_t mask = 0;
+    for (int i = 0; i < channelCount; i++) {
+        if (channelMask & (1UL << i)) {
+            mask |= clkMasks[i];
+        }
+    }
+    return mask;
+}
+
+uint32_t HX711ParallelReader::doutMaskFor(uint32_t channelMask) {
+    uint32_t mask = 0;
+    for (int i = 0; i < channelCount; i++) {
+        if (channelMask & (1UL << i)) {
+            mask |= doutMasks[i];
+        }
+    }
+    return mask;
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "soc/gpio_reg.h"
+
+static portMUX_TYPE frameMux = portMUX_INITIALIZER_UNLOCKED;
+
+void Esp32GpioPort::setOutputs(uint32_t pinMask) {
+    REG_WRITE(GPIO_OUT_W1TS_REG, pinMask);
+}
+
+void Esp32GpioPort::clearOutputs(uint32_t pinMask) {
+    REG_WRITE(GPIO_OUT_W1TC_REG, pinMask);
+}
+
+void Esp32GpioPort::configurePins(uint32_t outputMask, uint32_t inputMask) {
+    for (int pin = 0; pin < 32; pin++) {
+        if (outputMask & (1UL << pin)) {
+            pinMode(pin, OUTPUT);
+            digitalWrite(pin, LOW);
+        } else if (inputMask & (1UL << pin)) {
+            // An unconnected DOUT idles high (not ready)
+            pinMode(pin, INPUT_PULLUP);
+        }
+    }
+}
+
+uint32_t Esp32GpioPort::readInputs() {
+    return REG_READ(GPIO_IN_REG);
+}
+
+void Esp32GpioPort::settle() {
+    // Same 1us hold the HX711 library uses on fast cores
+    delayMicroseconds(1);
+}
+
+void Esp32GpioPort::beginFrame() {
+    portENTER_CRITICAL(&frameMux);
+}
+
+void Esp32GpioPort::endFrame() {
+    portEXIT_CRITICAL(&frameMux);
+}
+
+void Esp32GpioPort::clearEdges(uint32_t pinMask) {
+    REG_WRITE(GPIO_STATUS_W1TC_REG, pinMask);
+}
+#endif
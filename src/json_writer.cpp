@@ -0,0 +1,139 @@
+#include "json_writer.h"
+#include <math.h>
+
+JsonWriter::JsonWriter(char* buffer, size_t capacity) : buffer(buffer), capacity(capacity) {
+    used = 0;
+    overflow = false;
+    needComma = false;
+    if (capacity > 0) buffer[0] = '\0';
+}
+
+void JsonWriter::beginObject(size_t) {
+    separate();
+    put('{');
+    needComma = false;
+}
+
+void JsonWriter::endObject() {
+    put('}');
+    needComma = true;
+}
+
+void JsonWriter::beginArray(size_t) {
+    separate();
+    put('[');
+    needComma = false;
+}
+
+void JsonWriter::endArray() {
+    put(']');
+    needComma = true;
+}
+
+void JsonWriter::key(const char* name) {
+    separate();
+    put('"');
+    put(name);
+    put('"');
+    put(':');
+    needComma = false;
+}
+
+void JsonWriter::value(const char* text) {
+    static const char hex[] = "0123456789abcdef";
+    separate();
+    put('"');
+    for (const char* p = text; *p; p++) {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\') {
+            put('\\');
+            put(c);
+        } else if (c < 0x20) {
+            put("\\u00");
+            put(hex[c >> 4]);
+            put(hex[c & 0xF]);
+        } else {
+            put(c);
+        }
+    }
+    put('"');
+    needComma = true;
+}
+
+void JsonWriter::value(uint32_t number) {
+    separate();
+    putUnsigned(number);
+    needComma = true;
+}
+
+void JsonWriter::value(int32_t number) {
+    separate();
+    if (number < 0) {
+        put('-');
+        putUnsigned((uint64_t)(-(int64_t)number));
+    } else {
+        putUnsigned(number);
+    }
+    needComma = true;
+}
+
+void JsonWriter::value(float number, int decimals) {
+    separate();
+    needComma = true;
+    if (isnan(number) || isinf(number)) {
+        put("null");
+        return;
+    }
+
+    uint64_t scale = 1;
+    for (int i = 0; i < decimals; i++) scale *= 10;
+    double scaled = fabs((double)number) * scale + 0.5;
+    if (scaled >= 1.8e19) {
+        put("null");
+        return;
+    }
+    uint64_t fixed = (uint64_t)scaled;
+
+    if (number < 0 && fixed != 0) put('-');
+    putUnsigned(fixed / scale);
+
+    // Fraction digits, most significant first, without trailing zeros
+    uint64_t fraction = fixed % scale;
+    if (fraction == 0) {
+        return;
+    }
+    put('.');
+    while (fraction) {
+        scale /= 10;
+        put((char)('0' + fraction / scale));
+        fraction %= scale;
+    }
+}
+
+void JsonWriter::separate() {
+    if (needComma) put(',');
+}
+
+void JsonWriter::put(char c) {
+    // One byte stays free for the terminator
+    if (used + 1 >= capacity) {
+        overflow = true;
+        return;
+    }
+    buffer[used++] = c;
+    buffer[used] = '\0';
+}
+
+void JsonWriter::put(const char* text) {
+    while (*text) put(*text++);
+}
+
+void JsonWriter::putUnsigned(uint64_t number) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + number % 10);
+        number /= 10;
+    } while (number);
+    while (count) put(digits[--count]);
+}
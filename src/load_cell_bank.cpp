@@ -0,0 +1,141 @@
+#include "load_cell_bank.h"
+
+Hx711BankAdc::Hx711BankAdc(GpioPort& port, uint8_t gainPulses)
+    : port(port) {
+    channelCount = 0;
+    this->gainPulses = gainPulses;
+}
+
+bool Hx711BankAdc::addChannel(int clkPin, int doutPin) {
+    if (channelCount >= HX711_PARALLEL_MAX_CHANNELS) {
+        return false;
+    }
+
+    clkPins[channelCount] = clkPin;
+    doutPins[channelCount] = doutPin;
+    channelCount++;
+    return true;
+}
+
+void Hx711BankAdc::begin() {
+    uint32_t clkMask = 0;
+    uint32_t doutMask = 0;
+    for (int i = 0; i < channelCount; i++) {
+        clkMask |= 1UL << clkPins[i];
+        doutMask |= 1UL << doutPins[i];
+    }
+
+    port.configurePins(clkMask, doutMask);
+    reader.begin(&port, clkPins, doutPins, channelCount, gainPulses);
+}
+
+int Hx711BankAdc::getChannelCount() {
+    return channelCount;
+}
+
+uint32_t Hx711BankAdc::readyMask() {
+    return reader.readyMask();
+}
+
+uint32_t Hx711BankAdc::read(uint32_t channelMask, int32_t* values) {
+    long raw[HX711_PARALLEL_MAX_CHANNELS];
+    uint32_t readMask = reader.read(channelMask, raw);
+
+    for (int i = 0; i < channelCount; i++) {
+        if (readMask & (1UL << i)) {
+            values[i] = (int32_t)raw[i];
+        }
+    }
+    return readMask;
+}
+
+void Hx711BankAdc::setActiveChannels(uint32_t channelMask) {
+    reader.setActiveChannels(channelMask);
+}
+
+CompositeLoadCellAdc::CompositeLoadCellAdc() {
+    bankCount = 0;
+    channelCount = 0;
+
+    for (int b = 0; b < COMPOSITE_MAX_BANKS; b++) {
+        banks[b] = nullptr;
+        offsets[b] = 0;
+        masks[b] = 0;
+    }
+}
+
+bool CompositeLoadCellAdc::addBank(LoadCellAdc& bank) {
+    if (bankCount >= COMPOSITE_MAX_BANKS) {
+        return false;
+    }
+    banks[bankCount++] = &bank;
+    return true;
+}
+
+void CompositeLoadCellAdc::begin() {
+    // Channel counts are only final once every bank has been set up
+    channelCount = 0;
+    for (int b = 0; b < bankCount; b++) {
+        banks[b]->begin();
+
+        int count = banks[b]->getChannelCount();
+        if (channelCount + count > 32) {
+            count = 32 - channelCount;
+        }
+        offsets[b] = channelCount < 32 ? channelCount : 0;
+        masks[b] = count <= 0 ? 0 : (count >= 32 ? 0xFFFFFFFFUL : ((1UL << count) - 1) << channelCount);
+        channelCount += count > 0 ? count : 0;
+    }
+}
+
+int CompositeLoadCellAdc::getChannelCount() {
+    return channelCount;
+}
+
+uint32_t CompositeLoadCellAdc::readyMask() {
+    uint32_t ready = 0;
+    for (int b = 0; b < bankCount; b++) {
+        if (!masks[b]) continue;
+        ready |= (banks[b]->readyMask() << offsets[b]) & masks[b];
+    }
+    return ready;
+}
+
+uint32_t CompositeLoadCellAdc::read(uint32_t channelMask, int32_t* values) {
+    uint32_t readMask = 0;
+    for (int b = 0; b < bankCount; b++) {
+        if (!masks[b]) continue;
+        uint32_t bankMask = (channelMask & masks[b]) >> offsets[b];
+        if (bankMask) {
+            readMask |= (banks[b]->read(bankMask, values + offsets[b]) << offsets[b]) & masks[b];
+        }
+    }
+    return readMask;
+}
+
+bool CompositeLoadCellAdc::attachDataReady(int channel, DataReadyHandler handler, void* arg) {
+    for (int b = 0; b < bankCount; b++) {
+        if (channel >= 0 && channel < 32 && (masks[b] & (1UL << channel))) {
+            return banks[b]->attachDataReady(channel - offsets[b], handler, arg);
+        }
+    }
+    return false;
+}
+
+void CompositeLoadCellAdc::setActiveChannels(uint32_t channelMask) {
+    for (int b = 0; b < bankCount; b++) {
+        if (!masks[b]) continue;
+        banks[b]->setActiveChannels((channelMask & masks[b]) >> offsets[b]);
+    }
+}
+
+bool CompositeLoadCellAdc::setHighRate(bool high) {
+    // The RATE line is normally shared, so one bank owning it is enough
+    bool switched = false;
+    for (int b = 0; b < bankCount; b++) {
+        if (banks[b]->setHighRate(high)) {
+            switched = true;
+        }
+    }
+    return switched;
+}
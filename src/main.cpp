@@ -1,22 +1,56 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <Preferences.h>
 #include "config.h"
+#include "config_store.h"
 #include "bluetooth_provisioning.h"
 #include "sensor_manager.h"
+#include "hal_esp32.h"
 #include "api_client.h"
+#include "reading_log.h"
 
 // Global objects
-BluetoothProvisioning btProvisioning;
-SensorManager sensorManager;
-APIClient apiClient;
-Preferences preferences;
+NvsKeyValueStore settingsStore;
+ConfigStore deviceConfig(settingsStore);
+BluetoothProvisioning btProvisioning(deviceConfig);
+Esp32LoadCellAdc onboardCells;
+#if HX711_EXPANSION_CHANNELS > 0
+Esp32ExpansionAdc expansionCells;
+#endif
+CompositeLoadCellAdc loadCells;
+ArduinoClock systemClock;
+SensorManager sensorManager(loadCells, systemClock, deviceConfig);
+APIClient apiClient(deviceConfig);
+Esp32PartitionFlash readingLogFlash(READING_LOG_PARTITION);
+ReadingLog readingLog(readingLogFlash, systemClock);
 
 // State management
 DeviceState currentState = STATE_PROVISIONING;
 unsigned long lastSensorRead = 0;
 unsigned long lastStateChange = 0;
 
+// Bin events taken from the sensor manager, held until the API accepts them
+WeightEvent pendingEvents[EVENT_UPLOAD_BATCH];
+int pendingEventCount = 0;
+unsigned long lastEventUpload = 0;
+bool eventUploadFailed = false;
+
+// Closed rollups taken from the sensor manager, held until the API accepts them
+Rollup pendingRollups[ROLLUP_UPLOAD_BATCH];
+int pendingRollupCount = 0;
+unsigned long lastRollupUpload = 0;
+bool rollupUploadFailed = false;
+
+// Last settled weight per bin, what is uploaded when UPLOAD_SETTLED_ONLY is set,
+// and when the one last handed on was confirmed, so each goes out once
+SensorReading settledReadings[SENSOR_MAX_CHANNELS];
+unsigned long sentSettledMs[SENSOR_MAX_CHANNELS];
+bool settledSent[SENSOR_MAX_CHANNELS];
+
+// Store-and-forward: readings taken without an uplink, drained oldest first
+SensorReading drainReadings[MAX_BUFFERED_READINGS];
+unsigned long lastLogDrain = 0;
+unsigned long lastOfflineLog = 0;
+
 // Heartbeat LED management
 unsigned long lastHeartbeat = 0;
 bool ledState = false;
@@ -27,6 +61,12 @@ void handleProvisioning();
 void handleWiFiConnection();
 void handleAPIAuthentication();
 void handleNormalOperation();
+void uploadEvents();
+void uploadRollups();
+SensorReading* collectSettledReadings();
+void drainReadingLog();
+void logHeldFrames();
+void logReadingsOffline();
 void connectToWiFi();
 void printDeviceInfo();
 void changeState(DeviceState newState);
@@ -52,36 +92,42 @@ void setup() {
 }
 
 void loop() {
+    // Collect samples handed over by the sampling task (never blocks)
+    sensorManager.update();
+    readingLog.service();
+    
     //Quick load cell sensor test
-    // Read sensors every 10 seconds
+    // Report sensors every 10 seconds
     if (millis() - lastSensorRead >= SENSOR_READ_INTERVAL) {
         #ifdef DEBUG_MODE
         Serial.println("Reading sensors...");
         #endif
         
-        // Update sensor readings
-        sensorManager.update();
         SensorReading* readings = sensorManager.getAllReadings();
         
         // Print sensor data to serial (only in debug mode)
         #ifdef DEBUG_MODE
         Serial.println("=== Sensor Readings ===");
-        for (int i = 0; i < MAX_BINS; i++) {
+        for (int i = 0; i < sensorManager.getChannelCount(); i++) {
             if (sensorManager.isSensorEnabled(i)) {
-                Serial.printf("Bin %d: %.5f kg (Valid: %s)\n", 
+                ConversionCounters counters = sensorManager.getConversionCounters(i);
+                Serial.printf("Bin %d: %.5f kg (Valid: %s, %s, captured %u, missed %u, rejected %u)\n", 
                              readings[i].bin_id, 
                              readings[i].weight, 
-                             readings[i].valid ? "Yes" : "No");
+                             readings[i].valid ? "Yes" : "No",
+                             sensorManager.isBinActive(i) ? "active" : "idle",
+                             counters.captured, counters.missed, counters.rejected);
             }
         }
+        SamplingJitterStats jitter = sensorManager.getJitterStats();
+        Serial.printf("Capture latency: mean %.1f us, jitter %u us, dropped %u\n",
+                     jitter.meanLatencyUs, jitter.maxLatencyUs - jitter.minLatencyUs, jitter.droppedSamples);
         Serial.println("=====================");
         #endif
 
         lastSensorRead = millis();
     }
 
-
-    delay(100);
     //return;
 
 
@@ -118,7 +164,12 @@ void loop() {
             break;
     }
     
-    delay(100); // Small delay to prevent watchdog issues
+    // A configured device without an uplink keeps its readings for later
+    if (currentState == STATE_WIFI_CONNECTING || currentState == STATE_API_AUTHENTICATING) {
+        logReadingsOffline();
+    }
+    
+    delay(10); // Small delay to prevent watchdog issues
 }
 
 void initializeDevice() {
@@ -128,8 +179,16 @@ void initializeDevice() {
     Serial.println("Step 1: Initializing status LED...");
     initializeLED();
     
+    // Settings are read from NVS once; everything after serves them from RAM
+    deviceConfig.load();
+    Serial.printf("Boot %u\n", deviceConfig.countBoot());
+    
     // Initialize low-power components
     Serial.println("Step 2: Initializing sensor manager...");
+    loadCells.addBank(onboardCells);
+#if HX711_EXPANSION_CHANNELS > 0
+    loadCells.addBank(expansionCells);
+#endif
     sensorManager.init();
     
     // Check if sensor initialization was successful (only in production mode)
@@ -140,6 +199,14 @@ void initializeDevice() {
         return;
     }
     
+    // Without the partition the device still runs; offline readings are lost
+    if (readingLogFlash.begin() && readingLog.mount(deviceConfig.getBootCount())) {
+        Serial.printf("Reading log: %u readings pending, capacity %u KB\n",
+                     readingLog.getPendingCount(), readingLog.getCapacityBytes() / 1024);
+    } else {
+        Serial.println("WARNING: Reading log partition not found, offline readings will not be kept");
+    }
+    
     return;     //REMOVE AFTER SENSOR TEST
 
     delay(200);  // Let sensors stabilize
@@ -263,41 +330,74 @@ void handleNormalOperation() {
         btProvisioning.startSettingsMode();
     }
     
-    // Read sensors every 10 seconds
-    if (millis() - lastSensorRead >= SENSOR_READ_INTERVAL) {
+    // Events go out as soon as they are detected
+    uploadEvents();
+    uploadRollups();
+    drainReadingLog();
+    
+    // Read sensors every 10 seconds, unless rollups replace the readings
+    if (!UPLOAD_ROLLUPS_ONLY && millis() - lastSensorRead >= SENSOR_READ_INTERVAL) {
         #ifdef DEBUG_MODE
         Serial.println("Reading sensors and submitting data...");
         #endif
         
-        // Update sensor readings
-        sensorManager.update();
+        // Latest published readings (acquisition runs every loop iteration)
         SensorReading* readings = sensorManager.getAllReadings();
         
         // Print sensor data to serial (only in debug mode)
         #ifdef DEBUG_MODE
         Serial.println("=== Sensor Readings ===");
-        for (int i = 0; i < MAX_BINS; i++) {
+        for (int i = 0; i < sensorManager.getChannelCount(); i++) {
             if (sensorManager.isSensorEnabled(i)) {
-                Serial.printf("Bin %d: %.2f kg (Valid: %s)\n", 
+                Serial.printf("Bin %d: %.2f kg (Valid: %s, Settled: %s)\n", 
                              readings[i].bin_id, 
                              readings[i].weight, 
-                             readings[i].valid ? "Yes" : "No");
+                             readings[i].valid ? "Yes" : "No",
+                             sensorManager.isSettled(i) ? "Yes" : "No");
             }
         }
+        SamplingJitterStats jitter = sensorManager.getJitterStats();
+        Serial.printf("Capture latency: mean %.1f us, jitter %u us, dropped %u\n",
+                     jitter.meanLatencyUs, jitter.maxLatencyUs - jitter.minLatencyUs, jitter.droppedSamples);
+        ApiConnectionStats api = apiClient.getConnectionStats();
+        Serial.printf("API: %u requests over %u connections (%u failed, %u stale), handshake mean %u ms max %u ms, "
+                     "request mean %u ms max %u ms\n",
+                     api.requests, api.handshakes, api.failedHandshakes, api.staleConnections,
+                     api.handshakes ? api.totalHandshakeMs / api.handshakes : 0, api.maxHandshakeMs,
+                     api.requests ? api.totalRequestMs / api.requests : 0, api.maxRequestMs);
+        #if API_GZIP_ENABLED
+        Serial.printf("API: %u bodies gzipped, %u -> %u bytes, mean %u us each\n", api.compressedRequests,
+                     api.uncompressedBytes, api.compressedBytes,
+                     api.compressedRequests ? api.totalCompressUs / api.compressedRequests : 0);
+        #endif
         Serial.println("=====================");
         #endif
         
-        // Submit data to API
-        if (apiClient.submitSensorData(readings, MAX_BINS)) {
+        // Submit data to API; each settled weight goes out once, when it is
+        // confirmed, so a moving bin or one that never settled is left out
+        if (UPLOAD_SETTLED_ONLY) {
+            readings = collectSettledReadings();
+        }
+        
+        // Behind a backlog, readings join the log so the server gets them in order
+        if (!readingLog.isEmpty() || !apiClient.addSensorFrame(readings, sensorManager.getChannelCount())) {
+            readingLog.append(readings, sensorManager.getChannelCount());
+        }
+        
+        lastSensorRead = millis();
+    }
+    
+    // Frames go out together once the batch is full or has waited long enough
+    if (apiClient.isBatchDue()) {
+        if (apiClient.flushSensorFrames()) {
             btProvisioning.broadcastDeviceStatus("connected", "authenticated", "reading");
         } else {
             #ifdef DEBUG_MODE
-            Serial.println("Failed to submit sensor data");
+            Serial.println("Failed to submit sensor data, keeping it in the reading log");
             #endif
+            logHeldFrames();
             btProvisioning.broadcastDeviceStatus("connected", "authenticated", "error");
         }
-        
-        lastSensorRead = millis();
     }
     
     // Check WiFi connection
@@ -306,23 +406,130 @@ void handleNormalOperation() {
         Serial.println("WiFi connection lost, attempting reconnection...");
         #endif
         btProvisioning.broadcastDeviceStatus("disconnected", "not_authenticated", "error");
+        apiClient.disconnect();
+        logHeldFrames();
         changeState(STATE_WIFI_CONNECTING);
     }
 }
 
-void connectToWiFi() {
-    preferences.begin(NVS_NAMESPACE, true);
-    String ssid = preferences.getString(NVS_WIFI_SSID, "");
-    String password = preferences.getString(NVS_WIFI_PASSWORD, "");
-    preferences.end();
+void uploadEvents() {
+    while (pendingEventCount < EVENT_UPLOAD_BATCH && sensorManager.popEvent(pendingEvents[pendingEventCount])) {
+        pendingEventCount++;
+    }
+    if (pendingEventCount == 0) {
+        return;
+    }
     
-    if (ssid.length() == 0) {
+    // Back off after a failure; the batch is kept and retried as is
+    if (eventUploadFailed && millis() - lastEventUpload < EVENT_UPLOAD_RETRY_MS) {
+        return;
+    }
+    
+    lastEventUpload = millis();
+    eventUploadFailed = !apiClient.submitEvents(pendingEvents, pendingEventCount);
+    if (!eventUploadFailed) {
+        pendingEventCount = 0;
+    }
+}
+
+void uploadRollups() {
+    while (pendingRollupCount < ROLLUP_UPLOAD_BATCH && sensorManager.popRollup(pendingRollups[pendingRollupCount])) {
+        pendingRollupCount++;
+    }
+    if (pendingRollupCount == 0) {
+        return;
+    }
+    
+    // Windows of all bins close together, so a partial batch waits a while
+    // for the rest; after a failure the batch is kept and retried as is
+    unsigned long waitMs = rollupUploadFailed ? EVENT_UPLOAD_RETRY_MS : ROLLUP_UPLOAD_INTERVAL_MS;
+    if ((rollupUploadFailed || pendingRollupCount < ROLLUP_UPLOAD_BATCH) && millis() - lastRollupUpload < waitMs) {
+        return;
+    }
+    
+    lastRollupUpload = millis();
+    rollupUploadFailed = !apiClient.submitRollups(pendingRollups, pendingRollupCount);
+    if (!rollupUploadFailed) {
+        pendingRollupCount = 0;
+    }
+}
+
+SensorReading* collectSettledReadings() {
+    SensorReading* readings = sensorManager.getAllReadings();
+    
+    for (int i = 0; i < sensorManager.getChannelCount(); i++) {
+        settledReadings[i].bin_id = i;
+        settledReadings[i].valid = false;
+        
+        // A window is confirmed every SETTLE_WINDOW_MS at most, and never
+        // while the bin moves; until the next one there is nothing new
+        float weight;
+        unsigned long settledMs;
+        if (!readings[i].valid || !sensorManager.getLastSettledWeight(i, weight, &settledMs) ||
+            (settledSent[i] && settledMs == sentSettledMs[i])) {
+            continue;
+        }
+        settledReadings[i].weight = weight;
+        settledReadings[i].timestamp = settledMs;
+        settledReadings[i].valid = true;
+        sentSettledMs[i] = settledMs;
+        settledSent[i] = true;
+    }
+    return settledReadings;
+}
+
+void drainReadingLog() {
+    if (readingLog.isEmpty() || millis() - lastLogDrain < READING_LOG_DRAIN_INTERVAL) {
+        return;
+    }
+    lastLogDrain = millis();
+    
+    // The RAM buffer is written out only once flash is drained, so a long
+    // backlog does not turn into a string of tiny batches
+    if (readingLog.getPendingCount() == 0 && !readingLog.flush()) {
+        return;
+    }
+    
+    uint32_t boot;
+    int count = readingLog.peek(drainReadings, MAX_BUFFERED_READINGS, boot);
+    if (count == 0) {
+        return;
+    }
+    if (apiClient.submitSensorData(drainReadings, count, boot)) {
+        readingLog.consume();
+        #ifdef DEBUG_MODE
+        Serial.printf("Reading log: sent %d readings, %u still pending\n", count,
+                     readingLog.getPendingCount() + readingLog.getBufferedCount());
+        #endif
+    }
+}
+
+void logHeldFrames() {
+    int count;
+    const SensorReading* held = apiClient.getHeldReadings(count);
+    readingLog.append(held, count);
+    apiClient.clearHeldFrames();
+}
+
+void logReadingsOffline() {
+    if (!readingLog.isMounted() || millis() - lastOfflineLog < SENSOR_READ_INTERVAL) {
+        return;
+    }
+    lastOfflineLog = millis();
+    
+    SensorReading* readings = UPLOAD_SETTLED_ONLY ? collectSettledReadings() : sensorManager.getAllReadings();
+    readingLog.append(readings, sensorManager.getChannelCount());
+}
+
+void connectToWiFi() {
+    const char* ssid = deviceConfig.getWifiSsid();
+    if (ssid[0] == '\0') {
         Serial.println("No WiFi credentials found");
         return;
     }
     
-    Serial.printf("Connecting to WiFi: %s\n", ssid.c_str());
-    WiFi.begin(ssid.c_str(), password.c_str());
+    Serial.printf("Connecting to WiFi: %s\n", ssid);
+    WiFi.begin(ssid, deviceConfig.getWifiPassword());
     
     // Wait for connection with timeout
     unsigned long startTime = millis();
@@ -338,7 +545,7 @@ void printDeviceInfo() {
     Serial.printf("Device Name: %s\n", DEVICE_NAME);
     Serial.printf("Firmware Version: %s\n", FIRMWARE_VERSION);
     Serial.printf("MAC Address: %s\n", WiFi.macAddress().c_str());
-    Serial.printf("Supported Bins: %d\n", MAX_BINS);
+    Serial.printf("Supported Bins: %d\n", sensorManager.getChannelCount());
     Serial.printf("Current State: %d\n", currentState);
     Serial.println("========================\n");
 }
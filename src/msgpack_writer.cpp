@@ -0,0 +1,99 @@
+#include "msgpack_writer.h"
+#include <string.h>
+
+MsgPackWriter::MsgPackWriter(uint8_t* buffer, size_t capacity) : buffer(buffer), capacity(capacity) {
+    used = 0;
+    overflow = false;
+}
+
+void MsgPackWriter::beginObject(size_t members) {
+    putContainer(members, 0x80, 15, 0xde, 0xdf);
+}
+
+void MsgPackWriter::beginArray(size_t items) {
+    putContainer(items, 0x90, 15, 0xdc, 0xdd);
+}
+
+void MsgPackWriter::key(const char* name) {
+    value(name);
+}
+
+void MsgPackWriter::value(const char* text) {
+    size_t length = strlen(text);
+    if (length < 32) {
+        put(0xa0 | length);
+    } else if (length < 256) {
+        put(0xd9);
+        put(length);
+    } else {
+        put(0xda);
+        putBig(length, 2);
+    }
+    for (size_t i = 0; i < length; i++) put(text[i]);
+}
+
+void MsgPackWriter::value(uint32_t number) {
+    if (number < 128) {
+        put(number);
+    } else if (number < 256) {
+        put(0xcc);
+        put(number);
+    } else if (number < 65536) {
+        put(0xcd);
+        putBig(number, 2);
+    } else {
+        put(0xce);
+        putBig(number, 4);
+    }
+}
+
+void MsgPackWriter::value(int32_t number) {
+    if (number >= 0) {
+        value((uint32_t)number);
+    } else if (number >= -32) {
+        put((uint8_t)number);       // Negative fixint
+    } else if (number >= -128) {
+        put(0xd0);
+        put((uint8_t)number);
+    } else if (number >= -32768) {
+        put(0xd1);
+        putBig((uint16_t)number, 2);
+    } else {
+        put(0xd2);
+        putBig((uint32_t)number, 4);
+    }
+}
+
+void MsgPackWriter::value(float number, int decimals) {
+    (void)decimals;
+    uint32_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    put(0xca);
+    putBig(bits, 4);
+}
+
+void MsgPackWriter::put(uint8_t byte) {
+    if (used >= capacity) {
+        overflow = true;
+        return;
+    }
+    buffer[used++] = byte;
+}
+
+void MsgPackWriter::putBig(uint32_t value, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        put((uint8_t)(value >> shift));
+    }
+}
+
+void MsgPackWriter::putContainer(size_t count, uint8_t fixBase, int fixLimit, uint8_t code16, uint8_t code32) {
+    if (count <= (size_t)fixLimit) {
+        put(fixBase | count);
+    } else if (count < 65536) {
+        put(code16);
+        putBig(count, 2);
+    } else {
+        put(code32);
+        putBig(count, 4);
+    }
+}
@@ -0,0 +1,251 @@
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+// Host simulator for the sensor stack (env:native). Runs SensorManager
+// against a simulated HX711 bank on a virtual clock and reports the
+// readings and the CPU cost of update().
+//
+//   .pio/build/native/program [--seconds N] [--bins N] [--seed N]
+//       [--noise COUNTS] [--drift COUNTS_PER_HOUR] [--dropout RATE]
+//       [--glitch RATE] [--missing BIN] [--stuck BIN] [--connected N]
+//       [--fill BIN] [--fixed-rate] [--step-us N] [--trace] [--quiet]
+//
+// --fill ramps one bin by 0.5 kg/s for 15 s in every 2 minutes, then takes
+// 2 kg out 25 s later (or empties it to 0.3 kg past 20 kg), to exercise the
+// adaptive sampler and the event detector; --fixed-rate models a board with
+// RATE tied low. In the per-second lines `*` marks an active bin and `~`
+// one that has not settled. Closed rollups are printed as they come; the
+// summary compares their number with the periodic readings they replace.
+#include <chrono>
+#include "config.h"
+#include "config_store.h"
+#include "hal_native.h"
+#include "sensor_manager.h"
+
+struct SimulationOptions {
+    uint32_t seconds;
+    int bins;
+    uint32_t seed;
+    float noiseCounts;
+    float driftCountsPerHour;
+    float dropoutRate;
+    float glitchRate;
+    int missingBin;
+    int stuckBin;
+    int connected;
+    int fillBin;
+    bool fixedRate;
+    uint32_t stepUs;
+    bool trace;
+    bool quiet;
+};
+
+static bool parseOptions(int argc, char** argv, SimulationOptions& options) {
+    options.seconds = 60;
+    options.bins = MAX_BINS;
+    options.seed = 1;
+    options.noiseCounts = 50.0f;
+    options.driftCountsPerHour = 0.0f;
+    options.dropoutRate = 0.0f;
+    options.glitchRate = 0.0f;
+    options.missingBin = -1;
+    options.stuckBin = -1;
+    options.connected = -1;
+    options.fillBin = -1;
+    options.fixedRate = false;
+    options.stepUs = 1000;
+    options.trace = false;
+    options.quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--trace") == 0) {
+            options.trace = true;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+        } else if (strcmp(arg, "--fixed-rate") == 0) {
+            options.fixedRate = true;
+        } else if (!value) {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            return false;
+        } else {
+            i++;
+            if (strcmp(arg, "--seconds") == 0) options.seconds = strtoul(value, nullptr, 10);
+            else if (strcmp(arg, "--bins") == 0) options.bins = atoi(value);
+            else if (strcmp(arg, "--seed") == 0) options.seed = strtoul(value, nullptr, 10);
+            else if (strcmp(arg, "--noise") == 0) options.noiseCounts = atof(value);
+            else if (strcmp(arg, "--drift") == 0) options.driftCountsPerHour = atof(value);
+            else if (strcmp(arg, "--dropout") == 0) options.dropoutRate = atof(value);
+            else if (strcmp(arg, "--glitch") == 0) options.glitchRate = atof(value);
+            else if (strcmp(arg, "--missing") == 0) options.missingBin = atoi(value);
+            else if (strcmp(arg, "--stuck") == 0) options.stuckBin = atoi(value);
+            else if (strcmp(arg, "--connected") == 0) options.connected = atoi(value);
+            else if (strcmp(arg, "--fill") == 0) options.fillBin = atoi(value);
+            else if (strcmp(arg, "--step-us") == 0) options.stepUs = strtoul(value, nullptr, 10);
+            else {
+                fprintf(stderr, "Unknown option: %s\n", arg);
+                return false;
+            }
+        }
+    }
+
+    if (options.bins < 1 || options.bins > SENSOR_MAX_CHANNELS || options.stepUs == 0) {
+        fprintf(stderr, "--bins must be 1-%d and --step-us non-zero\n", SENSOR_MAX_CHANNELS);
+        return false;
+    }
+    if (options.connected < 0 || options.connected > options.bins) {
+        options.connected = options.bins;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    SimulationOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    VirtualClock clock;
+    MemoryKeyValueStore store;
+    ConfigStore config(store);
+    config.load();
+    SimulatedLoadCellBank bank(clock, options.bins, options.seed);
+    bank.setRatePinWired(!options.fixedRate);
+    SensorManager manager(bank, clock, config);
+
+    // Same defaults SensorManager starts from
+    float scaleFactors[] = HX711_DEFAULT_SCALE_FACTORS;
+    int scaleCount = sizeof(scaleFactors) / sizeof(scaleFactors[0]);
+    for (int i = 0; i < options.bins; i++) {
+        SimulatedLoadCell& cell = bank.cell(i);
+        cell.countsPerKg = i < scaleCount ? scaleFactors[i] : HX711_DEFAULT_SCALE_FACTOR;
+        cell.noiseCounts = options.noiseCounts;
+        cell.driftCountsPerHour = options.driftCountsPerHour;
+        cell.dropoutRate = options.dropoutRate;
+        cell.glitchRate = options.glitchRate;
+        cell.glitchCounts = 50000;
+        // Channels past --connected model unpopulated expansion slots
+        cell.present = (i != options.missingBin) && i < options.connected;
+        cell.stuck = (i == options.stuckBin);
+    }
+
+    // Bins are empty at power-up so the first-boot tare sees zero load
+    manager.init();
+
+    float loads[SENSOR_MAX_CHANNELS];
+    for (int i = 0; i < options.bins; i++) {
+        loads[i] = 2.0f + 4.0f * i;
+        bank.setLoad(i, loads[i]);
+    }
+
+    if (options.trace) {
+        manager.startTrace();
+    }
+
+    uint64_t endUs = clock.nowMicros() + (uint64_t)options.seconds * 1000000ULL;
+    uint64_t nextReportUs = clock.nowMicros() + 1000000ULL;
+    uint64_t updates = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t highRateUs = 0;
+    uint32_t eventCounts[3] = {0, 0, 0};
+    uint32_t rollupCounts[ROLLUP_WINDOW_COUNT] = {};
+    uint64_t startUs = clock.nowMicros();
+
+    while (clock.nowMicros() < endUs) {
+        clock.advanceMicros(options.stepUs);
+        if (bank.isHighRate()) highRateUs += options.stepUs;
+
+        // Filling 60-75 s into every 2 minute cycle, a removal at 100 s
+        if (options.fillBin >= 0 && options.fillBin < options.bins) {
+            uint64_t cycleUs = (clock.nowMicros() - startUs) % 120000000ULL;
+            float& load = loads[options.fillBin];
+            if (cycleUs >= 60000000ULL && cycleUs < 75000000ULL) {
+                load += 0.5f * options.stepUs / 1e6f;
+                bank.setLoad(options.fillBin, load);
+            } else if (cycleUs >= 100000000ULL && cycleUs < 100000000ULL + options.stepUs) {
+                load = load > 20.0f ? 0.3f : load - 2.0f;
+                bank.setLoad(options.fillBin, load);
+            }
+        }
+
+        WeightEvent event;
+        while (manager.popEvent(event)) {
+            eventCounts[event.type < 3 ? event.type : 0]++;
+            if (!options.quiet) {
+                printf("event: bin %u %s %.3f -> %.3f kg, %.1f-%.1f s\n", event.binId,
+                       WeightEventDetector::typeName(event.type), event.beforeKg, event.afterKg,
+                       event.startMs / 1000.0, event.settledMs / 1000.0);
+            }
+        }
+
+        Rollup rollup;
+        while (manager.popRollup(rollup)) {
+            rollupCounts[rollup.window]++;
+            if (!options.quiet) {
+                printf("rollup: bin %u %us from %.0f s, %u readings, min %.3f max %.3f mean %.3f last %.3f kg\n",
+                       rollup.binId, rollup.lengthMs / 1000, rollup.startMs / 1000.0, rollup.count,
+                       rollup.minKg, rollup.maxKg, rollup.meanKg, rollup.lastKg);
+            }
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        manager.update();
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        updates++;
+        totalNs += ns;
+        if (ns > maxNs) maxNs = ns;
+
+        if (!options.quiet && clock.nowMicros() >= nextReportUs) {
+            nextReportUs += 1000000ULL;
+            SensorReading* readings = manager.getAllReadings();
+            printf("t=%6.1fs", clock.nowMicros() / 1e6);
+            for (int i = 0; i < options.bins; i++) {
+                if (manager.isSensorEnabled(i)) {
+                    printf("  bin%d %7.3f%s%s%s", i, readings[i].weight, readings[i].valid ? "" : "!",
+                           manager.isBinActive(i) ? "*" : "", manager.isSettled(i) ? "" : "~");
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    if (options.trace) {
+        manager.stopTrace();
+        manager.update();
+    }
+
+    printf("\nSimulated %u s in %llu update() calls: %.0f ns mean, %llu ns max\n",
+           options.seconds, (unsigned long long)updates,
+           updates ? (double)totalNs / updates : 0.0, (unsigned long long)maxNs);
+    printf("HX711s at 80 SPS for %.1f s of %u s\n", highRateUs / 1e6, options.seconds);
+    printf("Events: %u deposits, %u removals, %u collections, %u dropped\n",
+           eventCounts[WEIGHT_EVENT_DEPOSIT], eventCounts[WEIGHT_EVENT_REMOVAL],
+           eventCounts[WEIGHT_EVENT_COLLECTION], manager.getDroppedEventCount());
+    uint32_t rollupTotal = 0;
+    printf("Rollups:");
+    for (int i = 0; i < ROLLUP_WINDOW_COUNT; i++) {
+        printf(" %u x %us,", rollupCounts[i], RollupTracker::windowLength(i) / 1000);
+        rollupTotal += rollupCounts[i];
+    }
+    printf(" %u dropped; %u rollups in place of %u periodic readings\n", manager.getDroppedRollupCount(),
+           rollupTotal, options.seconds * 1000 / SENSOR_READ_INTERVAL * manager.getConnectedSensorCount());
+    printf("Settings: %u NVS commits\n", store.getCommitCount());
+
+    SensorReading* readings = manager.getAllReadings();
+    for (int i = 0; i < options.bins; i++) {
+        ConversionCounters counters = manager.getConversionCounters(i);
+        float settledKg = 0.0f;
+        unsigned long settledAt = 0;
+        bool settled = manager.getLastSettledWeight(i, settledKg, &settledAt);
+        printf("Bin %d: %s, load %.3f kg, reading %.3f kg (%s), settled %.3f kg at %.1f s%s, "
+               "conversions %u, captured %u, missed %u, rejected %u\n",
+               i, manager.isSensorEnabled(i) ? "enabled" : "disabled", loads[i], readings[i].weight,
+               readings[i].valid ? "valid" : "invalid", settledKg, settledAt / 1000.0, settled ? "" : " (never)",
+               bank.getCompletedConversions(i), counters.captured, counters.missed, counters.rejected);
+    }
+    return 0;
+}
+#endif
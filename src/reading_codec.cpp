@@ -0,0 +1,215 @@
+#include "reading_codec.h"
+#include <math.h>
+
+#if SENSOR_MAX_CHANNELS > 32
+#error "ReadingEncoder stores bin ids in 5 bits"
+#endif
+
+// Prefix-coded magnitude classes: '0', '10', '110', '1110', '1111'
+struct ValueClass {
+    uint32_t prefix;
+    int prefixBits;
+    int payloadBits;
+};
+
+static const ValueClass timestampClasses[] = {
+    { 0x0, 1, 0 }, { 0x2, 2, 7 }, { 0x6, 3, 9 }, { 0xE, 4, 12 }, { 0xF, 4, 32 }
+};
+
+static const ValueClass weightClasses[] = {
+    { 0x0, 1, 0 }, { 0x2, 2, 4 }, { 0x6, 3, 8 }, { 0xE, 4, 16 }, { 0xF, 4, 32 }
+};
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static int32_t toFixed(float kg) {
+    float scaled = kg * READING_CODEC_UNITS_PER_KG;
+    if (!(scaled == scaled)) return 0;                  // NaN
+    if (scaled >= 2147483520.0f) return INT32_MAX;
+    if (scaled <= -2147483520.0f) return INT32_MIN;
+    return (int32_t)lroundf(scaled);
+}
+
+static bool writeClassed(BitWriter& bits, const ValueClass* classes, uint32_t value) {
+    for (int i = 0; i < 5; i++) {
+        const ValueClass& c = classes[i];
+        if (c.payloadBits == 32 || value < (1UL << c.payloadBits)) {
+            return bits.write(c.prefix, c.prefixBits) && (c.payloadBits == 0 || bits.write(value, c.payloadBits));
+        }
+    }
+    return false;
+}
+
+static bool readClassed(BitReader& bits, const ValueClass* classes, uint32_t& value) {
+    // Count the leading ones of the prefix, at most four
+    int ones = 0;
+    uint32_t bit;
+    while (ones < 4) {
+        if (!bits.read(1, bit)) return false;
+        if (!bit) break;
+        ones++;
+    }
+    const ValueClass& c = classes[ones];
+    value = 0;
+    return c.payloadBits == 0 || bits.read(c.payloadBits, value);
+}
+
+BitWriter::BitWriter(uint8_t* buffer, size_t capacity) : buffer(buffer), capacity(capacity) {
+    bitCount = 0;
+}
+
+void BitWriter::reset() {
+    bitCount = 0;
+}
+
+bool BitWriter::write(uint32_t value, int bits) {
+    if ((size_t)bits > getRemainingBits()) {
+        return false;
+    }
+    while (bits > 0) {
+        size_t byteIndex = bitCount >> 3;
+        int used = bitCount & 7;
+        int room = 8 - used;
+        int take = bits < room ? bits : room;
+        uint8_t chunk = (uint8_t)((value >> (bits - take)) & ((1U << take) - 1));
+
+        if (used == 0) buffer[byteIndex] = 0;
+        buffer[byteIndex] |= (uint8_t)(chunk << (room - take));
+        bitCount += take;
+        bits -= take;
+    }
+    return true;
+}
+
+BitReader::BitReader(const uint8_t* data, size_t length) : data(data), length(length) {
+    bitCount = 0;
+}
+
+bool BitReader::read(int bits, uint32_t& value) {
+    if (bitCount + bits > length * 8) {
+        return false;
+    }
+    value = 0;
+    while (bits > 0) {
+        int used = bitCount & 7;
+        int room = 8 - used;
+        int take = bits < room ? bits : room;
+        uint32_t chunk = (data[bitCount >> 3] >> (room - take)) & ((1U << take) - 1);
+
+        value = (value << take) | chunk;
+        bitCount += take;
+        bits -= take;
+    }
+    return true;
+}
+
+ReadingEncoder::ReadingEncoder(uint8_t* buffer, size_t capacity) : bits(buffer, capacity) {
+    reset();
+}
+
+void ReadingEncoder::reset() {
+    bits.reset();
+    count = 0;
+    lastBin = -1;
+    seenBins = 0;
+}
+
+bool ReadingEncoder::add(const SensorReading& reading) {
+    int bin = reading.bin_id;
+    if (bin < 0 || bin >= SENSOR_MAX_CHANNELS || bits.getRemainingBits() < (size_t)MAX_READING_BITS) {
+        return false;
+    }
+
+    if (bin == lastBin + 1) {
+        bits.write(0, 1);
+    } else {
+        bits.write(1, 1);
+        bits.write(bin, 5);
+    }
+    bits.write(reading.valid ? 1 : 0, 1);
+
+    uint32_t timestamp = (uint32_t)reading.timestamp;
+    int32_t weight = toFixed(reading.weight);
+    uint32_t bit = 1UL << bin;
+
+    if (!(seenBins & bit)) {
+        bits.write(timestamp, 32);
+        bits.write((uint32_t)weight, 32);
+        prevDelta[bin] = 0;
+        seenBins |= bit;
+    } else {
+        // Unsigned arithmetic so wrapping millis() round-trips exactly
+        int32_t delta = (int32_t)(timestamp - prevTimestamp[bin]);
+        writeClassed(bits, timestampClasses, zigzag((int32_t)((uint32_t)delta - (uint32_t)prevDelta[bin])));
+        writeClassed(bits, weightClasses, zigzag((int32_t)((uint32_t)weight - (uint32_t)prevWeight[bin])));
+        prevDelta[bin] = delta;
+    }
+
+    prevTimestamp[bin] = timestamp;
+    prevWeight[bin] = weight;
+    lastBin = bin;
+    count++;
+    return true;
+}
+
+ReadingDecoder::ReadingDecoder(const uint8_t* data, size_t length, int count) : bits(data, length) {
+    remaining = count;
+    lastBin = -1;
+    seenBins = 0;
+}
+
+bool ReadingDecoder::next(SensorReading& reading) {
+    if (remaining <= 0) {
+        return false;
+    }
+
+    uint32_t explicitBin;
+    uint32_t value;
+    if (!bits.read(1, explicitBin)) return false;
+    if (explicitBin) {
+        if (!bits.read(5, value)) return false;
+    } else {
+        value = lastBin + 1;
+    }
+    if (value >= SENSOR_MAX_CHANNELS) return false;
+    int bin = value;
+
+    uint32_t valid;
+    if (!bits.read(1, valid)) return false;
+
+    uint32_t timestamp;
+    uint32_t weight;
+    uint32_t bit = 1UL << bin;
+    if (!(seenBins & bit)) {
+        if (!bits.read(32, timestamp) || !bits.read(32, weight)) return false;
+        prevDelta[bin] = 0;
+        seenBins |= bit;
+    } else {
+        uint32_t dod;
+        uint32_t weightDelta;
+        if (!readClassed(bits, timestampClasses, dod) || !readClassed(bits, weightClasses, weightDelta)) {
+            return false;
+        }
+        int32_t delta = (int32_t)((uint32_t)prevDelta[bin] + (uint32_t)unzigzag(dod));
+        timestamp = prevTimestamp[bin] + (uint32_t)delta;
+        weight = (uint32_t)prevWeight[bin] + (uint32_t)unzigzag(weightDelta);
+        prevDelta[bin] = delta;
+    }
+
+    prevTimestamp[bin] = timestamp;
+    prevWeight[bin] = (int32_t)weight;
+    lastBin = bin;
+    remaining--;
+
+    reading.bin_id = bin;
+    reading.valid = valid != 0;
+    reading.timestamp = timestamp;
+    reading.weight = (int32_t)weight / (float)READING_CODEC_UNITS_PER_KG;
+    return true;
+}
@@ -0,0 +1,456 @@
+#include "reading_log.h"
+#include <string.h>
+#include "crc32.h"
+
+#define LOG_MAGIC 0x324C4253UL         // "SBL2"
+#define LOG_SECTOR_HEADER_SIZE 12
+#define LOG_BATCH_HEADER_SIZE 16
+#define LOG_STATE_PENDING 0xFFFF
+
+static void writeU16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void writeU32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static uint16_t readU16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+ReadingLog::ReadingLog(FlashDevice& flash, Clock& clock)
+    : flash(flash), clock(clock), encoder(block, sizeof(block)) {
+    mounted = false;
+    boot = 0;
+    sectorSize = 0;
+    sectorCount = 0;
+    nextSeq = 1;
+    headSector = -1;
+    appendOffset = 0;
+    cursor.sector = -1;
+    cursor.offset = 0;
+    peekBatches = 0;
+    pendingCount = 0;
+    droppedCount = 0;
+    bufferedSinceMs = 0;
+    memset(sectorSeq, 0, sizeof(sectorSeq));
+}
+
+bool ReadingLog::mount(uint32_t boot) {
+    mounted = false;
+    this->boot = boot;
+    sectorSize = flash.getSectorSize();
+    uint32_t size = flash.getSize();
+    if (size == 0 || sectorSize < LOG_SECTOR_HEADER_SIZE + LOG_BATCH_HEADER_SIZE + READING_LOG_BLOCK_BYTES) {
+        return false;
+    }
+    sectorCount = size / sectorSize;
+    if (sectorCount > READING_LOG_MAX_SECTORS) {
+        sectorCount = READING_LOG_MAX_SECTORS;
+    }
+    if (sectorCount < 2) {
+        return false;
+    }
+
+    nextSeq = 1;
+    headSector = -1;
+    appendOffset = sectorSize;
+    cursor.sector = -1;
+    peekBatches = 0;
+    pendingCount = 0;
+
+    // Sector headers give the ring order; the newest sector is the head
+    for (int s = 0; s < sectorCount; s++) {
+        uint8_t header[LOG_SECTOR_HEADER_SIZE];
+        sectorSeq[s] = 0;
+        if (!flash.read(s * sectorSize, header, sizeof(header))) {
+            continue;
+        }
+        uint32_t seq = readU32(header + 4);
+        if (readU32(header) != LOG_MAGIC || seq != ~readU32(header + 8) || seq == 0) {
+            continue;
+        }
+        sectorSeq[s] = seq;
+        if (seq >= nextSeq) {
+            nextSeq = seq + 1;
+            headSector = s;
+        }
+    }
+
+    // Appends resume after the last complete batch of the head, provided
+    // everything after it is still erased; otherwise the head is closed
+    if (headSector >= 0) {
+        Position pos = { headSector, LOG_SECTOR_HEADER_SIZE };
+        BatchHeader header;
+        while (readBatchHeader(pos, header)) {
+            if (header.count == 0xFFFF && header.countCheck == 0xFFFF) {
+                if (isErased(headSector * sectorSize + pos.offset, sectorSize - pos.offset)) {
+                    appendOffset = pos.offset;
+                }
+                break;
+            }
+            if (!isValidBatch(pos, header)) {
+                break;
+            }
+            pos.offset += LOG_BATCH_HEADER_SIZE + header.length;
+        }
+    }
+
+    for (int s = oldestSector(); s >= 0; s = nextSectorInOrder(s)) {
+        uint32_t pending = countPending(s);
+        if (pending > 0 && cursor.sector < 0) {
+            cursor.sector = s;
+            cursor.offset = LOG_SECTOR_HEADER_SIZE;
+        }
+        pendingCount += pending;
+    }
+
+    mounted = true;
+    return true;
+}
+
+bool ReadingLog::append(const SensorReading* readings, int count) {
+    if (!mounted) {
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        if (!readings[i].valid) {
+            continue;
+        }
+        if (encoder.getCount() == 0) {
+            bufferedSinceMs = clock.millis();
+        }
+        bool added = encoder.getCount() < MAX_BUFFERED_READINGS && encoder.add(readings[i]);
+
+        // A full block goes to flash and the reading starts the next one
+        if (!added) {
+            ok = flush() && ok;
+            if (encoder.getCount() == 0) {
+                bufferedSinceMs = clock.millis();
+                added = encoder.add(readings[i]);
+            }
+        }
+        // Flash refused the block; the newest reading gives way
+        if (!added) {
+            droppedCount++;
+        }
+    }
+
+    if (encoder.getCount() == MAX_BUFFERED_READINGS) {
+        ok = flush() && ok;
+    }
+    return ok;
+}
+
+bool ReadingLog::service() {
+    if (encoder.getCount() == 0 || clock.millis() - bufferedSinceMs < BUFFER_SAVE_INTERVAL) {
+        return true;
+    }
+    return flush();
+}
+
+bool ReadingLog::flush() {
+    if (!mounted) {
+        return false;
+    }
+
+    if (encoder.getCount() == 0) {
+        return true;
+    }
+
+    // A batch never spans sectors; a block that does not fit closes the head
+    uint16_t length = encoder.getByteCount();
+    if (headSector < 0 || appendOffset + LOG_BATCH_HEADER_SIZE + length > sectorSize) {
+        if (!openNextSector()) {
+            return false;
+        }
+    }
+
+    // A block that did not reach flash is kept for the next attempt
+    if (!writeBatch(block, length, encoder.getCount())) {
+        return false;
+    }
+    encoder.reset();
+    return true;
+}
+
+int ReadingLog::peek(SensorReading* out, int maxReadings, uint32_t& boot) {
+    peekBatches = 0;
+    boot = 0;
+    if (!mounted || cursor.sector < 0) {
+        return 0;
+    }
+
+    Position pos = cursor;
+    BatchHeader header;
+    int count = 0;
+    while (nextBatch(pos, header)) {
+        uint32_t length = LOG_BATCH_HEADER_SIZE + header.length;
+        if (header.state != LOG_STATE_PENDING) {
+            // Uploaded batches in front of the first pending one move the cursor on
+            pos.offset += length;
+            if (count == 0) {
+                cursor = pos;
+            }
+            continue;
+        }
+        // Timestamps of different boots cannot share an upload
+        if (count + header.count > maxReadings || (count > 0 && header.boot != boot)) {
+            break;
+        }
+
+        uint8_t data[READING_LOG_BLOCK_BYTES];
+        if (!flash.read(pos.sector * sectorSize + pos.offset + LOG_BATCH_HEADER_SIZE, data, header.length)) {
+            break;
+        }
+        bool intact = batchCrc(header.boot, data, header.length) == header.crc;
+        ReadingDecoder decoder(data, header.length, header.count);
+        for (int i = 0; i < header.count && intact; i++) {
+            intact = decoder.next(out[count + i]);
+        }
+
+        // A corrupt batch cannot be delivered; retire it so it is not retried
+        if (!intact) {
+            if (markSent(pos)) {
+                pendingCount -= header.count;
+            }
+            pos.offset += length;
+            if (count == 0) {
+                cursor = pos;
+            }
+            continue;
+        }
+
+        boot = header.boot;
+        count += header.count;
+        peekBatches++;
+        pos.offset += length;
+    }
+
+    if (count == 0 && pos.sector < 0) {
+        cursor.sector = -1;
+    }
+    return count;
+}
+
+bool ReadingLog::consume() {
+    if (peekBatches == 0) {
+        return false;
+    }
+
+    // New batches only ever go after the peeked ones, so the first
+    // peekBatches pending batches from the cursor are the ones returned
+    Position pos = cursor;
+    BatchHeader header;
+    bool ok = true;
+    while (peekBatches > 0 && nextBatch(pos, header)) {
+        if (header.state == LOG_STATE_PENDING) {
+            if (markSent(pos)) {
+                pendingCount -= header.count;
+            } else {
+                ok = false;
+            }
+            peekBatches--;
+        }
+        pos.offset += LOG_BATCH_HEADER_SIZE + header.length;
+    }
+    peekBatches = 0;
+
+    cursor = pos;
+    if (pendingCount == 0) {
+        cursor.sector = -1;
+    }
+    return ok;
+}
+
+uint32_t ReadingLog::getCapacityBytes() const {
+    if (sectorSize == 0) {
+        return 0;
+    }
+    // Readings per byte depend on how well they compress
+    return (sectorSize - LOG_SECTOR_HEADER_SIZE) * sectorCount;
+}
+
+bool ReadingLog::readBatchHeader(const Position& pos, BatchHeader& header) {
+    if (pos.offset + LOG_BATCH_HEADER_SIZE > sectorSize) {
+        return false;
+    }
+    uint8_t bytes[LOG_BATCH_HEADER_SIZE];
+    if (!flash.read(pos.sector * sectorSize + pos.offset, bytes, sizeof(bytes))) {
+        return false;
+    }
+    header.count = readU16(bytes);
+    header.countCheck = readU16(bytes + 2);
+    header.crc = readU32(bytes + 4);
+    header.state = readU16(bytes + 8);
+    header.length = readU16(bytes + 10);
+    header.boot = readU32(bytes + 12);
+    return true;
+}
+
+bool ReadingLog::isValidBatch(const Position& pos, const BatchHeader& header) {
+    return header.count != 0xFFFF && header.countCheck == (uint16_t)~header.count && header.count > 0 &&
+           header.length > 0 && header.length <= READING_LOG_BLOCK_BYTES &&
+           pos.offset + LOG_BATCH_HEADER_SIZE + header.length <= sectorSize;
+}
+
+uint32_t ReadingLog::batchCrc(uint32_t boot, const uint8_t* data, uint16_t length) {
+    // The boot number is covered too, so a header torn before it reached
+    // flash fails the check instead of naming the wrong boot
+    uint8_t bootBytes[4];
+    writeU32(bootBytes, boot);
+    return crc32Update(crc32Update(0, bootBytes, sizeof(bootBytes)), data, length);
+}
+
+bool ReadingLog::nextBatch(Position& pos, BatchHeader& header) {
+    while (pos.sector >= 0) {
+        bool atHead = pos.sector == headSector;
+        if (!(atHead && pos.offset >= appendOffset) && readBatchHeader(pos, header) && isValidBatch(pos, header)) {
+            return true;
+        }
+
+        // Blank, torn or at the append point: nothing more in this sector
+        if (atHead) {
+            pos.sector = -1;
+            return false;
+        }
+        pos.sector = nextSectorInOrder(pos.sector);
+        pos.offset = LOG_SECTOR_HEADER_SIZE;
+    }
+    return false;
+}
+
+int ReadingLog::nextSectorInOrder(int sector) {
+    int next = -1;
+    for (int s = 0; s < sectorCount; s++) {
+        if (sectorSeq[s] > sectorSeq[sector] && (next < 0 || sectorSeq[s] < sectorSeq[next])) {
+            next = s;
+        }
+    }
+    return next;
+}
+
+int ReadingLog::oldestSector() {
+    int oldest = -1;
+    for (int s = 0; s < sectorCount; s++) {
+        if (sectorSeq[s] != 0 && (oldest < 0 || sectorSeq[s] < sectorSeq[oldest])) {
+            oldest = s;
+        }
+    }
+    return oldest;
+}
+
+uint32_t ReadingLog::countPending(int sector) {
+    uint32_t pending = 0;
+    Position pos = { sector, LOG_SECTOR_HEADER_SIZE };
+    BatchHeader header;
+    while (nextBatch(pos, header) && pos.sector == sector) {
+        if (header.state == LOG_STATE_PENDING) {
+            pending += header.count;
+        }
+        pos.offset += LOG_BATCH_HEADER_SIZE + header.length;
+    }
+    return pending;
+}
+
+bool ReadingLog::openNextSector() {
+    int sector = headSector < 0 ? 0 : (headSector + 1) % sectorCount;
+
+    // A full ring reuses its oldest sector; readings not yet sent are lost
+    if (sectorSeq[sector] != 0) {
+        uint32_t pending = countPending(sector);
+        if (pending > 0) {
+            droppedCount += pending;
+            pendingCount -= pending;
+            peekBatches = 0;
+        }
+        if (cursor.sector == sector) {
+            cursor.sector = nextSectorInOrder(sector);
+            cursor.offset = LOG_SECTOR_HEADER_SIZE;
+        }
+    }
+
+    // Sectors without a valid header are erased too: a torn erase or header
+    // write may have left stray bits behind
+    sectorSeq[sector] = 0;
+    if (!flash.eraseSector(sector)) {
+        return false;
+    }
+
+    uint8_t header[LOG_SECTOR_HEADER_SIZE];
+    writeU32(header, LOG_MAGIC);
+    writeU32(header + 4, nextSeq);
+    writeU32(header + 8, ~nextSeq);
+    if (!flash.write(sector * sectorSize, header, sizeof(header))) {
+        return false;
+    }
+
+    sectorSeq[sector] = nextSeq++;
+    headSector = sector;
+    appendOffset = LOG_SECTOR_HEADER_SIZE;
+    return true;
+}
+
+bool ReadingLog::writeBatch(const uint8_t* data, uint16_t length, int count) {
+    Position pos = { headSector, appendOffset };
+    uint32_t base = headSector * sectorSize + appendOffset;
+
+    // Block first, header last: the header is the commit
+    if (!flash.write(base + LOG_BATCH_HEADER_SIZE, data, length)) {
+        appendOffset = sectorSize;
+        return false;
+    }
+
+    uint8_t header[LOG_BATCH_HEADER_SIZE];
+    writeU16(header, (uint16_t)count);
+    writeU16(header + 2, (uint16_t)~count);
+    writeU32(header + 4, batchCrc(boot, data, length));
+    writeU16(header + 8, LOG_STATE_PENDING);
+    writeU16(header + 10, length);
+    writeU32(header + 12, boot);
+    if (!flash.write(base, header, sizeof(header))) {
+        appendOffset = sectorSize;
+        return false;
+    }
+
+    appendOffset += LOG_BATCH_HEADER_SIZE + length;
+    pendingCount += count;
+    if (cursor.sector < 0) {
+        cursor = pos;
+    }
+    return true;
+}
+
+bool ReadingLog::markSent(const Position& pos) {
+    uint8_t sent[2] = { 0, 0 };
+    return flash.write(pos.sector * sectorSize + pos.offset + 8, sent, sizeof(sent));
+}
+
+bool ReadingLog::isErased(uint32_t offset, uint32_t length) {
+    uint8_t chunk[64];
+    while (length > 0) {
+        uint32_t n = length < sizeof(chunk) ? length : sizeof(chunk);
+        if (!flash.read(offset, chunk, n)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (chunk[i] != 0xFF) {
+                return false;
+            }
+        }
+        offset += n;
+        length -= n;
+    }
+    return true;
+}
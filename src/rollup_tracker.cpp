@@ -0,0 +1,86 @@
+#include "rollup_tracker.h"
+
+static const uint32_t windowLengths[ROLLUP_WINDOW_COUNT] = ROLLUP_WINDOWS_MS;
+
+#if ROLLUP_WINDOW_COUNT > 8
+#error "Rollup.window and openMask assume at most 8 windows"
+#endif
+
+RollupTracker::RollupTracker() {
+    reset();
+}
+
+void RollupTracker::reset() {
+    openMask = 0;
+    nextEndMs = 0;
+}
+
+uint32_t RollupTracker::windowLength(int window) {
+    return window >= 0 && window < ROLLUP_WINDOW_COUNT ? windowLengths[window] : 0;
+}
+
+int RollupTracker::addReading(float weightKg, uint32_t timestampMs, Rollup* closed) {
+    int closedCount = closeExpired(timestampMs, closed);
+
+    for (int i = 0; i < ROLLUP_WINDOW_COUNT; i++) {
+        Window& w = windows[i];
+        if (!(openMask & (1UL << i))) {
+            w.startMs = timestampMs - timestampMs % windowLengths[i];
+            w.count = 1;
+            w.minKg = weightKg;
+            w.maxKg = weightKg;
+            w.meanKg = weightKg;
+            uint32_t endMs = w.startMs + windowLengths[i];
+            if (!openMask || (int32_t)(endMs - nextEndMs) < 0) {
+                nextEndMs = endMs;
+            }
+            openMask |= 1UL << i;
+        } else {
+            w.count++;
+            if (weightKg < w.minKg) w.minKg = weightKg;
+            if (weightKg > w.maxKg) w.maxKg = weightKg;
+            w.meanKg += (weightKg - w.meanKg) / w.count;
+        }
+        w.lastKg = weightKg;
+        w.lastMs = timestampMs;
+    }
+    return closedCount;
+}
+
+int RollupTracker::closeExpired(uint32_t nowMs, Rollup* closed) {
+    // One comparison on the common path; wrap-safe like the rest of millis()
+    if (!openMask || (int32_t)(nowMs - nextEndMs) < 0) {
+        return 0;
+    }
+
+    int closedCount = 0;
+    bool first = true;
+    for (int i = 0; i < ROLLUP_WINDOW_COUNT; i++) {
+        if (!(openMask & (1UL << i))) {
+            continue;
+        }
+        const Window& w = windows[i];
+        // A sample timestamped just before the window opened counts as in it
+        if ((int32_t)(nowMs - w.startMs) >= (int32_t)windowLengths[i]) {
+            Rollup& rollup = closed[closedCount++];
+            rollup.binId = 0;
+            rollup.window = i;
+            rollup.startMs = w.startMs;
+            rollup.lengthMs = windowLengths[i];
+            rollup.count = w.count;
+            rollup.minKg = w.minKg;
+            rollup.maxKg = w.maxKg;
+            rollup.meanKg = w.meanKg;
+            rollup.lastKg = w.lastKg;
+            rollup.lastMs = w.lastMs;
+            openMask &= ~(1UL << i);
+            continue;
+        }
+        uint32_t endMs = w.startMs + windowLengths[i];
+        if (first || (int32_t)(endMs - nextEndMs) < 0) {
+            nextEndMs = endMs;
+            first = false;
+        }
+    }
+    return closedCount;
+}
@@ -0,0 +1,36 @@
+#include "sample_processor.h"
+
+SampleProcessor::SampleProcessor() {
+    cleaned = 0;
+    conversions = 0;
+}
+
+bool SampleProcessor::addConversion(int32_t raw, int32_t& filteredRaw) {
+    cleaned = outliers.process(raw);
+    int32_t filtered = filter.process(cleaned);
+    conversions++;
+    
+    if (conversions < HX711_SAMPLES_PER_READING) {
+        return false;
+    }
+    
+    conversions = 0;
+    filteredRaw = filtered;
+    return true;
+}
+
+void SampleProcessor::reset() {
+    outliers.reset();
+    filter.reset();
+    conversions = 0;
+}
+
+float SampleProcessor::toWeight(int32_t filteredRaw, int32_t offset, float scale) {
+    // The only floating point step: tared counts to kilograms
+    return (float)(filteredRaw - offset) / scale;
+}
+
+bool SampleProcessor::isValidWeight(float weight) {
+    // Check if reading is within reasonable bounds
+    return (weight >= 0.0 && weight <= 50.0); // Assuming max bin capacity is 50kg
+}
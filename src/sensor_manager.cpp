@@ -1,40 +1,132 @@
 #include "sensor_manager.h"
 
-SensorManager::SensorManager() {
-    // Initialize default scale factors
+SensorManager::SensorManager(LoadCellAdc& adc, Clock& clock, ConfigStore& config)
+    : adc(adc), clock(clock), config(config) {
+    // Channel arrays are allocated by init() once the ADC reports its size
+    channelCount = 0;
+    enabledMask = 0; // Sensors are enabled during detection
+    readings = nullptr;
+    scaleFactors = nullptr;
+    tareOffsets = nullptr;
+    tareLoaded = nullptr;
+    activeMask = 0;
+    activeCount = 0;
+    activeChannels = nullptr;
+    slotOf = nullptr;
+    processors = nullptr;
+    lastCaptureUs = nullptr;
+    nextReadUs = nullptr;
+    conversionCounters = nullptr;
+    pollOnlyMask = 0;
+    fullRateMask = 0;
+    resyncMask = 0;
+    highRate = false;
+    conversionPeriodUs = HX711_CONVERSION_PERIOD_US;
+    interruptMask = 0;
+    readyContexts = nullptr;
+    readyAtUs = nullptr;
+    stability = nullptr;
+    eventDetectors = nullptr;
+    rollups = nullptr;
+    historyResetRequests = 0;
+    
+    samplingTask = nullptr;
+    pendingReady = 0;
+    tareRequests = 0;
+    tareSavePending = 0;
+    scaleUpdates = 0;
+    calibrationBin = -1;
+    captureBin = -1;
+    captureRemaining = 0;
+    captureSum = 0;
+    memset(&jitterStats, 0, sizeof(jitterStats));
+    latencySumUs = 0.0;
+}
+
+bool SensorManager::allocateChannels(int count) {
+    if (channelCount > 0) {
+        return true;
+    }
+    if (count > SENSOR_MAX_CHANNELS) {
+        count = SENSOR_MAX_CHANNELS;
+    }
+    if (count <= 0) {
+        return false;
+    }
+    
+    readings = new SensorReading[count];
+    scaleFactors = new float[count];
+    tareOffsets = new int32_t[count];
+    tareLoaded = new bool[count];
+    activeChannels = new uint8_t[count];
+    slotOf = new int8_t[count];
+    processors = new SampleProcessor[count];
+    lastCaptureUs = new uint32_t[count];
+    nextReadUs = new uint32_t[count];
+    conversionCounters = new ConversionCounters[count];
+    readyContexts = new DataReadyContext[count];
+    readyAtUs = new uint32_t[count];
+    stability = new StabilityTracker[count];
+    eventDetectors = new WeightEventDetector[count];
+    rollups = new RollupTracker[count];
+    
+    // Channels past the configured list start from the generic default
     float defaultFactors[] = HX711_DEFAULT_SCALE_FACTORS;
+    int defaultCount = sizeof(defaultFactors) / sizeof(defaultFactors[0]);
     
-    for (int i = 0; i < MAX_BINS; i++) {
-        sensorEnabled[i] = false; // Disable all sensors by default - will be enabled during detection
-        lastReadings[i] = 0.0;
-        lastReadTime[i] = 0;
+    for (int i = 0; i < count; i++) {
         readings[i].bin_id = i;
         readings[i].weight = 0.0;
         readings[i].timestamp = 0;
         readings[i].valid = false;
-        scaleFactors[i] = defaultFactors[i]; // Set default scale factor
+        scaleFactors[i] = i < defaultCount ? defaultFactors[i] : HX711_DEFAULT_SCALE_FACTOR;
+        tareOffsets[i] = 0;
+        tareLoaded[i] = false;
+        slotOf[i] = -1;
+        lastCaptureUs[i] = 0;
+        nextReadUs[i] = 0;
+        conversionCounters[i].captured = 0;
+        conversionCounters[i].missed = 0;
+        conversionCounters[i].rejected = 0;
+        readyContexts[i].manager = this;
+        readyContexts[i].binId = i;
+        readyAtUs[i] = 0;
     }
+    
+    channelCount = count;
+    return true;
 }
 
 void SensorManager::init() {
     Serial.println("Initializing sensor manager...");
     
-    // Load scale factors from NVS
+    // The registry is sized by the ADC (synthetic bins in testing mode)
+    if (!TESTING_MODE) {
+        adc.begin();
+    }
+    if (!allocateChannels(TESTING_MODE ? MAX_BINS : adc.getChannelCount())) {
+        Serial.println("ERROR: No load cell channels available");
+        return;
+    }
+    Serial.printf("Sensor registry: %d channels\n", channelCount);
+    
+    // Scale factors and tare offsets from the settings loaded at boot
     loadScaleFactors();
+    loadTareOffsets();
     
     if (TESTING_MODE) {
         Serial.println("TESTING MODE: Skipping hardware initialization");
-        Serial.println("Using dummy data for sensor readings");
+        Serial.printf("Using synthetic data for sensor readings (seed %lu)\n", (unsigned long)SYNTHETIC_SEED);
+        
+        syntheticBins.begin(channelCount, SYNTHETIC_SEED, clock.millis());
         
         // In testing mode, enable all sensors for demonstration
-        for (int i = 0; i < MAX_BINS; i++) {
-            sensorEnabled[i] = true;
+        for (int i = 0; i < channelCount; i++) {
+            enabledMask |= 1UL << i;
             readings[i].bin_id = i;
             readings[i].weight = generateDummyWeight(i);
-            readings[i].timestamp = millis();
+            readings[i].timestamp = clock.millis();
             readings[i].valid = true;
-            lastReadings[i] = readings[i].weight;
-            lastReadTime[i] = readings[i].timestamp;
             
             Serial.printf("Sensor %d (DUMMY) initialized - Initial weight: %.2f kg, Scale: %.2f\n", 
                          i, readings[i].weight, scaleFactors[i]);
@@ -49,39 +141,350 @@ void SensorManager::init() {
             return;
         }
         
-        // Initialize detected sensors
-        for (int i = 0; i < MAX_BINS; i++) {
-            if (sensorEnabled[i]) {
-                sensors[i].begin(doutPins[i], clkPins[i]);
-                sensors[i].set_scale(scaleFactors[i]); // Use individual scale factor
-                sensors[i].tare(); // Reset the scale to 0
-                
-                Serial.printf("Sensor %d initialized on pins CLK:%d, DOUT:%d, Scale: %.2f\n", 
-                             i, clkPins[i], doutPins[i], scaleFactors[i]);
+        // Restore the saved zero so waste already in the bin keeps its weight
+        // across restarts; only bins never tared are zeroed now, all at once
+        uint32_t untared = 0;
+        for (int i = 0; i < channelCount; i++) {
+            if (isSensorEnabled(i) && !tareLoaded[i]) {
+                untared |= 1UL << i;
+            }
+        }
+        
+        int32_t zeros[SENSOR_MAX_CHANNELS];
+        if (untared && averageConversions(untared, HX711_TARE_SAMPLES, zeros)) {
+            for (int i = 0; i < channelCount; i++) {
+                if (untared & (1UL << i)) {
+                    tareOffsets[i] = zeros[i];
+                    tareSavePending |= 1UL << i;
+                }
+            }
+        }
+        
+        for (int i = 0; i < channelCount; i++) {
+            if (isSensorEnabled(i)) {
+                Serial.printf("Sensor %d initialized - Scale: %.2f, Offset: %ld\n",
+                             i, scaleFactors[i], (long)tareOffsets[i]);
             }
         }
+        
+        if (tareSavePending) {
+            saveTareOffsets();
+            tareSavePending = 0;
+        }
+        
+        applyActiveChannels();
+        startSamplingTask();
     }
     
     Serial.printf("Sensor manager initialization complete - %d sensors active\n", getConnectedSensorCount());
 }
 
 void SensorManager::update() {
-    unsigned long currentTime = millis();
+    if (TESTING_MODE) {
+        syntheticBins.step(clock.millis());
+        applyHistoryResets();
+        for (int i = 0; i < channelCount; i++) {
+            if (isSensorEnabled(i)) {
+                readings[i] = readSensor(i);
+                if (readings[i].valid) {
+                    recordHistory(readings[i]);
+                }
+            }
+        }
+        closeRollups(clock.millis());
+        return;
+    }
+    
+    // Without the task (it failed to start) acquisition falls back to this loop
+    if (!samplingTask) {
+        pollSensors();
+    }
+    
+    traceRecorder.service();
+    
+    // Persist offsets captured by re-tare requests
+    if (tareSavePending) {
+        portENTER_CRITICAL(&isrMux);
+        uint32_t tared = tareSavePending;
+        tareSavePending = 0;
+        historyResetRequests |= tared;
+        portEXIT_CRITICAL(&isrMux);
+        saveTareOffsets();
+    }
     
-    for (int i = 0; i < MAX_BINS; i++) {
-        if (sensorEnabled[i]) {
-            readings[i] = readSensor(i);
+    // Apply the samples published by the sampling task since the last call
+    applyHistoryResets();
+    SensorReading sample;
+    while (sampleQueue.pop(sample)) {
+        if (sample.valid) {
+            readings[sample.bin_id] = sample;
+            recordHistory(sample);
+        } else {
+            // Keep the last good weight but flag the bin so it is not uploaded
+            readings[sample.bin_id].valid = false;
         }
     }
+    closeRollups(clock.millis());
+}
+
+void SensorManager::applyHistoryResets() {
+    if (!historyResetRequests) {
+        return;
+    }
+    
+    // A re-zeroed or recalibrated bin starts over rather than reporting the
+    // jump as a settled change, collection or deposit
+    portENTER_CRITICAL(&isrMux);
+    uint32_t resets = historyResetRequests;
+    historyResetRequests = 0;
+    portEXIT_CRITICAL(&isrMux);
+    for (uint32_t bits = resets; bits; bits &= bits - 1) {
+        int binId = __builtin_ctz(bits);
+        stability[binId].reset();
+        eventDetectors[binId].reset();
+        rollups[binId].reset();
+    }
+}
+
+void SensorManager::recordHistory(const SensorReading& reading) {
+    stability[reading.bin_id].addReading(reading.weight, reading.timestamp);
+    
+    if (ROLLUP_ENABLED) {
+        Rollup closed[ROLLUP_WINDOW_COUNT];
+        int count = rollups[reading.bin_id].addReading(reading.weight, reading.timestamp, closed);
+        queueRollups(reading.bin_id, closed, count);
+    }
+    
+    if (!EVENT_DETECTION_ENABLED) {
+        return;
+    }
+    
+    WeightEvent event;
+    if (!eventDetectors[reading.bin_id].addReading(reading.weight, reading.timestamp, event)) {
+        return;
+    }
+    
+    event.binId = reading.bin_id;
+    Serial.printf("Bin %d %s: %.2f -> %.2f kg\n", event.binId, WeightEventDetector::typeName(event.type),
+                  event.beforeKg, event.afterKg);
+    eventQueue.push(event);
+}
+
+void SensorManager::closeRollups(uint32_t nowMs) {
+    if (!ROLLUP_ENABLED) {
+        return;
+    }
+    
+    // Windows of bins that stopped reporting (disabled, invalid) still close on time
+    Rollup closed[ROLLUP_WINDOW_COUNT];
+    for (int i = 0; i < channelCount; i++) {
+        queueRollups(i, closed, rollups[i].closeExpired(nowMs, closed));
+    }
+}
+
+void SensorManager::queueRollups(int binId, Rollup* closed, int count) {
+    for (int i = 0; i < count; i++) {
+        closed[i].binId = binId;
+        rollupQueue.push(closed[i]);
+    }
+}
+
+void SensorManager::requestHistoryReset(int binId) {
+    portENTER_CRITICAL(&isrMux);
+    historyResetRequests |= 1UL << binId;
+    portEXIT_CRITICAL(&isrMux);
+}
+
+void SensorManager::requestScaleUpdate(int binId) {
+    portENTER_CRITICAL(&isrMux);
+    scaleUpdates |= 1UL << binId;
+    portEXIT_CRITICAL(&isrMux);
+}
+
+bool SensorManager::getLastSettledWeight(int binId, float& weightKg, unsigned long* settledAt) {
+    if (binId < 0 || binId >= channelCount) {
+        return false;
+    }
+    
+    uint32_t timestampMs;
+    if (!stability[binId].getLastSettled(weightKg, &timestampMs)) {
+        return false;
+    }
+    if (settledAt) {
+        *settledAt = timestampMs;
+    }
+    return true;
+}
+
+bool SensorManager::isSettled(int binId) {
+    return binId >= 0 && binId < channelCount && stability[binId].isSettled();
+}
+
+bool SensorManager::popEvent(WeightEvent& event) {
+    return eventQueue.pop(event);
+}
+
+uint32_t SensorManager::getDroppedEventCount() {
+    return eventQueue.droppedCount();
+}
+
+bool SensorManager::popRollup(Rollup& rollup) {
+    return rollupQueue.pop(rollup);
+}
+
+uint32_t SensorManager::getDroppedRollupCount() {
+    return rollupQueue.droppedCount();
+}
+
+bool SensorManager::startSamplingTask() {
+    if (samplingTask) {
+        return true;
+    }
+    
+#ifdef ARDUINO
+    BaseType_t result = xTaskCreatePinnedToCore(samplingTaskEntry, "sampling", SAMPLING_TASK_STACK_SIZE,
+                                                this, SAMPLING_TASK_PRIORITY, &samplingTask, SAMPLING_TASK_CORE);
+    if (result != pdPASS) {
+        samplingTask = nullptr;
+        Serial.println("ERROR: Failed to start sampling task, sampling from main loop");
+        return false;
+    }
+    
+    Serial.printf("Sampling task started on core %d\n", SAMPLING_TASK_CORE);
+    return true;
+#else
+    Serial.println("Sampling from main loop (no task on this platform)");
+    return false;
+#endif
+}
+
+#ifdef ARDUINO
+void SensorManager::samplingTaskEntry(void* param) {
+    static_cast<SensorManager*>(param)->samplingLoop();
+}
+
+void SensorManager::samplingLoop() {
+    // Attach from this task so the GPIO ISR runs on the sampling core and is
+    // held off while a lockstep read has interrupts disabled
+    attachDataReadyInterrupts();
+    
+    for (;;) {
+        // Sleep until a DOUT falling edge; the timeout is only a safety net,
+        // unless some channel (e.g. behind a shift register) has to be polled
+        uint32_t timeoutMs = pollOnlyMask ? SAMPLING_TASK_POLL_INTERVAL_MS : SAMPLING_TASK_IDLE_TIMEOUT_MS;
+        
+        // An idle bin's HX711 raises no new edge until it is read, so wake
+        // for the earliest idle read that is due
+        uint32_t now = clock.micros();
+        for (uint32_t bits = activeMask & ~fullRateMask; bits; bits &= bits - 1) {
+            int32_t waitUs = (int32_t)(nextReadUs[slotOf[__builtin_ctz(bits)]] - now);
+            uint32_t waitMs = waitUs > 0 ? (uint32_t)(waitUs + 999) / 1000 : 1;
+            if (waitMs < timeoutMs) timeoutMs = waitMs;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+        pollSensors();
+    }
+}
+
+void SensorManager::attachDataReadyInterrupts() {
+    uint32_t unattached = activeMask & ~interruptMask;
+    for (int i = 0; i < channelCount; i++) {
+        if ((unattached & (1UL << i)) && adc.attachDataReady(i, dataReadyIsr, &readyContexts[i])) {
+            interruptMask |= 1UL << i;
+        }
+    }
+    pollOnlyMask = activeMask & ~interruptMask;
+}
+
+void IRAM_ATTR SensorManager::dataReadyIsr(void* arg) {
+    DataReadyContext* context = static_cast<DataReadyContext*>(arg);
+    SensorManager* manager = context->manager;
+    uint32_t bit = 1UL << context->binId;
+    
+    portENTER_CRITICAL_ISR(&manager->isrMux);
+    if (!(manager->pendingReady & bit)) {
+        manager->pendingReady |= bit;
+        manager->readyAtUs[context->binId] = micros();
+    }
+    portEXIT_CRITICAL_ISR(&manager->isrMux);
+    
+    BaseType_t higherPriorityWoken = pdFALSE;
+    if (manager->samplingTask) {
+        vTaskNotifyGiveFromISR(manager->samplingTask, &higherPriorityWoken);
+    }
+    if (higherPriorityWoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+#endif
+
+void SensorManager::recordCapture(int slot, uint32_t nowUs, bool fromInterrupt, uint32_t readyAt, bool rejected) {
+    portENTER_CRITICAL(&statsMux);
+    
+    // Any whole conversion periods between captures were overwritten
+    // unread. Idle bins skip conversions on purpose, and the first capture
+    // after a rate or mode change has no comparable predecessor
+    ConversionCounters& counters = conversionCounters[slot];
+    uint32_t bit = 1UL << activeChannels[slot];
+    if (counters.captured > 0 && (fullRateMask & ~resyncMask & bit)) {
+        uint32_t periods = (nowUs - lastCaptureUs[slot] + conversionPeriodUs / 2) / conversionPeriodUs;
+        if (periods > 1) {
+            counters.missed += periods - 1;
+        }
+    }
+    resyncMask &= ~bit;
+    counters.captured++;
+    if (rejected) {
+        counters.rejected++;
+    }
+    lastCaptureUs[slot] = nowUs;
+    
+    if (fromInterrupt) {
+        uint32_t latency = nowUs - readyAt;
+        if (jitterStats.captures == 0 || latency < jitterStats.minLatencyUs) {
+            jitterStats.minLatencyUs = latency;
+        }
+        if (latency > jitterStats.maxLatencyUs) {
+            jitterStats.maxLatencyUs = latency;
+        }
+        latencySumUs += latency;
+        jitterStats.captures++;
+    }
+    
+    portEXIT_CRITICAL(&statsMux);
+}
+
+SamplingJitterStats SensorManager::getJitterStats() {
+    portENTER_CRITICAL(&statsMux);
+    SamplingJitterStats stats = jitterStats;
+    stats.meanLatencyUs = stats.captures > 0 ? (float)(latencySumUs / stats.captures) : 0.0f;
+    portEXIT_CRITICAL(&statsMux);
+    
+    stats.droppedSamples = sampleQueue.droppedCount();
+    return stats;
+}
+
+ConversionCounters SensorManager::getConversionCounters(int binId) {
+    ConversionCounters counters = {0, 0, 0};
+    if (binId < 0 || binId >= channelCount) return counters;
+    
+    // Counters live in the bin's active slot; an inactive bin reports zero
+    portENTER_CRITICAL(&statsMux);
+    int slot = slotOf[binId];
+    if (slot >= 0) {
+        counters = conversionCounters[slot];
+    }
+    portEXIT_CRITICAL(&statsMux);
+    return counters;
 }
 
 SensorReading SensorManager::readSensor(int binId) {
     SensorReading reading;
     reading.bin_id = binId;
-    reading.timestamp = millis();
+    reading.timestamp = clock.millis();
     reading.valid = false;
     
-    if (binId < 0 || binId >= MAX_BINS || !sensorEnabled[binId]) {
+    if (!isSensorEnabled(binId)) {
         reading.weight = 0.0;
         return reading;
     }
@@ -89,163 +492,513 @@ SensorReading SensorManager::readSensor(int binId) {
     if (TESTING_MODE) {
         // Generate dummy data for testing
         reading.weight = generateDummyWeight(binId);
-        reading.valid = isValidReading(reading.weight);
-    } else {
-        // Read from actual HX711 sensors
-        if (sensors[binId].is_ready()) {
-            float rawWeight = sensors[binId].get_units(6); // Average of 6 readings
-            reading.weight = smoothReading(binId, rawWeight);
-            reading.valid = isValidReading(reading.weight);
+        reading.valid = SampleProcessor::isValidWeight(reading.weight);
+        
+        if (reading.valid) {
+            readings[binId] = reading;
+        }
+        return reading;
+    }
+    
+    // Hardware readings are produced by pollSensors(); never block here
+    return readings[binId];
+}
+
+void SensorManager::pollSensors() {
+    // Pick up bins enabled or disabled since the last cycle
+    if (activeMask != enabledMask) {
+        applyActiveChannels();
+#ifdef ARDUINO
+        if (samplingTask) {
+            attachDataReadyInterrupts();
+        }
+#endif
+    }
+    
+    // Idle bins let their HX711 keep converting and are read only once
+    // their interval has passed
+    uint32_t dueMask = dueChannels(clock.micros());
+    
+    // Every due HX711 with a conversion waiting is clocked out in one
+    // lockstep frame, so all ready bins cost the same as a single bin and
+    // their samples are time aligned. The DOUT level is authoritative; the
+    // interrupt flags only wake the task and timestamp the edge
+    uint32_t readyMask = adc.readyMask() & dueMask;
+    if (readyMask == 0) {
+        updateSchedule(clock.millis());
+        return;
+    }
+    
+    int32_t values[SENSOR_MAX_CHANNELS];
+    readyMask = adc.read(readyMask, values) & activeMask;
+    uint32_t now = clock.micros();
+    uint32_t nowMs = clock.millis();
+    
+    // Consume the interrupt flags of the bins just read. An idle bin's flag
+    // is stale by the time it is read, so it does not count towards latency
+    uint32_t readyAt[SENSOR_MAX_CHANNELS];
+    portENTER_CRITICAL(&isrMux);
+    uint32_t signalled = pendingReady & readyMask & fullRateMask;
+    pendingReady &= ~readyMask;
+    for (uint32_t bits = signalled; bits; bits &= bits - 1) {
+        int i = __builtin_ctz(bits);
+        readyAt[i] = readyAtUs[i];
+    }
+    uint32_t rescaled = scaleUpdates & activeMask;
+    scaleUpdates &= ~rescaled;
+    portEXIT_CRITICAL(&isrMux);
+    
+    // The only float math of the activity check, once per scale change
+    for (uint32_t bits = rescaled; bits; bits &= bits - 1) {
+        int i = __builtin_ctz(bits);
+        activity.setScale(slotOf[i], scaleFactors[i]);
+    }
+    
+    // Only the bins just read are visited
+    for (uint32_t bits = readyMask; bits; bits &= bits - 1) {
+        int i = __builtin_ctz(bits);
+        int slot = slotOf[i];
+        bool fromInterrupt = (signalled & (1UL << i)) != 0;
+        
+        // Calibration averages the unfiltered conversions
+        if (i == captureBin) {
+            portENTER_CRITICAL(&isrMux);
+            if (i == captureBin && captureRemaining > 0) {
+                captureSum += values[i];
+                captureRemaining--;
+            }
+            portEXIT_CRITICAL(&isrMux);
+        }
+        
+        traceRecorder.record(nowMs, i, values[i]);
+        
+        int32_t filtered;
+        if (processors[slot].addConversion(values[i], filtered)) {
+            publishReading(i, filtered);
+        }
+        
+        if (ADAPTIVE_SAMPLING_ENABLED) {
+            // The raw conversion: past the Hampel stage an idle bin's step
+            // is rejected until the window has filled with the new level
+            activity.observe(slot, values[i], nowMs);
+        }
+        nextReadUs[slot] = now + activity.getIntervalUs(slot);
+        
+        recordCapture(slot, now, fromInterrupt, fromInterrupt ? readyAt[i] : 0, processors[slot].lastRejected());
+    }
+    
+    updateSchedule(nowMs);
+}
+
+uint32_t SensorManager::dueChannels(uint32_t nowUs) {
+    // A calibration capture or a pending re-tare takes every conversion of
+    // its bin, however idle the bin is
+    portENTER_CRITICAL(&isrMux);
+    uint32_t claimed = tareRequests;
+    if (captureBin >= 0) {
+        claimed |= 1UL << captureBin;
+    }
+    portEXIT_CRITICAL(&isrMux);
+    
+    uint32_t due = fullRateMask | (claimed & activeMask);
+    for (uint32_t bits = activeMask & ~due; bits; bits &= bits - 1) {
+        int i = __builtin_ctz(bits);
+        if ((int32_t)(nowUs - nextReadUs[slotOf[i]]) >= 0) {
+            due |= 1UL << i;
+        }
+    }
+    return due;
+}
+
+void SensorManager::updateSchedule(uint32_t nowMs) {
+    if (!ADAPTIVE_SAMPLING_ENABLED) {
+        return;
+    }
+    
+    activity.expire(nowMs);
+    uint32_t mask = 0;
+    for (uint32_t bits = activity.getActiveSlots(); bits; bits &= bits - 1) {
+        mask |= 1UL << activeChannels[__builtin_ctz(bits)];
+    }
+    if (mask == fullRateMask) {
+        return;
+    }
+    
+    // A bin that speeds up is read at once and starts a new miss baseline
+    uint32_t now = clock.micros();
+    uint32_t promoted = mask & ~fullRateMask;
+    for (uint32_t bits = promoted; bits; bits &= bits - 1) {
+        nextReadUs[slotOf[__builtin_ctz(bits)]] = now;
+    }
+    resyncMask |= promoted;
+    fullRateMask = mask;
+    
+    // 80 SPS while any bin is moving, 10 SPS once all are idle
+    bool high = activity.wantsHighRate();
+    if (high != highRate && adc.setHighRate(high)) {
+        highRate = high;
+        conversionPeriodUs = high ? HX711_FAST_CONVERSION_PERIOD_US : HX711_CONVERSION_PERIOD_US;
+        resyncMask = activeMask;
+        Serial.printf("HX711 rate: %d SPS\n", high ? 80 : 10);
+    }
+}
+
+void SensorManager::applyActiveChannels() {
+    // Runs in the sampling context (or before the task starts). Counters
+    // follow their bin to its new slot; filters restart from empty
+    uint32_t mask = enabledMask;
+    uint32_t previous = activeMask;
+    
+    ConversionCounters counters[SENSOR_MAX_CHANNELS];
+    uint32_t captureUs[SENSOR_MAX_CHANNELS];
+    for (int slot = 0; slot < activeCount; slot++) {
+        int i = activeChannels[slot];
+        counters[i] = conversionCounters[slot];
+        captureUs[i] = lastCaptureUs[slot];
+    }
+    
+    portENTER_CRITICAL(&statsMux);
+    activeCount = 0;
+    for (int i = 0; i < channelCount; i++) {
+        uint32_t bit = 1UL << i;
+        slotOf[i] = -1;
+        if (!(mask & bit)) continue;
+        
+        int slot = activeCount++;
+        activeChannels[slot] = (uint8_t)i;
+        slotOf[i] = (int8_t)slot;
+        if (previous & bit) {
+            conversionCounters[slot] = counters[i];
+            lastCaptureUs[slot] = captureUs[i];
         } else {
-            reading.weight = lastReadings[binId]; // Use last known good reading
-            reading.valid = false; // Mark as invalid since sensor not ready
+            conversionCounters[slot].captured = 0;
+            conversionCounters[slot].missed = 0;
+            conversionCounters[slot].rejected = 0;
+            lastCaptureUs[slot] = 0;
         }
     }
+    portEXIT_CRITICAL(&statsMux);
+    
+    for (int slot = 0; slot < activeCount; slot++) {
+        processors[slot].reset();
+        nextReadUs[slot] = 0;
+    }
+    
+    activeMask = mask;
+    pollOnlyMask = activeMask & ~interruptMask;
+    adc.setActiveChannels(activeMask);
+    
+    // Every bin starts at full rate; the scheduler slows the quiet ones
+    activity.reset(activeCount, clock.millis());
+    for (int slot = 0; slot < activeCount; slot++) {
+        activity.setScale(slot, scaleFactors[activeChannels[slot]]);
+    }
+    if (ADAPTIVE_SAMPLING_ENABLED) {
+        fullRateMask = 0;
+        updateSchedule(clock.millis());
+    } else {
+        fullRateMask = activeMask;
+        resyncMask |= activeMask & ~previous;
+    }
+}
+
+void SensorManager::publishReading(int binId, int32_t filteredRaw) {
+    SensorReading reading;
+    reading.bin_id = binId;
+    reading.timestamp = clock.millis();
     
-    if (reading.valid) {
-        lastReadings[binId] = reading.weight;
-        lastReadTime[binId] = reading.timestamp;
-        readings[binId] = reading;
+    // A pending re-tare takes this reading as the new zero
+    uint32_t bit = 1UL << binId;
+    if (tareRequests & bit) {
+        portENTER_CRITICAL(&isrMux);
+        tareOffsets[binId] = filteredRaw;
+        tareRequests &= ~bit;
+        tareSavePending |= bit;
+        portEXIT_CRITICAL(&isrMux);
     }
     
-    return reading;
+    reading.weight = SampleProcessor::toWeight(filteredRaw, tareOffsets[binId], scaleFactors[binId]);
+    reading.valid = SampleProcessor::isValidWeight(reading.weight);
+    
+    sampleQueue.push(reading);
 }
 
 SensorReading* SensorManager::getAllReadings() {
     return readings;
 }
 
+int SensorManager::getChannelCount() {
+    return channelCount;
+}
+
 bool SensorManager::isSensorEnabled(int binId) {
-    if (binId < 0 || binId >= MAX_BINS) return false;
-    return sensorEnabled[binId];
+    if (binId < 0 || binId >= channelCount) return false;
+    return (enabledMask & (1UL << binId)) != 0;
 }
 
 void SensorManager::enableSensor(int binId, bool enabled) {
-    if (binId >= 0 && binId < MAX_BINS) {
-        sensorEnabled[binId] = enabled;
+    if (binId >= 0 && binId < channelCount) {
+        // Takes effect on the sampling context's next cycle
+        portENTER_CRITICAL(&isrMux);
+        if (enabled) {
+            enabledMask |= 1UL << binId;
+        } else {
+            enabledMask &= ~(1UL << binId);
+        }
+        portEXIT_CRITICAL(&isrMux);
         Serial.printf("Sensor %d %s\n", binId, enabled ? "enabled" : "disabled");
     }
 }
 
-void SensorManager::calibrateSensor(int binId, float knownWeight) {
-    if (binId < 0 || binId >= MAX_BINS || !sensorEnabled[binId]) {
-        return;
+bool SensorManager::calibrateSensor(int binId, float knownWeight) {
+    if (!isSensorEnabled(binId) || knownWeight <= 0) {
+        return false;
     }
     
     Serial.printf("Calibrating sensor %d with known weight: %.2f kg\n", binId, knownWeight);
     
-    // Uncomment for actual HX711 calibration:
-    // if (sensors[binId].is_ready()) {
-    //     long reading = sensors[binId].get_value(10); // Average of 10 readings
-    //     float scale = reading / knownWeight;
-    //     sensors[binId].set_scale(scale);
-    //     Serial.printf("Sensor %d calibrated with scale factor: %.2f\n", binId, scale);
-    // }
-
+    // Single point against the current tare offset; use a calibration
+    // session for a least-squares fit over several weights
+    int32_t average;
+    if (!captureRawAverage(binId, CALIBRATION_SAMPLES_PER_POINT, average)) {
+        Serial.printf("Sensor %d calibration failed: no readings\n", binId);
+        return false;
+    }
+    
+    int32_t delta = average - tareOffsets[binId];
+    if (delta > -CALIBRATION_MIN_COUNTS && delta < CALIBRATION_MIN_COUNTS) {
+        Serial.printf("Sensor %d calibration failed: no change from tare\n", binId);
+        return false;
+    }
+    
+    float previous = scaleFactors[binId];
+    setScaleFactor(binId, (float)delta / knownWeight);
+    if (!saveCalibration(binId)) {
+        setScaleFactor(binId, previous);
+        config.setScaleFactor(binId, previous);
+        return false;
+    }
+    
     Serial.printf("Sensor %d calibration complete\n", binId);
+    return true;
+}
+
+bool SensorManager::beginCalibration(int binId) {
+    if (TESTING_MODE || !isSensorEnabled(binId)) {
+        return false;
+    }
+    
+    calibrationFit.reset();
+    calibrationBin = binId;
+    Serial.printf("Calibration session started for sensor %d\n", binId);
+    return true;
+}
+
+bool SensorManager::addCalibrationPoint(float knownWeight, int32_t* rawAverage) {
+    if (calibrationBin < 0 || knownWeight < 0) {
+        return false;
+    }
+    
+    int32_t average;
+    if (!captureRawAverage(calibrationBin, CALIBRATION_SAMPLES_PER_POINT, average)) {
+        Serial.printf("Calibration point %.3f kg failed: no readings\n", knownWeight);
+        return false;
+    }
+    
+    calibrationFit.add(knownWeight, average);
+    if (rawAverage) {
+        *rawAverage = average;
+    }
+    
+    Serial.printf("Calibration point %d: %.3f kg -> %ld counts\n",
+                 calibrationFit.count(), knownWeight, (long)average);
+    return true;
+}
+
+bool SensorManager::finishCalibration(CalibrationResult& result) {
+    if (calibrationBin < 0 || !calibrationFit.isSolvable() || calibrationFit.gain() == 0.0) {
+        return false;
+    }
+    
+    int binId = calibrationBin;
+    double gain = calibrationFit.gain();
+    
+    result.binId = binId;
+    result.points = calibrationFit.count();
+    result.scaleFactor = (float)gain;
+    result.offset = (int32_t)lround(calibrationFit.offset());
+    result.residualKg = (float)(calibrationFit.residualRms() / fabs(gain));
+    result.rSquared = (float)calibrationFit.rSquared();
+    
+    portENTER_CRITICAL(&isrMux);
+    tareOffsets[binId] = result.offset;
+    scaleFactors[binId] = result.scaleFactor;
+    scaleUpdates |= 1UL << binId;
+    portEXIT_CRITICAL(&isrMux);
+    
+    saveCalibration(binId);
+    calibrationBin = -1;
+    
+    Serial.printf("Sensor %d calibrated from %d points: scale %.2f, offset %ld, residual %.4f kg, R2 %.6f\n",
+                 binId, result.points, result.scaleFactor, (long)result.offset, result.residualKg, result.rSquared);
+    return true;
+}
+
+void SensorManager::cancelCalibration() {
+    calibrationBin = -1;
+    calibrationFit.reset();
+}
+
+int SensorManager::getCalibrationBin() {
+    return calibrationBin;
+}
+
+bool SensorManager::captureRawAverage(int binId, int samples, int32_t& average) {
+    if (TESTING_MODE || samples <= 0) {
+        return false;
+    }
+    
+    // Arm the capture; the sampling task adds each raw conversion of the bin
+    portENTER_CRITICAL(&isrMux);
+    captureSum = 0;
+    captureRemaining = samples;
+    captureBin = binId;
+    portEXIT_CRITICAL(&isrMux);
+    
+    unsigned long startTime = clock.millis();
+    bool complete = false;
+    int64_t sum = 0;
+    
+    while (clock.millis() - startTime < CALIBRATION_CAPTURE_TIMEOUT) {
+        // Without the task the conversions have to be collected here
+        if (!samplingTask) {
+            pollSensors();
+        }
+        
+        portENTER_CRITICAL(&isrMux);
+        complete = (captureRemaining == 0);
+        sum = captureSum;
+        portEXIT_CRITICAL(&isrMux);
+        
+        if (complete) break;
+        clock.delay(20);
+    }
+    
+    portENTER_CRITICAL(&isrMux);
+    captureBin = -1;
+    captureRemaining = 0;
+    portEXIT_CRITICAL(&isrMux);
+    
+    if (!complete) {
+        return false;
+    }
+    
+    average = (int32_t)(sum / samples);
+    return true;
+}
+
+bool SensorManager::averageConversions(uint32_t mask, int samples, int32_t* averages) {
+    // Direct reads for use before the sampling task owns the ADC
+    int64_t sums[SENSOR_MAX_CHANNELS] = {0};
+    int counts[SENSOR_MAX_CHANNELS] = {0};
+    uint32_t remaining = mask;
+    unsigned long startTime = clock.millis();
+    
+    while (remaining && clock.millis() - startTime < CALIBRATION_CAPTURE_TIMEOUT) {
+        uint32_t ready = adc.readyMask() & remaining;
+        if (ready == 0) {
+            clock.delay(5);
+            continue;
+        }
+        
+        int32_t values[SENSOR_MAX_CHANNELS];
+        ready = adc.read(ready, values) & remaining;
+        for (int i = 0; i < channelCount; i++) {
+            if (ready & (1UL << i)) {
+                sums[i] += values[i];
+                if (++counts[i] >= samples) {
+                    remaining &= ~(1UL << i);
+                }
+            }
+        }
+    }
+    
+    if (remaining) {
+        return false;
+    }
+    
+    for (int i = 0; i < channelCount; i++) {
+        if (mask & (1UL << i)) {
+            averages[i] = (int32_t)(sums[i] / counts[i]);
+        }
+    }
+    return true;
+}
+
+bool SensorManager::saveCalibration(int binId) {
+    // Scale and offset go out in a single commit
+    config.setScaleFactor(binId, scaleFactors[binId]);
+    config.setTareOffset(binId, tareOffsets[binId]);
+    
+    if (!config.commit()) {
+        Serial.printf("ERROR: Failed to save calibration for sensor %d\n", binId);
+        return false;
+    }
+    
+    tareLoaded[binId] = true;
+    requestHistoryReset(binId);
+    Serial.printf("Calibration for sensor %d saved to NVS\n", binId);
+    return true;
 }
 
 float SensorManager::generateDummyWeight(int binId) {
-    // Generate realistic dummy weight data for testing
-    // Simulate bins with different fill levels that change over time
-    
-    unsigned long currentTime = millis();
-    float baseWeight = 0.0;
-    
-    switch (binId) {
-        case 0: // Bin 0: Slowly filling up
-            baseWeight = 5.0 + (currentTime / 60000.0) * 0.1; // Increases by 0.1kg per minute
-            break;
-        case 1: // Bin 1: Medium fill level with small variations
-            baseWeight = 15.0 + sin(currentTime / 30000.0) * 2.0; // Oscillates around 15kg
-            break;
-        case 2: // Bin 2: Nearly full
-            baseWeight = 28.0 + sin(currentTime / 45000.0) * 1.0; // Oscillates around 28kg
-            break;
-        case 3: // Bin 3: Empty with occasional small additions
-            baseWeight = 0.5 + (sin(currentTime / 120000.0) > 0.8 ? 2.0 : 0.0);
-            break;
-        case 4: // Bin 4: Gradually emptying
-            baseWeight = fmax(0.0, 20.0 - (currentTime / 90000.0) * 0.05); // Decreases slowly
-            break;
-        case 5: // Bin 5: Random variations
-            baseWeight = 10.0 + sin(currentTime / 20000.0) * 5.0 + cos(currentTime / 35000.0) * 3.0;
-            break;
-        default:
-            baseWeight = 5.0;
-    }
-    
-    // Add small random noise to make it more realistic
-    float noise = (random(-100, 100) / 1000.0); // ±0.1kg noise
-    baseWeight += noise;
-    
-    // Ensure weight is not negative
-    return fmax(0.0, baseWeight);
-}
-
-float SensorManager::smoothReading(int binId, float newReading) {
-    // Simple moving average for smoothing
-    float smoothedReading = (lastReadings[binId] * (WEIGHT_SMOOTHING_SAMPLES - 1) + newReading) / WEIGHT_SMOOTHING_SAMPLES;
-    return smoothedReading;
-}
-
-bool SensorManager::isValidReading(float reading) {
-    // Check if reading is within reasonable bounds
-    return (reading >= 0.0 && reading <= 50.0); // Assuming max bin capacity is 50kg
+    // Each bin follows a seeded fill/empty/deposit profile; the same seed
+    // gives the same data on every run
+    return syntheticBins.weight(binId);
 }
 
 void SensorManager::setScaleFactor(int binId, float scaleFactor) {
-    if (binId >= 0 && binId < MAX_BINS) {
+    if (binId >= 0 && binId < channelCount) {
         scaleFactors[binId] = scaleFactor;
-        
-        // Update the actual sensor if not in testing mode
-        if (!TESTING_MODE && sensorEnabled[binId]) {
-            sensors[binId].set_scale(scaleFactor);
-        }
+        requestScaleUpdate(binId);
+        requestHistoryReset(binId);
         
         Serial.printf("Scale factor for sensor %d set to: %.2f\n", binId, scaleFactor);
     }
 }
 
 float SensorManager::getScaleFactor(int binId) {
-    if (binId >= 0 && binId < MAX_BINS) {
+    if (binId >= 0 && binId < channelCount) {
         return scaleFactors[binId];
     }
     return HX711_DEFAULT_SCALE_FACTOR;
 }
 
 void SensorManager::saveScaleFactors() {
-    preferences.begin(NVS_NAMESPACE, false);
-    
-    for (int i = 0; i < MAX_BINS; i++) {
-        String key = String(NVS_SCALE_FACTOR_PREFIX) + String(i);
-        preferences.putFloat(key.c_str(), scaleFactors[i]);
+    for (int i = 0; i < channelCount; i++) {
+        config.setScaleFactor(i, scaleFactors[i]);
     }
     
-    preferences.end();
-    Serial.println("Scale factors saved to NVS");
+    if (config.commit()) {
+        Serial.println("Scale factors saved to NVS");
+    } else {
+        Serial.println("ERROR: Failed to save scale factors");
+    }
 }
 
 void SensorManager::loadScaleFactors() {
-    preferences.begin(NVS_NAMESPACE, true);
-    
-    float defaultFactors[] = HX711_DEFAULT_SCALE_FACTORS;
     bool anyLoaded = false;
     
-    for (int i = 0; i < MAX_BINS; i++) {
-        String key = String(NVS_SCALE_FACTOR_PREFIX) + String(i);
-        float savedFactor = preferences.getFloat(key.c_str(), -1.0);
-        
-        if (savedFactor > 0) {
+    for (int i = 0; i < channelCount; i++) {
+        // Otherwise keep the default set when the channel was allocated
+        float savedFactor;
+        if (config.getScaleFactor(i, savedFactor) && savedFactor > 0) {
             scaleFactors[i] = savedFactor;
+            requestScaleUpdate(i);
             anyLoaded = true;
-        } else {
-            scaleFactors[i] = defaultFactors[i];
         }
     }
     
-    preferences.end();
-    
     if (anyLoaded) {
         Serial.println("Scale factors loaded from NVS");
     } else {
@@ -253,65 +1006,174 @@ void SensorManager::loadScaleFactors() {
     }
     
     // Print all scale factors
-    for (int i = 0; i < MAX_BINS; i++) {
+    for (int i = 0; i < channelCount; i++) {
         Serial.printf("Sensor %d scale factor: %.2f\n", i, scaleFactors[i]);
     }
 }
 
-int SensorManager::getConnectedSensorCount() {
-    int count = 0;
-    for (int i = 0; i < MAX_BINS; i++) {
-        if (sensorEnabled[i]) {
-            count++;
+bool SensorManager::requestTare(int binId) {
+    if (TESTING_MODE || !isSensorEnabled(binId)) {
+        return false;
+    }
+    
+    portENTER_CRITICAL(&isrMux);
+    tareRequests |= 1UL << binId;
+    portEXIT_CRITICAL(&isrMux);
+    
+    Serial.printf("Tare requested for sensor %d\n", binId);
+    return true;
+}
+
+bool SensorManager::startTrace() {
+    if (TESTING_MODE) {
+        return false;
+    }
+    
+    // The header carries the current calibration so a replay converts
+    // counts to kg exactly as the device did
+    SampleTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    header.version = SAMPLE_TRACE_VERSION;
+    header.binCount = channelCount < SAMPLE_TRACE_MAX_BINS ? channelCount : SAMPLE_TRACE_MAX_BINS;
+    header.startMillis = clock.millis();
+    for (int i = 0; i < header.binCount; i++) {
+        header.offsets[i] = tareOffsets[i];
+        header.scales[i] = scaleFactors[i];
+    }
+    
+    return traceRecorder.start(header);
+}
+
+void SensorManager::stopTrace() {
+    traceRecorder.stop();
+}
+
+TraceRecorder& SensorManager::getTraceRecorder() {
+    return traceRecorder;
+}
+
+void SensorManager::saveTareOffsets() {
+    int32_t offsets[SENSOR_MAX_CHANNELS];
+    portENTER_CRITICAL(&isrMux);
+    memcpy(offsets, tareOffsets, channelCount * sizeof(int32_t));
+    portEXIT_CRITICAL(&isrMux);
+    
+    for (int i = 0; i < channelCount; i++) {
+        if (isSensorEnabled(i)) {
+            config.setTareOffset(i, offsets[i]);
+            tareLoaded[i] = true;
         }
     }
-    return count;
+    
+    if (config.commit()) {
+        Serial.println("Tare offsets saved to NVS");
+    } else {
+        Serial.println("ERROR: Failed to save tare offsets");
+    }
+}
+
+void SensorManager::loadTareOffsets() {
+    for (int i = 0; i < channelCount; i++) {
+        tareOffsets[i] = 0;
+        tareLoaded[i] = config.getTareOffset(i, tareOffsets[i]);
+    }
+}
+
+bool SensorManager::isBinActive(int binId) {
+    if (binId < 0 || binId >= channelCount) return false;
+    return (fullRateMask & (1UL << binId)) != 0;
+}
+
+bool SensorManager::isHighRate() {
+    return highRate;
+}
+
+int SensorManager::getConnectedSensorCount() {
+    return __builtin_popcount(enabledMask);
 }
 
 bool SensorManager::detectConnectedSensors() {
     Serial.println("Detecting connected HX711 sensors...");
     
-    int detectedCount = 0;
+    // Bins found on the previous boot are verified with the full timeout;
+    // the others are only rescanned briefly once a cached set exists
+    uint32_t knownMask;
+    bool haveCache = config.getSensorMask(knownMask);
     
-    for (int i = 0; i < MAX_BINS; i++) {
-        Serial.printf("Testing sensor %d on pins CLK:%d, DOUT:%d... ", i, clkPins[i], doutPins[i]);
-        
-        // Initialize the sensor temporarily for testing
-        HX711 testSensor;
-        testSensor.begin(doutPins[i], clkPins[i]);
+    if (haveCache) {
+        Serial.printf("Cached sensor set: 0x%02X\n", knownMask);
+    }
+    
+    // Probe every channel at once against a shared start time
+    unsigned long timeouts[SENSOR_MAX_CHANNELS];
+    for (int i = 0; i < channelCount; i++) {
+        bool known = (knownMask & (1UL << i)) != 0;
+        timeouts[i] = (!haveCache || known) ? SENSOR_DETECTION_TIMEOUT : SENSOR_RESCAN_TIMEOUT;
+    }
+    
+    // Wait a bit for sensors to stabilize
+    clock.delay(100);
+    
+    unsigned long startTime = clock.millis();
+    uint32_t pendingMask = channelCount >= 32 ? 0xFFFFFFFFUL : (1UL << channelCount) - 1;
+    uint32_t detectedMask = 0;
+    uint32_t probedMask = 0;
+    
+    while (pendingMask) {
+        unsigned long elapsed = clock.millis() - startTime;
         
-        // Wait a bit for sensor to stabilize
-        delay(100);
+        // Channels that timed out stop holding back a shared CLK line
+        if ((pendingMask | detectedMask) != probedMask) {
+            probedMask = pendingMask | detectedMask;
+            adc.setActiveChannels(probedMask);
+        }
         
-        // Test if sensor is responding
-        unsigned long startTime = millis();
-        bool sensorResponding = false;
+        // Read every channel with a conversion waiting in one pass
+        int32_t values[SENSOR_MAX_CHANNELS];
+        uint32_t readMask = adc.read(adc.readyMask() & pendingMask, values);
         
-        while (millis() - startTime < SENSOR_DETECTION_TIMEOUT) {
-            if (testSensor.is_ready()) {
-                // Try to get a reading to confirm sensor is working
-                long rawReading = testSensor.get_value(1);
-                
-                // Check if we get a reasonable response (not stuck at 0 or max value)
-                if (rawReading != 0 && rawReading != 0x7FFFFF && rawReading != 0x800000) {
-                    sensorResponding = true;
-                    break;
+        for (int i = 0; i < channelCount; i++) {
+            uint32_t bit = 1UL << i;
+            if (!(pendingMask & bit)) continue;
+            
+            if (readMask & bit) {
+                // Confirm with a reading that is not stuck at 0 or full scale
+                int32_t rawReading = values[i];
+                if (rawReading != 0 && rawReading != 0x7FFFFF && rawReading != -0x800000) {
+                    detectedMask |= bit;
+                    pendingMask &= ~bit;
+                    continue;
                 }
             }
-            delay(50);
+            
+            if (elapsed >= timeouts[i]) {
+                pendingMask &= ~bit;
+            }
         }
         
-        if (sensorResponding) {
-            sensorEnabled[i] = true;
-            detectedCount++;
-            Serial.println("DETECTED");
-        } else {
-            sensorEnabled[i] = false;
-            Serial.println("NOT FOUND");
+        if (pendingMask) {
+            clock.delay(10);
         }
     }
     
-    Serial.printf("Sensor detection complete: %d/%d sensors detected\n", detectedCount, MAX_BINS);
+    int detectedCount = 0;
+    enabledMask = detectedMask;
+    for (int i = 0; i < channelCount; i++) {
+        bool found = (detectedMask & (1UL << i)) != 0;
+        if (found) detectedCount++;
+        
+        Serial.printf("Sensor %d... %s\n", i, found ? "DETECTED" : "NOT FOUND");
+    }
+    
+    Serial.printf("Sensor detection complete: %d/%d sensors detected in %lu ms\n",
+                 detectedCount, channelCount, clock.millis() - startTime);
+    
+    // Remember the set for the next boot (an empty result is not cached so
+    // a wiring fault does not shorten the next scan)
+    if (detectedMask != 0) {
+        config.setSensorMask(detectedMask);
+        config.commit();
+    }
     
     // Check if we have minimum required sensors
     if (detectedCount < MIN_REQUIRED_SENSORS) {
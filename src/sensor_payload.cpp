@@ -0,0 +1,94 @@
+#include "sensor_payload.h"
+#include "json_writer.h"
+#include "msgpack_writer.h"
+
+const char* payloadContentType(PayloadFormat format) {
+    return format == PAYLOAD_MSGPACK ? API_MSGPACK_CONTENT_TYPE : "application/json";
+}
+
+template <typename Writer>
+static void writeReadings(Writer& out, const SensorReading* readings, int count) {
+    int valid = 0;
+    for (int i = 0; i < count; i++) {
+        if (readings[i].valid) valid++;
+    }
+
+    out.key("sensor_data");
+    out.beginArray(valid);
+    for (int i = 0; i < count; i++) {
+        if (!readings[i].valid) {
+            continue;
+        }
+        out.beginObject(4);
+        out.key("bin_id");
+        out.value((int32_t)readings[i].bin_id);
+        out.key("weight");
+        out.value(readings[i].weight, API_WEIGHT_DECIMALS);
+        out.key("timestamp");
+        out.value((uint32_t)readings[i].timestamp);
+        out.key("unit");
+        out.value("kg");
+        out.endObject();
+    }
+    out.endArray();
+}
+
+template <typename Writer>
+static size_t writeSnapshot(Writer& out, const char* deviceId, uint32_t boot, uint32_t timestamp,
+                            const SensorReading* readings, int count) {
+    out.beginObject(4);
+    writeReadings(out, readings, count);
+    out.key("device_id");
+    out.value(deviceId);
+    out.key("boot");
+    out.value(boot);
+    out.key("timestamp");
+    out.value(timestamp);
+    out.endObject();
+    return out.overflowed() ? 0 : out.length();
+}
+
+template <typename Writer>
+static size_t writeFrames(Writer& out, const char* deviceId, uint32_t boot, uint32_t timestamp,
+                          const SensorFrame* frames, int frameCount, const SensorReading* readings) {
+    out.beginObject(4);
+    out.key("device_id");
+    out.value(deviceId);
+    out.key("boot");
+    out.value(boot);
+    out.key("timestamp");
+    out.value(timestamp);
+    out.key("frames");
+    out.beginArray(frameCount);
+    for (int i = 0; i < frameCount; i++) {
+        out.beginObject(2);
+        out.key("timestamp");
+        out.value(frames[i].timestamp);
+        writeReadings(out, readings + frames[i].first, frames[i].count);
+        out.endObject();
+    }
+    out.endArray();
+    out.endObject();
+    return out.overflowed() ? 0 : out.length();
+}
+
+size_t writeSensorData(PayloadFormat format, uint8_t* buffer, size_t capacity, const char* deviceId,
+                       uint32_t boot, uint32_t timestamp, const SensorReading* readings, int count) {
+    if (format == PAYLOAD_MSGPACK) {
+        MsgPackWriter out(buffer, capacity);
+        return writeSnapshot(out, deviceId, boot, timestamp, readings, count);
+    }
+    JsonWriter out((char*)buffer, capacity);
+    return writeSnapshot(out, deviceId, boot, timestamp, readings, count);
+}
+
+size_t writeSensorFrames(PayloadFormat format, uint8_t* buffer, size_t capacity, const char* deviceId,
+                         uint32_t boot, uint32_t timestamp, const SensorFrame* frames, int frameCount,
+                         const SensorReading* readings) {
+    if (format == PAYLOAD_MSGPACK) {
+        MsgPackWriter out(buffer, capacity);
+        return writeFrames(out, deviceId, boot, timestamp, frames, frameCount, readings);
+    }
+    JsonWriter out((char*)buffer, capacity);
+    return writeFrames(out, deviceId, boot, timestamp, frames, frameCount, readings);
+}
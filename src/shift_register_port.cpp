@@ -0,0 +1,57 @@
+#include "shift_register_port.h"
+
+ShiftRegisterInputPort::ShiftRegisterInputPort(GpioPort& base, int loadPin, int clockPin, int dataPin, int inputCount)
+    : base(base) {
+    loadMask = 1UL << loadPin;
+    clockMask = 1UL << clockPin;
+    dataMask = 1UL << dataPin;
+
+    if (inputCount > SHIFT_REGISTER_MAX_INPUTS) inputCount = SHIFT_REGISTER_MAX_INPUTS;
+    registerCount = (inputCount + 7) / 8;
+}
+
+void ShiftRegisterInputPort::configurePins(uint32_t outputMask, uint32_t inputMask) {
+    // inputMask names register inputs, not pins; only the chain's own data
+    // line is a real input
+    base.configurePins(outputMask | loadMask | clockMask, dataMask);
+    base.setOutputs(loadMask); // PL idles high (shift mode)
+}
+
+void ShiftRegisterInputPort::setOutputs(uint32_t pinMask) {
+    base.setOutputs(pinMask);
+}
+
+void ShiftRegisterInputPort::clearOutputs(uint32_t pinMask) {
+    base.clearOutputs(pinMask);
+}
+
+uint32_t ShiftRegisterInputPort::readInputs() {
+    // Latch all inputs, then shift them out D7 first, register 0 first
+    base.clearOutputs(loadMask);
+    base.settle();
+    base.setOutputs(loadMask);
+
+    uint32_t inputs = 0;
+    for (int r = 0; r < registerCount; r++) {
+        for (int k = 7; k >= 0; k--) {
+            if (base.readInputs() & dataMask) {
+                inputs |= 1UL << (r * 8 + k);
+            }
+            base.setOutputs(clockMask);
+            base.clearOutputs(clockMask);
+        }
+    }
+    return inputs;
+}
+
+void ShiftRegisterInputPort::settle() {
+    base.settle();
+}
+
+void ShiftRegisterInputPort::beginFrame() {
+    base.beginFrame();
+}
+
+void ShiftRegisterInputPort::endFrame() {
+    base.endFrame();
+}
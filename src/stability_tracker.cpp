@@ -0,0 +1,71 @@
+#include "stability_tracker.h"
+
+StabilityTracker::StabilityTracker() {
+    reset();
+}
+
+void StabilityTracker::reset() {
+    settled = false;
+    hasSettled = false;
+    settledKg = 0.0f;
+    settledMs = 0;
+    windowStartMs = 0;
+    windowCount = 0;
+    windowMean = 0.0f;
+    windowM2 = 0.0f;
+}
+
+bool StabilityTracker::addReading(float weightKg, uint32_t timestampMs) {
+    if (windowCount == 0) {
+        restartWindow(weightKg, timestampMs);
+        return false;
+    }
+
+    float delta = weightKg - windowMean;
+    float mean = windowMean + delta / (windowCount + 1);
+    float m2 = windowM2 + delta * (weightKg - mean);
+
+    // Population variance of the window including this reading
+    if (m2 > (float)(SETTLE_MAX_STDDEV_KG * SETTLE_MAX_STDDEV_KG) * (windowCount + 1)) {
+        settled = false;
+        restartWindow(weightKg, timestampMs);
+        return false;
+    }
+
+    windowMean = mean;
+    windowM2 = m2;
+    windowCount++;
+
+    if (windowCount < SETTLE_MIN_READINGS || timestampMs - windowStartMs < SETTLE_WINDOW_MS) {
+        return false;
+    }
+
+    float change = windowMean - settledKg;
+    bool changed = !hasSettled || change >= MIN_WEIGHT_CHANGE || change <= -MIN_WEIGHT_CHANGE;
+    if (changed) {
+        settledKg = windowMean;
+    }
+    settled = true;
+    hasSettled = true;
+    settledMs = timestampMs;
+    restartWindow(weightKg, timestampMs);
+    return changed;
+}
+
+bool StabilityTracker::getLastSettled(float& weightKg, uint32_t* timestampMs) const {
+    if (!hasSettled) {
+        return false;
+    }
+    weightKg = settledKg;
+    if (timestampMs) {
+        *timestampMs = settledMs;
+    }
+    return true;
+}
+
+void StabilityTracker::restartWindow(float weightKg, uint32_t timestampMs) {
+    windowStartMs = timestampMs;
+    windowCount = 1;
+    windowMean = weightKg;
+    windowM2 = 0.0f;
+}
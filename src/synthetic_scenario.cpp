@@ -0,0 +1,188 @@
+#include "synthetic_scenario.h"
+#include <stdlib.h>
+
+// Irwin-Hall approximation of a unit normal: the four bytes of one random
+// word summed (mean 510, sigma sqrt(4 * (256^2 - 1) / 12))
+#define SYNTHETIC_NOISE_MEAN 510
+#define SYNTHETIC_NOISE_SCALE (1.0f / 147.8f)
+
+// splitmix64; turns (seed, bin) into well-mixed parameter bits
+static uint64_t mixBits(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static float mixUnit(uint64_t& state) {
+    return (mixBits(state) >> 40) * (1.0f / 16777216.0f);
+}
+
+SyntheticScenario::SyntheticScenario() {
+    binCount = 0;
+    lastMs = 0;
+    events = 0;
+    profiles = nullptr;
+    level = nullptr;
+    ratePerMs = nullptr;
+    capacity = nullptr;
+    residual = nullptr;
+    noiseSigma = nullptr;
+    depositMean = nullptr;
+    depositIntervalMs = nullptr;
+    nextEventMs = nullptr;
+    rngState = nullptr;
+    output = nullptr;
+}
+
+SyntheticScenario::~SyntheticScenario() {
+    end();
+}
+
+bool SyntheticScenario::begin(uint32_t count, uint64_t seed, uint32_t startMs) {
+    end();
+    if (count == 0) {
+        return false;
+    }
+
+    // One allocation carved into the per-field arrays
+    const int wordArrays = 10;
+    uint8_t* block = (uint8_t*)calloc(count, wordArrays * 4 + 1);
+    if (!block) {
+        return false;
+    }
+
+    level = (float*)block;
+    ratePerMs = level + count;
+    capacity = ratePerMs + count;
+    residual = capacity + count;
+    noiseSigma = residual + count;
+    depositMean = noiseSigma + count;
+    output = depositMean + count;
+    depositIntervalMs = (uint32_t*)(output + count);
+    nextEventMs = depositIntervalMs + count;
+    rngState = nextEventMs + count;
+    profiles = (uint8_t*)(rngState + count);
+
+    binCount = count;
+    lastMs = startMs;
+    events = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t state = seed ^ ((uint64_t)i * 0xD1B54A32D192ED03ULL);
+        mixBits(state);
+
+        SyntheticProfile p = (SyntheticProfile)(mixBits(state) % SYNTHETIC_PROFILE_COUNT);
+        profiles[i] = (uint8_t)p;
+        capacity[i] = 20.0f + 25.0f * mixUnit(state);           // 20-45 kg, inside the valid range
+        residual[i] = 0.3f * mixUnit(state);
+        level[i] = capacity[i] * 0.8f * mixUnit(state);
+        noiseSigma[i] = 0.005f + 0.045f * mixUnit(state);
+        depositMean[i] = 0.2f + 1.8f * mixUnit(state);
+        depositIntervalMs[i] = 30000 + (uint32_t)(570000 * mixUnit(state)); // 30 s - 10 min
+
+        float kgPerMinute = 0.05f + 0.45f * mixUnit(state);
+        ratePerMs[i] = 0.0f;
+        if (p == SYNTHETIC_FILLING) {
+            ratePerMs[i] = kgPerMinute / 60000.0f;
+        } else if (p == SYNTHETIC_EMPTYING) {
+            ratePerMs[i] = -kgPerMinute / 60000.0f;
+        }
+
+        uint32_t rng = (uint32_t)mixBits(state);
+        rngState[i] = rng ? rng : 1;
+        nextEventMs[i] = startMs + (uint32_t)(depositIntervalMs[i] * mixUnit(state));
+        output[i] = level[i];
+    }
+
+    return true;
+}
+
+void SyntheticScenario::end() {
+    free(level);
+    binCount = 0;
+    profiles = nullptr;
+    level = nullptr;
+    ratePerMs = nullptr;
+    capacity = nullptr;
+    residual = nullptr;
+    noiseSigma = nullptr;
+    depositMean = nullptr;
+    depositIntervalMs = nullptr;
+    nextEventMs = nullptr;
+    rngState = nullptr;
+    output = nullptr;
+}
+
+void SyntheticScenario::step(uint32_t nowMs) {
+    float dt = (float)(uint32_t)(nowMs - lastMs);
+    lastMs = nowMs;
+
+    // Continuous fill and draw-down
+    for (uint32_t i = 0; i < binCount; i++) {
+        level[i] += ratePerMs[i] * dt;
+    }
+
+    // Collections, restocks and deposits
+    for (uint32_t i = 0; i < binCount; i++) {
+        if (level[i] >= capacity[i] || level[i] < 0.0f ||
+            (profiles[i] == SYNTHETIC_DEPOSITS && (int32_t)(nowMs - nextEventMs[i]) >= 0)) {
+            applyEvents(i, nowMs);
+        }
+    }
+
+    // Measurement noise, clamped at empty like a real reading
+    float* out = output;
+    const float* lv = level;
+    const float* sigma = noiseSigma;
+    uint32_t* rng = rngState;
+    for (uint32_t i = 0; i < binCount; i++) {
+        uint32_t x = rng[i];
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        rng[i] = x;
+
+        int32_t sum = (int32_t)((x & 0xFF) + ((x >> 8) & 0xFF) + ((x >> 16) & 0xFF) + (x >> 24));
+        float w = lv[i] + sigma[i] * (float)(sum - SYNTHETIC_NOISE_MEAN) * SYNTHETIC_NOISE_SCALE;
+        out[i] = w > 0.0f ? w : 0.0f;
+    }
+}
+
+SyntheticProfile SyntheticScenario::profile(uint32_t bin) const {
+    return bin < binCount ? (SyntheticProfile)profiles[bin] : SYNTHETIC_STEADY;
+}
+
+void SyntheticScenario::applyEvents(uint32_t bin, uint32_t nowMs) {
+    uint32_t& rng = rngState[bin];
+
+    if (profiles[bin] == SYNTHETIC_DEPOSITS) {
+        while ((int32_t)(nowMs - nextEventMs[bin]) >= 0) {
+            level[bin] += depositMean[bin] * (0.5f + nextUnit(rng));
+            nextEventMs[bin] += (uint32_t)(depositIntervalMs[bin] * (0.5f + nextUnit(rng)));
+            events++;
+        }
+    }
+
+    if (level[bin] >= capacity[bin]) {
+        level[bin] = residual[bin];
+        events++;
+    } else if (level[bin] < 0.0f) {
+        level[bin] = profiles[bin] == SYNTHETIC_EMPTYING ? capacity[bin] * (0.7f + 0.3f * nextUnit(rng)) : 0.0f;
+        events++;
+    }
+}
+
+uint32_t SyntheticScenario::nextRandom(uint32_t& state) {
+    // xorshift32
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+float SyntheticScenario::nextUnit(uint32_t& state) {
+    return (nextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,198 @@
+#include "trace_recorder.h"
+#ifdef ARDUINO
+#include <LittleFS.h>
+#endif
+
+TraceRecorder::TraceRecorder() {
+    recording = false;
+    stopRequested = false;
+    fsMounted = false;
+    recordCount = 0;
+    bytesWritten = 0;
+#ifndef ARDUINO
+    file = nullptr;
+#endif
+}
+
+bool TraceRecorder::start(const SampleTraceHeader& header) {
+    if (recording) {
+        return true;
+    }
+
+    if (!mount()) {
+        Serial.println("ERROR: Trace filesystem not available");
+        return false;
+    }
+
+    // Discard anything queued before this trace
+    SampleTraceRecord stale;
+    while (queue.pop(stale)) {}
+
+    if (!openFile()) {
+        Serial.println("ERROR: Failed to create trace file");
+        return false;
+    }
+
+    uint8_t headerBytes[SAMPLE_TRACE_HEADER_SIZE];
+    encodeTraceHeader(header, headerBytes);
+    writeFile(headerBytes, sizeof(headerBytes));
+
+    recordCount = 0;
+    bytesWritten = sizeof(headerBytes);
+    stopRequested = false;
+    recording = true;
+
+    Serial.printf("Trace recording started: %s\n", TRACE_FILE_PATH);
+    return true;
+}
+
+void TraceRecorder::stop() {
+    if (recording) {
+        stopRequested = true;
+    }
+}
+
+bool TraceRecorder::isRecording() {
+    return recording;
+}
+
+void TraceRecorder::record(uint32_t timestampMs, uint8_t binId, int32_t raw) {
+    if (!recording) {
+        return;
+    }
+
+    SampleTraceRecord record;
+    record.timestampMs = timestampMs;
+    record.binId = binId;
+    record.raw = raw;
+    queue.push(record);
+}
+
+void TraceRecorder::service() {
+    if (!recording) {
+        return;
+    }
+
+    drainQueue();
+
+    if (bytesWritten + SAMPLE_TRACE_RECORD_SIZE > TRACE_MAX_BYTES) {
+        Serial.println("Trace size limit reached");
+        stopRequested = true;
+    }
+
+    if (stopRequested) {
+        recording = false;
+        drainQueue();
+        closeFile();
+        stopRequested = false;
+
+        Serial.printf("Trace recording stopped: %u records, %u bytes, %u dropped\n",
+                     recordCount, (unsigned)bytesWritten, queue.droppedCount());
+    }
+}
+
+uint32_t TraceRecorder::getRecordCount() {
+    return recordCount;
+}
+
+uint32_t TraceRecorder::getDroppedCount() {
+    return queue.droppedCount();
+}
+
+size_t TraceRecorder::getFileSize() {
+    return bytesWritten;
+}
+
+#ifdef ARDUINO
+void TraceRecorder::dump(Print& out) {
+    if (recording || !mount()) {
+        return;
+    }
+
+    File trace = LittleFS.open(TRACE_FILE_PATH, FILE_READ);
+    if (!trace) {
+        out.println("No trace recorded");
+        return;
+    }
+
+    out.printf("TRACE BEGIN %u\n", (unsigned)trace.size());
+
+    uint8_t chunk[32];
+    size_t count;
+    while ((count = trace.read(chunk, sizeof(chunk))) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            out.printf("%02x", chunk[i]);
+        }
+        out.println();
+    }
+
+    out.println("TRACE END");
+    trace.close();
+}
+
+bool TraceRecorder::mount() {
+    if (!fsMounted) {
+        // Format on first use; the partition holds nothing else
+        fsMounted = LittleFS.begin(true);
+    }
+    return fsMounted;
+}
+
+bool TraceRecorder::openFile() {
+    file = LittleFS.open(TRACE_FILE_PATH, FILE_WRITE);
+    return (bool)file;
+}
+
+void TraceRecorder::writeFile(const uint8_t* data, size_t length) {
+    file.write(data, length);
+}
+
+void TraceRecorder::closeFile() {
+    file.close();
+}
+#else
+bool TraceRecorder::mount() {
+    fsMounted = true;
+    return true;
+}
+
+bool TraceRecorder::openFile() {
+    // TRACE_FILE_PATH is relative to the filesystem root; on the host it
+    // lands in the working directory
+    file = fopen(TRACE_FILE_PATH + 1, "wb");
+    return file != nullptr;
+}
+
+void TraceRecorder::writeFile(const uint8_t* data, size_t length) {
+    fwrite(data, 1, length, file);
+}
+
+void TraceRecorder::closeFile() {
+    fclose(file);
+    file = nullptr;
+}
+#endif
+
+void TraceRecorder::drainQueue() {
+    // Write in blocks rather than one flash write per record
+    uint8_t block[SAMPLE_TRACE_RECORD_SIZE * 32];
+    size_t used = 0;
+    SampleTraceRecord record;
+
+    while (queue.pop(record)) {
+        encodeTraceRecord(record, block + used);
+        used += SAMPLE_TRACE_RECORD_SIZE;
+        recordCount++;
+
+        if (used == sizeof(block)) {
+            writeFile(block, used);
+            bytesWritten += used;
+            used = 0;
+        }
+    }
+
+    if (used > 0) {
+        writeFile(block, used);
+        bytesWritten += used;
+    }
+}
@@ -0,0 +1,130 @@
+#include "weight_event_detector.h"
+
+WeightEventDetector::WeightEventDetector() {
+    reset();
+}
+
+void WeightEventDetector::reset() {
+    state = STATE_STARTING;
+    baseline = 0.0f;
+    cusumHigh = 0.0f;
+    cusumLow = 0.0f;
+    lastQuietMs = 0;
+    changeStartMs = 0;
+    windowStartMs = 0;
+    windowCount = 0;
+    windowMin = 0.0f;
+    windowMax = 0.0f;
+    windowSum = 0.0f;
+}
+
+bool WeightEventDetector::addReading(float weightKg, uint32_t timestampMs, WeightEvent& event) {
+    float settledKg;
+
+    switch (state) {
+    case STATE_STARTING:
+        // The first settled weight is the baseline, not an event
+        if (settle(weightKg, timestampMs, settledKg)) {
+            baseline = settledKg;
+            lastQuietMs = timestampMs;
+            state = STATE_SETTLED;
+        }
+        return false;
+
+    case STATE_SETTLED: {
+        float deviation = weightKg - baseline;
+        cusumHigh += deviation - EVENT_CUSUM_SLACK_KG;
+        cusumLow += -deviation - EVENT_CUSUM_SLACK_KG;
+        if (cusumHigh < 0.0f) cusumHigh = 0.0f;
+        if (cusumLow < 0.0f) cusumLow = 0.0f;
+
+        if (cusumHigh == 0.0f && cusumLow == 0.0f) {
+            lastQuietMs = timestampMs;
+        } else if (cusumHigh > EVENT_CUSUM_THRESHOLD_KG || cusumLow > EVENT_CUSUM_THRESHOLD_KG) {
+            changeStartMs = lastQuietMs;
+            restartWindow(weightKg, timestampMs);
+            state = STATE_CHANGING;
+        }
+        return false;
+    }
+
+    case STATE_CHANGING:
+        if (!settle(weightKg, timestampMs, settledKg)) {
+            return false;
+        }
+
+        {
+            float before = baseline;
+            float delta = settledKg - before;
+
+            baseline = settledKg;
+            cusumHigh = 0.0f;
+            cusumLow = 0.0f;
+            lastQuietMs = timestampMs;
+            state = STATE_SETTLED;
+
+            if (delta < EVENT_MIN_DELTA_KG && delta > -EVENT_MIN_DELTA_KG) {
+                return false;
+            }
+
+            if (delta > 0.0f) {
+                event.type = WEIGHT_EVENT_DEPOSIT;
+            } else if (settledKg < EVENT_EMPTY_KG) {
+                event.type = WEIGHT_EVENT_COLLECTION;
+            } else {
+                event.type = WEIGHT_EVENT_REMOVAL;
+            }
+            event.beforeKg = before;
+            event.afterKg = settledKg;
+            event.startMs = changeStartMs;
+            event.settledMs = timestampMs;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* WeightEventDetector::typeName(uint8_t type) {
+    switch (type) {
+    case WEIGHT_EVENT_DEPOSIT: return "deposit";
+    case WEIGHT_EVENT_REMOVAL: return "removal";
+    case WEIGHT_EVENT_COLLECTION: return "collection";
+    default: return "unknown";
+    }
+}
+
+void WeightEventDetector::restartWindow(float weightKg, uint32_t timestampMs) {
+    windowStartMs = timestampMs;
+    windowCount = 1;
+    windowMin = weightKg;
+    windowMax = weightKg;
+    windowSum = weightKg;
+}
+
+bool WeightEventDetector::settle(float weightKg, uint32_t timestampMs, float& settledKg) {
+    if (windowCount == 0) {
+        restartWindow(weightKg, timestampMs);
+        return false;
+    }
+
+    // A reading outside the band starts the window over from itself
+    float low = weightKg < windowMin ? weightKg : windowMin;
+    float high = weightKg > windowMax ? weightKg : windowMax;
+    if (high - low > EVENT_SETTLE_BAND_KG) {
+        restartWindow(weightKg, timestampMs);
+        return false;
+    }
+
+    windowMin = low;
+    windowMax = high;
+    windowSum += weightKg;
+    windowCount++;
+
+    if (windowCount < EVENT_SETTLE_MIN_READINGS || timestampMs - windowStartMs < EVENT_SETTLE_MS) {
+        return false;
+    }
+
+    settledKg = windowSum / windowCount;
+    windowCount = 0;
+    return true;
+}
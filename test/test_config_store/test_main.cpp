@@ -0,0 +1,458 @@
+// ConfigStore against the in-memory NVS: defaults, migration from the
+// per-setting keys of older firmware, reload of the blob, dirty tracking,
+// rejection of blobs that fail their CRC, version 1 blobs and the upload
+// batch limits.
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include "config.h"
+#include "config_store.h"
+#include "crc32.h"
+#include "hal_native.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static std::string readBlob(MemoryKeyValueStore& store) {
+    char blob[1024];
+    store.begin(NVS_NAMESPACE, true);
+    size_t length = store.getBytes(NVS_CONFIG_BLOB, blob, sizeof(blob));
+    store.end();
+    return std::string(blob, length);
+}
+
+static void writeBlob(MemoryKeyValueStore& store, const std::string& blob) {
+    store.begin(NVS_NAMESPACE, false);
+    store.putBytes(NVS_CONFIG_BLOB, blob.data(), blob.size());
+    store.end();
+}
+
+static bool hasKey(MemoryKeyValueStore& store, const char* key) {
+    store.begin(NVS_NAMESPACE, true);
+    bool found = store.isKey(key);
+    store.end();
+    return found;
+}
+
+// A device set up before the blob: one key per setting
+static const char* const LEGACY_KEYS[] = { NVS_WIFI_SSID, NVS_WIFI_PASSWORD, NVS_API_KEY, NVS_API_URL,
+                                           NVS_DEVICE_ID, NVS_SETUP_COMPLETE, NVS_SENSOR_MASK,
+                                           "scale_0", "scale_3", "tare_0", "tare_5" };
+
+static void seedLegacyKeys(MemoryKeyValueStore& store) {
+    store.begin(NVS_NAMESPACE, false);
+    store.putString(NVS_WIFI_SSID, "bin-room");
+    store.putString(NVS_WIFI_PASSWORD, "hunter22");
+    store.putString(NVS_API_KEY, "key-123");
+    store.putString(NVS_API_URL, "https://api.example.test");
+    store.putString(NVS_DEVICE_ID, "smartbin_0001");
+    store.putBool(NVS_SETUP_COMPLETE, true);
+    store.putUInt(NVS_SENSOR_MASK, 0x2D);
+    store.putFloat("scale_0", 140400.0f);
+    store.putFloat("scale_3", -98000.5f);
+    store.putInt("tare_0", -51234);
+    store.putInt("tare_5", 0);
+    store.end();
+}
+
+static void checkLegacySettings(const ConfigStore& config) {
+    TEST_ASSERT_EQUAL_STRING("bin-room", config.getWifiSsid());
+    TEST_ASSERT_EQUAL_STRING("hunter22", config.getWifiPassword());
+    TEST_ASSERT_EQUAL_STRING("key-123", config.getApiKey());
+    TEST_ASSERT_EQUAL_STRING("https://api.example.test", config.getApiUrl());
+    TEST_ASSERT_EQUAL_STRING("smartbin_0001", config.getDeviceId());
+    TEST_ASSERT_TRUE(config.isSetupComplete());
+
+    uint32_t mask = 0;
+    TEST_ASSERT_TRUE(config.getSensorMask(mask));
+    TEST_ASSERT_EQUAL_HEX32(0x2D, mask);
+
+    float scale = 0.0f;
+    TEST_ASSERT_TRUE(config.getScaleFactor(0, scale));
+    TEST_ASSERT_EQUAL_FLOAT(140400.0f, scale);
+    TEST_ASSERT_FALSE(config.getScaleFactor(3, scale));    // Older firmware ignored scales <= 0 too
+    TEST_ASSERT_FALSE(config.getScaleFactor(1, scale));
+
+    int32_t offset = 1;
+    TEST_ASSERT_TRUE(config.getTareOffset(0, offset));
+    TEST_ASSERT_EQUAL_INT32(-51234, offset);
+    TEST_ASSERT_TRUE(config.getTareOffset(5, offset));
+    TEST_ASSERT_EQUAL_INT32(0, offset);
+    TEST_ASSERT_FALSE(config.getTareOffset(1, offset));
+}
+
+static void test_empty_store_loads_defaults_without_writing() {
+    MemoryKeyValueStore store;
+    ConfigStore config(store);
+    TEST_ASSERT_FALSE(config.load());
+    TEST_ASSERT_EQUAL_INT(ConfigStore::SOURCE_DEFAULTS, config.getSource());
+    TEST_ASSERT_EQUAL_STRING(API_BASE_URL, config.getApiUrl());
+    TEST_ASSERT_EQUAL_STRING("", config.getWifiSsid());
+    TEST_ASSERT_FALSE(config.isSetupComplete());
+    TEST_ASSERT_EQUAL_UINT16(UPLOAD_BATCH_FRAMES, config.getUploadBatchFrames());
+    TEST_ASSERT_EQUAL_UINT32(UPLOAD_BATCH_MAX_DELAY_MS, config.getUploadBatchMaxDelayMs());
+
+    uint32_t mask;
+    float scale;
+    TEST_ASSERT_FALSE(config.getSensorMask(mask));
+    TEST_ASSERT_FALSE(config.getScaleFactor(0, scale));
+    TEST_ASSERT_EQUAL_UINT32(0, config.getDirtyFields());
+    TEST_ASSERT_EQUAL_UINT32(0, store.getCommitCount());
+}
+
+static void test_legacy_keys_migrate_to_one_blob() {
+    MemoryKeyValueStore store;
+    seedLegacyKeys(store);
+    uint32_t commitsBefore = store.getCommitCount();
+
+    ConfigStore config(store);
+    TEST_ASSERT_TRUE(config.load());
+    TEST_ASSERT_EQUAL_INT(ConfigStore::SOURCE_LEGACY, config.getSource());
+    checkLegacySettings(config);
+
+    // Blob written, then the old keys removed once it is saved
+    TEST_ASSERT_EQUAL_UINT32(1, config.getCommitCount());
+    TEST_ASSERT_EQUAL_UINT32(commitsBefore + 2, store.getCommitCount());
+    TEST_ASSERT_EQUAL_UINT32(0, config.getDirtyFields());
+    TEST_ASSERT_TRUE(hasKey(store, NVS_CONFIG_BLOB));
+    for (size_t i = 0; i < sizeof(LEGACY_KEYS) / sizeof(LEGACY_KEYS[0]); i++) {
+        TEST_ASSERT_FALSE_MESSAGE(hasKey(store, LEGACY_KEYS[i]), LEGACY_KEYS[i]);
+    }
+
+    // The next boot reads the blob and writes nothing
+    ConfigStore reloaded(store);
+    TEST_ASSERT_TRUE(reloaded.load());
+    TEST_ASSERT_EQUAL_INT(ConfigStore::SOURCE_BLOB, reloaded.getSource());
+    checkLegacySettings(reloaded);
+    TEST_ASSERT_EQUAL_UINT32(commitsBefore + 2, store.getCommitCount());
+}
+
+static void test_failed_migration_keeps_the_old_keys() {
+    MemoryKeyValueStore store;
+    seedLegacyKeys(store);
+
+    // NVS full: the blob cannot be written, so nothing may be removed
+    store.setFull(true);
+    ConfigStore config(store);
+    TEST_ASSERT_TRUE(config.load());
+    TEST_ASSERT_EQUAL_INT(ConfigStore::SOURCE_LEGACY, config.getSource());
+    checkLegacySettings(config);
+    TEST_ASSERT_EQUAL_UINT32(0, config.getCommitCount());
+    TEST_ASSERT_TRUE(config.getDirtyFields() != 0);
+    TEST_ASSERT_FALSE(hasKey(store, NVS_CONFIG_BLOB));
+    for (size_t i = 0; i < sizeof(LEGACY_KEYS) / sizeof(LEGACY_KEYS[0]); i++) {
+        TEST_ASSERT_TRUE_MESSAGE(hasKey(store, LEGACY_KEYS[i]), LEGACY_KEYS[i]);
+    }
+
+    // Space freed: the next commit finishes the migration
+    store.setFull(false);
+    TEST_ASSERT_TRUE(config.commit());
+    for (size_t i = 0; i < sizeof(LEGACY_KEYS) / sizeof(LEGACY_KEYS[0]); i++) {
+        TEST_ASSERT_FALSE_MESSAGE(hasKey(store, LEGACY_KEYS[i]), LEGACY_KEYS[i]);
+    }
+    ConfigStore reloaded(store);
+    TEST_ASSERT_TRUE(reloaded.load());
+    TEST_ASSERT_EQUAL_INT(ConfigStore::SOURCE_BLOB, reloaded.getSource());
+    checkLegacySettings(reloaded);
+}
+
+static void test_legacy_string_too_long_is_not_migrated() {
+    MemoryKeyValueStore store;
+    seedLegacyKeys(store);
+    std::string longKey(CONFIG_API_KEY_MAX + 20, 'k');
+    store.begin(NVS_NAMESPACE, false);
+    store.putString(NVS_API_KEY, longKey.c_str());
+    store.end();
+    uint32_t commitsBefore = store.getCommitCount();
+
+    // The rest loads, but nothing is written or removed
+    ConfigStore config(store);
+    TEST_ASSERT_TRUE(config.load());
+    TEST_ASSERT_EQUAL_INT(ConfigStore::SOURCE_LEGACY, config.getSource());
+    TEST_ASSERT_EQUAL_STRING("", config.getApiKey());
+    TEST_ASSERT_EQUAL_STRING("https://api.example.test", config.getApiUrl());
+    TEST_ASSERT_EQUAL_STRING("bin-room", config.getWifiSsid());
+    TEST_ASSERT_EQUAL_UINT32(commitsBefore, store.getCommitCount());
+    TEST_ASSERT_FALSE(hasKey(store, NVS_CONFIG_BLOB));
+    for (size_t i = 0; i < sizeof(LEGACY_KEYS) / sizeof(LEGACY_KEYS[0]); i++) {
+        TEST_ASSERT_TRUE_MESSAGE(hasKey(store, LEGACY_KEYS[i]), LEGACY_KEYS[i]);
+    }
+    char stored[CONFIG_API_KEY_MAX + 64];
+    store.begin(NVS_NAMESPACE, true);
+    TEST_ASSERT_TRUE(store.getString(NVS_API_KEY, stored, sizeof(stored)));
+    store.end();
+    TEST_ASSERT_EQUAL_STRING(longKey.c_str(), stored);
+}
+
+static void test_blob_round_trips_every_field() {
+    MemoryKeyValueStore store;
+    ConfigStore config(store);
+    config.load();
+    TEST_ASSERT_TRUE(config.setWifiCredentials("ssid", "password"));
+    TEST_ASSERT_TRUE(config.setApiCredentials("k", "https://u.test", "dev"));
+    config.setSetupComplete(true);
+    config.setSensorMask(0x80000001UL);
+    config.setScaleFactor(SENSOR_MAX_CHANNELS - 1, 1234.5f);
+    config.setTareOffset(SENSOR_MAX_CHANNELS - 1, -7);
+    TEST_ASSERT_TRUE(config.setUploadBatch(3, 45000));
+    TEST_ASSERT_TRUE(config.commit());
+
+    ConfigStore reloaded(store);
+    TEST_ASSERT_TRUE(reloaded.load());
+    TEST_ASSERT_EQUAL_INT(ConfigStore::SOURCE_BLOB, reloaded.getSource());
+    TEST_ASSERT_EQUAL_STRING("ssid", reloaded.getWifiSsid());
+    TEST_ASSERT_EQUAL_STRING("password", reloaded.getWifiPassword());
+    TEST_ASSERT_EQUAL_STRING("k", reloaded.getApiKey());
+    TEST_ASSERT_EQUAL_STRING("https://u.test", reloaded.getApiUrl());
+    TEST_ASSERT_EQUAL_STRING("dev", reloaded.getDeviceId());
+    TEST_ASSERT_TRUE(reloaded.isSetupComplete());
+    uint32_t mask;
+    TEST_ASSERT_TRUE(reloaded.getSensorMask(mask));
+    TEST_ASSERT_EQUAL_HEX32(0x80000001UL, mask);
+    float scale;
+    int32_t offset;
+    TEST_ASSERT_TRUE(reloaded.getScaleFactor(SENSOR_MAX_CHANNELS - 1, scale));
+    TEST_ASSERT_EQUAL_FLOAT(1234.5f, scale);
+    TEST_ASSERT_TRUE(reloaded.getTareOffset(SENSOR_MAX_CHANNELS - 1, offset));
+    TEST_ASSERT_EQUAL_INT32(-7, offset);
+    TEST_ASSERT_EQUAL_UINT16(3, reloaded.getUploadBatchFrames());
+    TEST_ASSERT_EQUAL_UINT32(45000, reloaded.getUploadBatchMaxDelayMs());
+}
+
+static void test_only_changes_mark_fields_dirty() {
+    MemoryKeyValueStore store;
+    ConfigStore config(store);
+    config.load();
+    config.setWifiCredentials("ssid", "password");
+    config.setScaleFactor(2, 500.0f);
+    config.setTareOffset(2, 10);
+    config.setSensorMask(0x7);
+    TEST_ASSERT_EQUAL_UINT32(ConfigStore::FIELD_WIFI | ConfigStore::FIELD_CALIBRATION |
+                             ConfigStore::FIELD_SENSOR_MASK, config.getDirtyFields());
+    TEST_ASSERT_TRUE(config.commit());
+    TEST_ASSERT_EQUAL_UINT32(0, config.getDirtyFields());
+    uint32_t commits = store.getCommitCount();
+
+    // Same values again: nothing to write
+    config.setWifiCredentials("ssid", "password");
+    config.setScaleFactor(2, 500.0f);
+    config.setTareOffset(2, 10);
+    config.setSensorMask(0x7);
+    config.setSetupComplete(false);
+    TEST_ASSERT_TRUE(config.setUploadBatch(config.getUploadBatchFrames(), config.getUploadBatchMaxDelayMs()));
+    TEST_ASSERT_EQUAL_UINT32(0, config.getDirtyFields());
+    TEST_ASSERT_TRUE(config.commit());
+    TEST_ASSERT_EQUAL_UINT32(commits, store.getCommitCount());
+    TEST_ASSERT_EQUAL_UINT32(1, config.getCommitCount());
+
+    // One change marks only its group, and costs one commit
+    config.setTareOffset(2, 11);
+    TEST_ASSERT_EQUAL_UINT32(ConfigStore::FIELD_CALIBRATION, config.getDirtyFields());
+    config.setApiCredentials("k", API_BASE_URL, "dev");
+    TEST_ASSERT_EQUAL_UINT32(ConfigStore::FIELD_CALIBRATION | ConfigStore::FIELD_API, config.getDirtyFields());
+    TEST_ASSERT_TRUE(config.commit());
+    TEST_ASSERT_EQUAL_UINT32(commits + 1, store.getCommitCount());
+
+    // Over-long strings are refused and leave the old value
+    std::string longSsid(CONFIG_WIFI_SSID_MAX + 1, 'x');
+    TEST_ASSERT_FALSE(config.setWifiCredentials(longSsid.c_str(), "password"));
+    TEST_ASSERT_EQUAL_STRING("ssid", config.getWifiSsid());
+    TEST_ASSERT_EQUAL_UINT32(0, config.getDirtyFields());
+}
+
+static void test_corrupt_blob_is_ignored() {
+    MemoryKeyValueStore store;
+    ConfigStore config(store);
+    config.load();
+    config.setWifiCredentials("ssid", "password");
+    config.setScaleFactor(0, 321.0f);
+    TEST_ASSERT_TRUE(config.commit());
+    std::string good = readBlob(store);
+    TEST_ASSERT_TRUE(good.size() > 8);
+
+    // Every single flipped byte is caught, header and CRC included
+    for (size_t i = 0; i < good.size(); i++) {
+        std::string bad = good;
+        bad[i] ^= 0x10;
+        writeBlob(store, bad);
+        ConfigStore reloaded(store);
+        TEST_ASSERT_FALSE(reloaded.load());
+        TEST_ASSERT_EQUAL_INT(ConfigStore::SOURCE_DEFAULTS, reloaded.getSource());
+        TEST_ASSERT_EQUAL_STRING("", reloaded.getWifiSsid());
+        float scale;
+        TEST_ASSERT_FALSE(reloaded.getScaleFactor(0, scale));
+    }
+
+    // Truncated, or with bytes trailing the CRC
+    writeBlob(store, good.substr(0, good.size() - 1));
+    ConfigStore truncated(store);
+    TEST_ASSERT_FALSE(truncated.load());
+    writeBlob(store, good + std::string(1, '\0'));
+    ConfigStore padded(store);
+    TEST_ASSERT_FALSE(padded.load());
+
+    writeBlob(store, good);
+    ConfigStore restored(store);
+    TEST_ASSERT_TRUE(restored.load());
+    TEST_ASSERT_EQUAL_STRING("ssid", restored.getWifiSsid());
+}
+
+static void test_boot_counter_counts_without_touching_the_blob() {
+    MemoryKeyValueStore store;
+    ConfigStore config(store);
+    config.load();
+    config.setWifiCredentials("ssid", "password");
+    TEST_ASSERT_TRUE(config.commit());
+    std::string blob = readBlob(store);
+
+    TEST_ASSERT_EQUAL_UINT32(0, config.getBootCount());
+    for (uint32_t boot = 1; boot <= 3; boot++) {
+        ConfigStore next(store);
+        next.load();
+        TEST_ASSERT_EQUAL_UINT32(boot, next.countBoot());
+        TEST_ASSERT_EQUAL_UINT32(boot, next.getBootCount());
+        TEST_ASSERT_EQUAL_UINT32(0, next.getDirtyFields());
+    }
+    TEST_ASSERT_TRUE(blob == readBlob(store));
+    TEST_ASSERT_EQUAL_UINT32(1, config.getCommitCount());
+
+    // 0 stays reserved for unknown when the counter wraps
+    store.begin(NVS_NAMESPACE, false);
+    store.putUInt(NVS_BOOT_COUNT, 0xFFFFFFFFUL);
+    store.end();
+    TEST_ASSERT_EQUAL_UINT32(1, config.countBoot());
+}
+
+static std::string frameBlob(uint16_t version, const std::string& settings) {
+    std::string blob(4, '\0');
+    uint16_t length = (uint16_t)settings.size();
+    memcpy(&blob[0], &version, sizeof(version));
+    memcpy(&blob[2], &length, sizeof(length));
+    blob += settings;
+    uint32_t crc = crc32Update(0, (const uint8_t*)blob.data(), blob.size());
+    return blob + std::string((const char*)&crc, sizeof(crc));
+}
+
+// A version 1 blob, written by firmware before the upload batch settings:
+// the current settings cut off after the last tare offset
+static std::string makeVersion1Blob(MemoryKeyValueStore& store) {
+    const int32_t marker = 0x5A17C0DE;
+    ConfigStore config(store);
+    config.load();
+    config.setWifiCredentials("old-ssid", "old-pass");
+    config.setScaleFactor(1, 777.0f);
+    config.setTareOffset(SENSOR_MAX_CHANNELS - 1, marker);
+    TEST_ASSERT_TRUE(config.setUploadBatch(7, 1234));
+    TEST_ASSERT_TRUE(config.commit());
+
+    std::string settings = readBlob(store).substr(4);
+    settings.resize(settings.size() - 4);
+    size_t end = settings.rfind(std::string((const char*)&marker, sizeof(marker)));
+    TEST_ASSERT_TRUE(end != std::string::npos);
+    return frameBlob(1, settings.substr(0, end + sizeof(marker)));
+}
+
+static void test_version_1_blob_loads_with_defaults_for_newer_fields() {
+    MemoryKeyValueStore store;
+    std::string current = readBlob(store);
+    std::string v1 = makeVersion1Blob(store);
+    writeBlob(store, v1);
+
+    ConfigStore config(store);
+    TEST_ASSERT_TRUE(config.load());
+    TEST_ASSERT_EQUAL_INT(ConfigStore::SOURCE_BLOB, config.getSource());
+    TEST_ASSERT_EQUAL_STRING("old-ssid", config.getWifiSsid());
+    TEST_ASSERT_EQUAL_STRING("old-pass", config.getWifiPassword());
+    float scale;
+    TEST_ASSERT_TRUE(config.getScaleFactor(1, scale));
+    TEST_ASSERT_EQUAL_FLOAT(777.0f, scale);
+    int32_t offset;
+    TEST_ASSERT_TRUE(config.getTareOffset(SENSOR_MAX_CHANNELS - 1, offset));
+    TEST_ASSERT_EQUAL_INT32(0x5A17C0DE, offset);
+    TEST_ASSERT_EQUAL_UINT16(UPLOAD_BATCH_FRAMES, config.getUploadBatchFrames());
+    TEST_ASSERT_EQUAL_UINT32(UPLOAD_BATCH_MAX_DELAY_MS, config.getUploadBatchMaxDelayMs());
+    TEST_ASSERT_EQUAL_UINT32(0, config.getDirtyFields());
+
+    // The next commit writes the current version, and it reloads
+    TEST_ASSERT_TRUE(config.setUploadBatch(2, 5000));
+    TEST_ASSERT_TRUE(config.commit());
+    std::string upgraded = readBlob(store);
+    uint16_t version;
+    memcpy(&version, upgraded.data(), sizeof(version));
+    TEST_ASSERT_TRUE(version > 1);
+    TEST_ASSERT_TRUE(upgraded.size() > v1.size());
+    ConfigStore reloaded(store);
+    TEST_ASSERT_TRUE(reloaded.load());
+    TEST_ASSERT_EQUAL_STRING("old-ssid", reloaded.getWifiSsid());
+    TEST_ASSERT_EQUAL_UINT16(2, reloaded.getUploadBatchFrames());
+    TEST_ASSERT_EQUAL_UINT32(5000, reloaded.getUploadBatchMaxDelayMs());
+}
+
+static void test_blob_length_must_match_its_version() {
+    MemoryKeyValueStore store;
+    std::string v1 = makeVersion1Blob(store);
+    std::string v1Settings = v1.substr(4, v1.size() - 8);
+    std::string current = readBlob(store);
+    uint16_t currentVersion;
+    memcpy(&currentVersion, current.data(), sizeof(currentVersion));
+    std::string currentSettings = current.substr(4, current.size() - 8);
+
+    // Each has a valid CRC; only the version/length pairing is wrong
+    const std::string bad[] = {
+        frameBlob(1, currentSettings),
+        frameBlob(currentVersion, v1Settings),
+        frameBlob(currentVersion + 1, currentSettings),
+        frameBlob(0, v1Settings),
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        writeBlob(store, bad[i]);
+        ConfigStore config(store);
+        TEST_ASSERT_FALSE(config.load());
+        TEST_ASSERT_EQUAL_INT(ConfigStore::SOURCE_DEFAULTS, config.getSource());
+    }
+
+    writeBlob(store, frameBlob(currentVersion, currentSettings));
+    ConfigStore config(store);
+    TEST_ASSERT_TRUE(config.load());
+    TEST_ASSERT_EQUAL_UINT16(7, config.getUploadBatchFrames());
+}
+
+static void test_upload_batch_limits_are_enforced() {
+    MemoryKeyValueStore store;
+    ConfigStore config(store);
+    config.load();
+
+    TEST_ASSERT_TRUE(config.setUploadBatch(1, 0));
+    TEST_ASSERT_TRUE(config.setUploadBatch(UPLOAD_BATCH_MAX_FRAMES, UPLOAD_BATCH_DELAY_LIMIT_MS));
+    TEST_ASSERT_EQUAL_UINT16(UPLOAD_BATCH_MAX_FRAMES, config.getUploadBatchFrames());
+    TEST_ASSERT_EQUAL_UINT32(UPLOAD_BATCH_DELAY_LIMIT_MS, config.getUploadBatchMaxDelayMs());
+    TEST_ASSERT_TRUE(config.commit());
+
+    // Refused values change nothing and mark nothing dirty
+    TEST_ASSERT_FALSE(config.setUploadBatch(0, 1000));
+    TEST_ASSERT_FALSE(config.setUploadBatch(UPLOAD_BATCH_MAX_FRAMES + 1, 1000));
+    TEST_ASSERT_FALSE(config.setUploadBatch(1, UPLOAD_BATCH_DELAY_LIMIT_MS + 1));
+    TEST_ASSERT_FALSE(config.setUploadBatch(0xFFFF, 0xFFFFFFFFUL));
+    TEST_ASSERT_EQUAL_UINT16(UPLOAD_BATCH_MAX_FRAMES, config.getUploadBatchFrames());
+    TEST_ASSERT_EQUAL_UINT32(UPLOAD_BATCH_DELAY_LIMIT_MS, config.getUploadBatchMaxDelayMs());
+    TEST_ASSERT_EQUAL_UINT32(0, config.getDirtyFields());
+
+    TEST_ASSERT_TRUE(config.setUploadBatch(4, 30000));
+    TEST_ASSERT_EQUAL_UINT32(ConfigStore::FIELD_UPLOAD, config.getDirtyFields());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_store_loads_defaults_without_writing);
+    RUN_TEST(test_legacy_keys_migrate_to_one_blob);
+    RUN_TEST(test_blob_round_trips_every_field);
+    RUN_TEST(test_only_changes_mark_fields_dirty);
+    RUN_TEST(test_corrupt_blob_is_ignored);
+    RUN_TEST(test_boot_counter_counts_without_touching_the_blob);
+    RUN_TEST(test_failed_migration_keeps_the_old_keys);
+    RUN_TEST(test_legacy_string_too_long_is_not_migrated);
+    RUN_TEST(test_version_1_blob_loads_with_defaults_for_newer_fields);
+    RUN_TEST(test_blob_length_must_match_its_version);
+    RUN_TEST(test_upload_batch_limits_are_enforced);
+    return UNITY_END();
+}
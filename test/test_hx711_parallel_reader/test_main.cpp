@@ -0,0 +1,261 @@
+// HX711ParallelReader against a fake GpioPort that models HX711 chips at
+// the pin level: DOUT low while a conversion waits, one data bit per
+// rising CLK edge (MSB first), and the 25th-27th pulses selecting gain.
+#include <unity.h>
+#include "hx711_parallel_reader.h"
+
+struct FakeHx711 {
+    int clkPin;
+    int doutPin;
+    bool ready;
+    uint32_t data;      // 24-bit conversion to shift out
+    int pulses;         // Rising edges in the current readout
+    int readouts;
+};
+
+class FakeHx711Port : public GpioPort {
+public:
+    FakeHx711 chips[HX711_PARALLEL_MAX_CHANNELS];
+    int chipCount = 0;
+    uint32_t outputs = 0;
+    uint32_t clearedEdges = 0;
+    int frames = 0;
+    bool inFrame = false;
+
+    int add(int clkPin, int doutPin, int32_t value, bool ready = true) {
+        FakeHx711& chip = chips[chipCount];
+        chip.clkPin = clkPin;
+        chip.doutPin = doutPin;
+        chip.ready = ready;
+        chip.data = (uint32_t)value & 0xFFFFFF;
+        chip.pulses = 0;
+        chip.readouts = 0;
+        return chipCount++;
+    }
+
+    void setOutputs(uint32_t pinMask) override {
+        uint32_t rising = pinMask & ~outputs;
+        outputs |= pinMask;
+        for (int i = 0; i < chipCount; i++) {
+            if (rising & (1UL << chips[i].clkPin)) {
+                chips[i].pulses++;
+            }
+        }
+    }
+
+    void clearOutputs(uint32_t pinMask) override {
+        outputs &= ~pinMask;
+    }
+
+    uint32_t readInputs() override {
+        uint32_t levels = 0;
+        for (int i = 0; i < chipCount; i++) {
+            const FakeHx711& chip = chips[i];
+            bool high;
+            if (chip.pulses == 0) {
+                high = !chip.ready;
+            } else if (chip.pulses <= HX711_DATA_BITS) {
+                // A chip clocked while still converting shifts out garbage
+                high = chip.ready ? (chip.data >> (HX711_DATA_BITS - chip.pulses)) & 1 : (chip.pulses & 1);
+            } else {
+                high = true;    // Readout done, next conversion under way
+            }
+            if (high) levels |= 1UL << chip.doutPin;
+        }
+        return levels;
+    }
+
+    void beginFrame() override {
+        TEST_ASSERT_FALSE(inFrame);
+        inFrame = true;
+        frames++;
+    }
+
+    void clearEdges(uint32_t pinMask) override {
+        clearedEdges |= pinMask;
+    }
+
+    void endFrame() override {
+        TEST_ASSERT_TRUE(inFrame);
+        inFrame = false;
+        TEST_ASSERT_EQUAL_HEX32(0, outputs);    // CLK must end low or the HX711 powers down
+        for (int i = 0; i < chipCount; i++) {
+            if (chips[i].pulses > 0) {
+                chips[i].readouts++;
+                chips[i].ready = false;
+            }
+        }
+    }
+
+    // Start the next readout; conversions become ready again
+    void nextConversion() {
+        for (int i = 0; i < chipCount; i++) {
+            chips[i].pulses = 0;
+            chips[i].ready = true;
+        }
+        clearedEdges = 0;
+    }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Frames carrying the given 24-bit values on the given pins, MSB first
+static void makeFrames(const uint32_t* values, const uint8_t* pins, int count, uint32_t* frames) {
+    for (int bit = 0; bit < HX711_DATA_BITS; bit++) {
+        frames[bit] = 0;
+        for (int ch = 0; ch < count; ch++) {
+            if ((values[ch] >> (HX711_DATA_BITS - 1 - bit)) & 1) {
+                frames[bit] |= 1UL << pins[ch];
+            }
+        }
+    }
+}
+
+static void test_unpack_sign_extends_24_bit_values() {
+    const uint32_t raw[] = { 0x000000, 0x000001, 0x7FFFFF, 0x800000, 0xFFFFFF, 0x800001, 0x123456, 0xEDCBAA };
+    const long expected[] = { 0, 1, 8388607, -8388608, -1, -8388607, 0x123456, -0x123456 };
+    const uint8_t pins[] = { 0, 3, 5, 16, 31, 17, 22, 9 };
+    const int count = sizeof(raw) / sizeof(raw[0]);
+
+    uint32_t frames[HX711_DATA_BITS];
+    makeFrames(raw, pins, count, frames);
+    long values[count];
+    HX711ParallelReader::unpackFrames(frames, pins, count, 0xFF, values);
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_INT32(expected[i], values[i]);
+    }
+}
+
+static void test_unpack_only_writes_masked_channels() {
+    const uint32_t raw[] = { 0x000010, 0xFFFFF0, 0x400000, 0x00FF00 };
+    const uint8_t pins[] = { 4, 5, 6, 7 };
+    uint32_t frames[HX711_DATA_BITS];
+    makeFrames(raw, pins, 4, frames);
+
+    long values[4] = { 111, 222, 333, 444 };
+    HX711ParallelReader::unpackFrames(frames, pins, 4, 0x5, values);
+    TEST_ASSERT_EQUAL_INT32(16, values[0]);
+    TEST_ASSERT_EQUAL_INT32(222, values[1]);
+    TEST_ASSERT_EQUAL_INT32(0x400000, values[2]);
+    TEST_ASSERT_EQUAL_INT32(444, values[3]);
+}
+
+static void test_read_clocks_selected_channels_in_lockstep() {
+    FakeHx711Port port;
+    port.add(12, 4, -5000);
+    port.add(13, 5, 8388607);
+    port.add(14, 18, -8388608);
+    port.add(15, 19, 42, false);
+    const int clk[] = { 12, 13, 14, 15 };
+    const int dout[] = { 4, 5, 18, 19 };
+    HX711ParallelReader reader;
+    reader.begin(&port, clk, dout, 4, 1);
+
+    TEST_ASSERT_EQUAL_HEX32(0x7, reader.readyMask());
+
+    long values[4] = { 0, 0, 0, 0 };
+    TEST_ASSERT_EQUAL_HEX32(0x5, reader.read(0x5, values));
+    TEST_ASSERT_EQUAL_INT(1, port.frames);
+    TEST_ASSERT_EQUAL_INT32(-5000, values[0]);
+    TEST_ASSERT_EQUAL_INT32(0, values[1]);
+    TEST_ASSERT_EQUAL_INT32(-8388608, values[2]);
+
+    // 24 data pulses plus one for gain 128, only on the selected CLK lines
+    TEST_ASSERT_EQUAL_INT(HX711_DATA_BITS + 1, port.chips[0].pulses);
+    TEST_ASSERT_EQUAL_INT(0, port.chips[1].pulses);
+    TEST_ASSERT_EQUAL_INT(HX711_DATA_BITS + 1, port.chips[2].pulses);
+    TEST_ASSERT_EQUAL_INT(0, port.chips[3].pulses);
+    TEST_ASSERT_EQUAL_HEX32((1UL << 4) | (1UL << 18), port.clearedEdges);
+
+    // Read channels are busy converting again; the other is still waiting
+    TEST_ASSERT_EQUAL_HEX32(0x2, reader.readyMask());
+    TEST_ASSERT_EQUAL_HEX32(0x2, reader.read(0x2, values));
+    TEST_ASSERT_EQUAL_INT32(8388607, values[1]);
+}
+
+static void test_read_ignores_channels_past_the_count() {
+    FakeHx711Port port;
+    port.add(12, 4, 7);
+    port.add(13, 5, 9);
+    const int clk[] = { 12, 13 };
+    const int dout[] = { 4, 5 };
+    HX711ParallelReader reader;
+    reader.begin(&port, clk, dout, 2, 3);
+
+    long values[2];
+    TEST_ASSERT_EQUAL_HEX32(0, reader.read(0xFFFFFFFCUL, values));
+    TEST_ASSERT_EQUAL_INT(0, port.frames);
+    TEST_ASSERT_EQUAL_HEX32(0x3, reader.read(0xFFFFFFFFUL, values));
+    TEST_ASSERT_EQUAL_INT32(7, values[0]);
+    TEST_ASSERT_EQUAL_INT32(9, values[1]);
+    TEST_ASSERT_EQUAL_INT(HX711_DATA_BITS + 3, port.chips[0].pulses);    // Gain 64
+}
+
+static void test_shared_clock_group_waits_for_every_member() {
+    // Channels 0-2 share CLK 12; channel 3 has its own line
+    FakeHx711Port port;
+    port.add(12, 4, 100);
+    port.add(12, 5, -200, false);
+    port.add(12, 6, 300);
+    port.add(13, 7, 400);
+    const int clk[] = { 12, 12, 12, 13 };
+    const int dout[] = { 4, 5, 6, 7 };
+    HX711ParallelReader reader;
+    reader.begin(&port, clk, dout, 4, 1);
+
+    TEST_ASSERT_EQUAL_HEX32(0x7, reader.getGroupMask(0));
+    TEST_ASSERT_EQUAL_HEX32(0x7, reader.getGroupMask(2));
+    TEST_ASSERT_EQUAL_HEX32(0x8, reader.getGroupMask(3));
+
+    // One member still converting holds back the whole group
+    TEST_ASSERT_EQUAL_HEX32(0x8, reader.readyMask());
+
+    port.chips[1].ready = true;
+    TEST_ASSERT_EQUAL_HEX32(0xF, reader.readyMask());
+
+    // Asking for one member reads them all, since they share the pulses
+    long values[4] = { 0, 0, 0, 0 };
+    TEST_ASSERT_EQUAL_HEX32(0x7, reader.read(0x2, values));
+    TEST_ASSERT_EQUAL_INT32(100, values[0]);
+    TEST_ASSERT_EQUAL_INT32(-200, values[1]);
+    TEST_ASSERT_EQUAL_INT32(300, values[2]);
+    TEST_ASSERT_EQUAL_INT32(0, values[3]);
+    TEST_ASSERT_EQUAL_HEX32(0x70, port.clearedEdges);
+}
+
+static void test_inactive_member_does_not_hold_back_its_group() {
+    FakeHx711Port port;
+    port.add(12, 4, 100);
+    port.add(12, 5, 0, false);      // Absent: DOUT never goes low
+    const int clk[] = { 12, 12 };
+    const int dout[] = { 4, 5 };
+    HX711ParallelReader reader;
+    reader.begin(&port, clk, dout, 2, 1);
+    TEST_ASSERT_EQUAL_HEX32(0, reader.readyMask());
+
+    reader.setActiveChannels(0x1);
+    TEST_ASSERT_EQUAL_HEX32(0x1, reader.getGroupMask(0));
+    TEST_ASSERT_EQUAL_HEX32(0x1, reader.readyMask());
+
+    long values[2] = { 0, 0 };
+    TEST_ASSERT_EQUAL_HEX32(0x1, reader.read(0x1, values));
+    TEST_ASSERT_EQUAL_INT32(100, values[0]);
+
+    port.nextConversion();
+    port.chips[1].ready = false;
+    reader.setActiveChannels(0x3);
+    TEST_ASSERT_EQUAL_HEX32(0x3, reader.getGroupMask(0));
+    TEST_ASSERT_EQUAL_HEX32(0, reader.readyMask());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_unpack_sign_extends_24_bit_values);
+    RUN_TEST(test_unpack_only_writes_masked_channels);
+    RUN_TEST(test_read_clocks_selected_channels_in_lockstep);
+    RUN_TEST(test_read_ignores_channels_past_the_count);
+    RUN_TEST(test_shared_clock_group_waits_for_every_member);
+    RUN_TEST(test_inactive_member_does_not_hold_back_its_group);
+    return UNITY_END();
+}
@@ -0,0 +1,148 @@
+// RingBuffer: FIFO order, full/drop accounting, the 2^32 wrap of the
+// free-running indices, and a producer/consumer thread pair hammering one
+// buffer the way the sampling task and the main loop do.
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "ring_buffer.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_pops_in_push_order() {
+    RingBuffer<int, 8> buffer;
+    TEST_ASSERT_TRUE(buffer.empty());
+    TEST_ASSERT_EQUAL_UINT(8, buffer.capacity());
+
+    int item = -1;
+    TEST_ASSERT_FALSE(buffer.pop(item));
+    TEST_ASSERT_EQUAL_INT(-1, item);
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(buffer.push(i));
+    }
+    TEST_ASSERT_EQUAL_UINT(5, buffer.size());
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(buffer.pop(item));
+        TEST_ASSERT_EQUAL_INT(i, item);
+    }
+    TEST_ASSERT_TRUE(buffer.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, buffer.droppedCount());
+}
+
+static void test_full_buffer_drops_and_counts() {
+    RingBuffer<int, 4> buffer;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(buffer.push(i));
+    }
+    TEST_ASSERT_EQUAL_UINT(4, buffer.size());
+
+    // All Capacity slots are usable; the next pushes are refused and counted
+    TEST_ASSERT_FALSE(buffer.push(100));
+    TEST_ASSERT_FALSE(buffer.push(101));
+    TEST_ASSERT_EQUAL_UINT32(2, buffer.droppedCount());
+    TEST_ASSERT_EQUAL_UINT(4, buffer.size());
+
+    // A pop frees exactly one slot; the dropped items never appear
+    int item;
+    TEST_ASSERT_TRUE(buffer.pop(item));
+    TEST_ASSERT_EQUAL_INT(0, item);
+    TEST_ASSERT_TRUE(buffer.push(4));
+    TEST_ASSERT_FALSE(buffer.push(102));
+    TEST_ASSERT_EQUAL_UINT32(3, buffer.droppedCount());
+    for (int i = 1; i <= 4; i++) {
+        TEST_ASSERT_TRUE(buffer.pop(item));
+        TEST_ASSERT_EQUAL_INT(i, item);
+    }
+    TEST_ASSERT_FALSE(buffer.pop(item));
+}
+
+static void test_indices_wrap_past_2_32() {
+    // Head wraps first, while tail is still just below 2^32
+    RingBuffer<uint32_t, 8> buffer(0xFFFFFFFDUL);
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(buffer.push(i));
+        TEST_ASSERT_EQUAL_UINT(i + 1, buffer.size());
+    }
+    TEST_ASSERT_FALSE(buffer.push(99));
+    TEST_ASSERT_EQUAL_UINT32(1, buffer.droppedCount());
+
+    uint32_t item;
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(buffer.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(i, item);
+        TEST_ASSERT_EQUAL_UINT(7 - i, buffer.size());
+    }
+    TEST_ASSERT_FALSE(buffer.pop(item));
+
+    // Keep cycling through the wrap with the buffer partly full
+    uint32_t next = 100;
+    uint32_t expected = 100;
+    RingBuffer<uint32_t, 4> small(0xFFFFFFF0UL);
+    for (int round = 0; round < 64; round++) {
+        TEST_ASSERT_TRUE(small.push(next++));
+        TEST_ASSERT_TRUE(small.push(next++));
+        TEST_ASSERT_TRUE(small.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(expected++, item);
+        TEST_ASSERT_TRUE(small.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(expected++, item);
+        TEST_ASSERT_TRUE(small.empty());
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, small.droppedCount());
+}
+
+// Each item carries its sequence number twice, so a slot read while it is
+// being written shows up as a mismatch
+struct Sample {
+    uint32_t sequence;
+    uint32_t check;
+    uint64_t padding[3];
+};
+
+static void test_two_thread_stress_loses_and_reorders_nothing() {
+    static RingBuffer<Sample, 64> buffer(0xFFFFF000UL);     // Wraps during the run
+    const uint32_t items = 500000;
+    std::atomic<uint32_t> refused(0);
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < items; i++) {
+            Sample sample;
+            sample.sequence = i;
+            sample.check = ~i;
+            sample.padding[0] = sample.padding[1] = sample.padding[2] = i;
+            while (!buffer.push(sample)) {
+                refused.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+    while (expected < items) {
+        Sample sample;
+        if (!buffer.pop(sample)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (sample.sequence != expected || sample.check != ~expected || sample.padding[2] != expected) {
+            errors++;
+        }
+        expected = sample.sequence + 1;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, errors);
+    TEST_ASSERT_EQUAL_UINT32(items, expected);
+    TEST_ASSERT_TRUE(buffer.empty());
+    TEST_ASSERT_EQUAL_UINT32(refused.load(), buffer.droppedCount());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pops_in_push_order);
+    RUN_TEST(test_full_buffer_drops_and_counts);
+    RUN_TEST(test_indices_wrap_past_2_32);
+    RUN_TEST(test_two_thread_stress_loses_and_reorders_nothing);
+    return UNITY_END();
+}
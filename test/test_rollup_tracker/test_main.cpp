@@ -0,0 +1,244 @@
+// RollupTracker fed from a virtual clock: windows aligned to multiples of
+// their length, windows that close without further readings, reset after a
+// re-tare (on its own and through SensorManager), and the millis() wrap.
+#include <unity.h>
+#include <vector>
+#include "config.h"
+#include "config_store.h"
+#include "hal_native.h"
+#include "rollup_tracker.h"
+#include "sensor_manager.h"
+
+static const uint32_t MINUTE_MS = 60000;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// One tracker and the rollups it has closed, by window
+struct Feed {
+    VirtualClock clock;
+    RollupTracker tracker;
+    std::vector<Rollup> closed;
+
+    void add(float weightKg) {
+        Rollup out[ROLLUP_WINDOW_COUNT];
+        int count = tracker.addReading(weightKg, clock.millis(), out);
+        closed.insert(closed.end(), out, out + count);
+    }
+
+    void close() {
+        Rollup out[ROLLUP_WINDOW_COUNT];
+        int count = tracker.closeExpired(clock.millis(), out);
+        closed.insert(closed.end(), out, out + count);
+    }
+
+    // A reading every periodMs for durationMs, weights from weightAt()
+    template <typename F>
+    void run(uint32_t durationMs, uint32_t periodMs, F weightAt) {
+        for (uint32_t t = 0; t < durationMs; t += periodMs) {
+            add(weightAt(t));
+            clock.delay(periodMs);
+            close();
+        }
+    }
+
+    std::vector<Rollup> window(int index) const {
+        std::vector<Rollup> out;
+        for (size_t i = 0; i < closed.size(); i++) {
+            if (closed[i].window == index) out.push_back(closed[i]);
+        }
+        return out;
+    }
+};
+
+static void test_windows_align_to_multiples_of_their_length() {
+    Feed feed;
+    feed.clock.delay(12345);    // Not on a window boundary
+    uint32_t firstMs = feed.clock.millis();
+    int n = 0;
+    feed.run(2 * 3600000UL, 1000, [&](uint32_t) { return (float)(n++ % 10); });
+
+    for (int w = 0; w < ROLLUP_WINDOW_COUNT; w++) {
+        uint32_t length = RollupTracker::windowLength(w);
+        std::vector<Rollup> rollups = feed.window(w);
+        TEST_ASSERT_TRUE(rollups.size() >= 1);
+        for (size_t i = 0; i < rollups.size(); i++) {
+            TEST_ASSERT_EQUAL_UINT32(length, rollups[i].lengthMs);
+            TEST_ASSERT_EQUAL_UINT32(0, rollups[i].startMs % length);
+            if (i > 0) {
+                TEST_ASSERT_EQUAL_UINT32(rollups[i - 1].startMs + length, rollups[i].startMs);
+            }
+        }
+        // The first window is the one the first reading fell in, so it is short
+        TEST_ASSERT_EQUAL_UINT32(firstMs - firstMs % length, rollups[0].startMs);
+    }
+
+    // A full minute at 1 Hz: 60 readings of 0..9, six times over
+    std::vector<Rollup> minutes = feed.window(0);
+    const Rollup& full = minutes[1];
+    TEST_ASSERT_EQUAL_UINT32(60, full.count);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, full.minKg);
+    TEST_ASSERT_EQUAL_FLOAT(9.0f, full.maxKg);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 4.5f, full.meanKg);
+    TEST_ASSERT_EQUAL_UINT32(full.startMs + MINUTE_MS - 1000 + firstMs % 1000, full.lastMs);
+    TEST_ASSERT_EQUAL_UINT32(48, minutes[0].count);    // From 12.345 s
+
+    // Closes within a poll of its end, not at the next reading
+    TEST_ASSERT_EQUAL_UINT32(2 * 3600000UL / MINUTE_MS, minutes.size());
+}
+
+static void test_window_closes_without_further_readings() {
+    Feed feed;
+    feed.clock.delay(5 * MINUTE_MS + 1000);
+    for (int i = 0; i < 10; i++) {
+        feed.add(3.0f + i);
+        feed.clock.delay(1000);
+    }
+    feed.close();
+    TEST_ASSERT_EQUAL_UINT(0, feed.closed.size());
+
+    // The bin goes quiet; the minute still closes at its end
+    feed.clock.delay(MINUTE_MS - 11000 - 1);
+    feed.close();
+    TEST_ASSERT_EQUAL_UINT(0, feed.closed.size());
+    feed.clock.delay(1);
+    feed.close();
+    TEST_ASSERT_EQUAL_UINT(1, feed.closed.size());
+    const Rollup& minute = feed.closed[0];
+    TEST_ASSERT_EQUAL_UINT8(0, minute.window);
+    TEST_ASSERT_EQUAL_UINT32(5 * MINUTE_MS, minute.startMs);
+    TEST_ASSERT_EQUAL_UINT32(10, minute.count);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, minute.minKg);
+    TEST_ASSERT_EQUAL_FLOAT(12.0f, minute.maxKg);
+    TEST_ASSERT_EQUAL_FLOAT(7.5f, minute.meanKg);
+    TEST_ASSERT_EQUAL_FLOAT(12.0f, minute.lastKg);
+
+    // Silent minutes are not reported; the longer windows close on time too
+    feed.clock.delay(2 * 3600000UL);
+    feed.close();
+    TEST_ASSERT_EQUAL_UINT(ROLLUP_WINDOW_COUNT, feed.closed.size());
+    for (int w = 1; w < ROLLUP_WINDOW_COUNT; w++) {
+        TEST_ASSERT_EQUAL_UINT32(10, feed.window(w)[0].count);
+    }
+    feed.close();
+    TEST_ASSERT_EQUAL_UINT(ROLLUP_WINDOW_COUNT, feed.closed.size());
+
+    // The next reading opens the window it falls in
+    uint32_t nowMs = feed.clock.millis();
+    feed.add(1.0f);
+    feed.clock.delay(MINUTE_MS);
+    feed.close();
+    TEST_ASSERT_EQUAL_UINT(ROLLUP_WINDOW_COUNT + 1, feed.closed.size());
+    TEST_ASSERT_EQUAL_UINT32(nowMs - nowMs % MINUTE_MS, feed.closed.back().startMs);
+    TEST_ASSERT_EQUAL_UINT32(1, feed.closed.back().count);
+}
+
+static void test_reset_drops_open_windows() {
+    Feed feed;
+    for (int i = 0; i < 30; i++) {
+        feed.add(8.0f);
+        feed.clock.delay(1000);
+    }
+    feed.tracker.reset();
+    feed.clock.delay(2 * 3600000UL);
+    feed.close();
+    TEST_ASSERT_EQUAL_UINT(0, feed.closed.size());
+
+    // Readings after the reset start fresh windows
+    uint32_t startMs = feed.clock.millis();
+    feed.add(0.5f);
+    feed.clock.delay(MINUTE_MS);
+    feed.close();
+    TEST_ASSERT_EQUAL_UINT(1, feed.closed.size());
+    TEST_ASSERT_EQUAL_UINT32(startMs - startMs % MINUTE_MS, feed.closed[0].startMs);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, feed.closed[0].maxKg);
+}
+
+static void test_windows_close_across_the_millis_wrap() {
+    Feed feed;
+    feed.clock.delay(0xFFFFFFFFUL - 3 * MINUTE_MS);
+    uint32_t readings = 0;
+    feed.run(10 * MINUTE_MS, 500, [&](uint32_t) { readings++; return 4.0f; });
+    TEST_ASSERT_TRUE(feed.clock.millis() < 0x80000000UL);    // Wrapped
+
+    // Every reading counted exactly once, in minutes that follow each other
+    std::vector<Rollup> minutes = feed.window(0);
+    TEST_ASSERT_TRUE(minutes.size() >= 9);
+    uint32_t counted = 0;
+    for (size_t i = 0; i < minutes.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(MINUTE_MS, minutes[i].lengthMs);
+        TEST_ASSERT_EQUAL_UINT32(0, minutes[i].startMs % MINUTE_MS);
+        TEST_ASSERT_TRUE(minutes[i].count >= 1);
+        TEST_ASSERT_TRUE(minutes[i].count <= MINUTE_MS / 500);
+        TEST_ASSERT_EQUAL_FLOAT(4.0f, minutes[i].meanKg);
+        if (i > 0) {
+            TEST_ASSERT_TRUE((int32_t)(minutes[i].startMs - minutes[i - 1].lastMs) > -(int32_t)MINUTE_MS);
+            TEST_ASSERT_TRUE((int32_t)(minutes[i].lastMs - minutes[i - 1].lastMs) > 0);
+        }
+        counted += minutes[i].count;
+    }
+    // The last, still open, minute holds the rest
+    TEST_ASSERT_TRUE(readings - counted < MINUTE_MS / 500);
+    TEST_ASSERT_TRUE(readings > counted);
+}
+
+static void test_retare_resets_the_bins_rollups() {
+    VirtualClock clock;
+    MemoryKeyValueStore store;
+    ConfigStore config(store);
+    SimulatedLoadCellBank bank(clock, 2, 5);
+    SensorManager manager(bank, clock, config);
+    config.load();
+    float scaleFactors[] = HX711_DEFAULT_SCALE_FACTORS;
+    for (int i = 0; i < 2; i++) {
+        bank.cell(i).countsPerKg = scaleFactors[i];
+        bank.cell(i).noiseCounts = 50.0f;
+    }
+    manager.init();
+    bank.setLoad(0, 9.0f);
+    bank.setLoad(1, 3.0f);
+
+    auto run = [&](uint32_t ms) {
+        for (uint32_t i = 0; i < ms; i++) {
+            clock.advanceMicros(1000);
+            manager.update();
+        }
+    };
+
+    // Align to a minute, fill half of one, then re-zero bin 0 with the load on
+    run(MINUTE_MS - clock.millis() % MINUTE_MS);
+    Rollup rollup;
+    while (manager.popRollup(rollup)) {}
+    uint32_t tareMinuteMs = clock.millis();
+    run(30000);
+    TEST_ASSERT_TRUE(manager.requestTare(0));
+    run(MINUTE_MS);
+
+    std::vector<Rollup> bin0;
+    std::vector<Rollup> bin1;
+    while (manager.popRollup(rollup)) {
+        if (rollup.window != 0) continue;
+        (rollup.binId == 0 ? bin0 : bin1).push_back(rollup);
+    }
+
+    // Bin 0's half-filled minute was dropped; its next one is all post-tare
+    TEST_ASSERT_TRUE(bin0.size() >= 1);
+    for (size_t i = 0; i < bin0.size(); i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, bin0[i].maxKg);
+    }
+    // Bin 1 was not touched and reports the minute of the re-tare in full
+    TEST_ASSERT_TRUE(bin1.size() >= 1);
+    TEST_ASSERT_EQUAL_UINT32(tareMinuteMs, bin1[0].startMs);
+    TEST_ASSERT_TRUE(bin1[0].lastMs - bin1[0].startMs > 50000);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 3.0f, bin1[0].meanKg);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_windows_align_to_multiples_of_their_length);
+    RUN_TEST(test_window_closes_without_further_readings);
+    RUN_TEST(test_reset_drops_open_windows);
+    RUN_TEST(test_windows_close_across_the_millis_wrap);
+    RUN_TEST(test_retare_resets_the_bins_rollups);
+    return UNITY_END();
+}
@@ -0,0 +1,230 @@
+// SensorManager behaviour on the simulated HX711 bank and virtual clock.
+#include <unity.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+#include "config.h"
+#include "config_store.h"
+#include "hal_native.h"
+#include "sample_trace.h"
+#include "sensor_manager.h"
+
+static const uint32_t STEP_US = 1000;
+
+struct Rig {
+    VirtualClock clock;
+    MemoryKeyValueStore store;
+    ConfigStore config;
+    SimulatedLoadCellBank bank;
+    SensorManager manager;
+
+    // Bins start empty for the first-boot tare, then get 2, 3, 4... kg
+    explicit Rig(int bins, uint32_t startUs = 0) : config(store), bank(clock, bins, 11), manager(bank, clock, config) {
+        clock.advanceMicros(startUs);
+        config.load();
+        float scaleFactors[] = HX711_DEFAULT_SCALE_FACTORS;
+        int scaleCount = sizeof(scaleFactors) / sizeof(scaleFactors[0]);
+        for (int i = 0; i < bins; i++) {
+            bank.cell(i).countsPerKg = i < scaleCount ? scaleFactors[i] : HX711_DEFAULT_SCALE_FACTOR;
+            bank.cell(i).noiseCounts = 50.0f;
+        }
+        manager.init();
+        for (int i = 0; i < bins; i++) {
+            bank.setLoad(i, 2.0f + i);
+        }
+    }
+
+    void run(uint32_t ms) {
+        for (uint32_t i = 0; i < ms * 1000 / STEP_US; i++) {
+            clock.advanceMicros(STEP_US);
+            manager.update();
+        }
+    }
+};
+
+static char workDir[64];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static std::vector<uint8_t> readFile(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* f = fopen(path, "rb");
+    if (!f) return data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(f);
+    return data;
+}
+
+static void test_trace_timestamps_follow_millis_across_the_micros_wrap() {
+    // micros() wraps 4294.97 s after boot; record from just before that
+    Rig rig(2, 4290000000UL);
+    rig.run(1000);
+    TEST_ASSERT_TRUE(rig.manager.startTrace());
+    uint32_t startMs = rig.clock.millis();
+    rig.run(10000);
+    uint32_t endMs = rig.clock.millis();
+    rig.manager.stopTrace();
+    rig.run(10);
+
+    std::vector<uint8_t> trace = readFile(TRACE_FILE_PATH + 1);
+    TEST_ASSERT_GREATER_THAN(SAMPLE_TRACE_HEADER_SIZE, trace.size());
+    SampleTraceHeader header;
+    TEST_ASSERT_TRUE(decodeTraceHeader(trace.data(), header));
+    TEST_ASSERT_EQUAL_UINT32(startMs, header.startMillis);
+
+    size_t headerSize = traceHeaderSize(header.version);
+    size_t count = (trace.size() - headerSize) / SAMPLE_TRACE_RECORD_SIZE;
+    TEST_ASSERT_GREATER_THAN(100, count);
+    uint32_t previousMs = header.startMillis;
+    for (size_t i = 0; i < count; i++) {
+        SampleTraceRecord record;
+        decodeTraceRecord(trace.data() + headerSize + i * SAMPLE_TRACE_RECORD_SIZE, record);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(previousMs, record.timestampMs);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(endMs, record.timestampMs);
+        previousMs = record.timestampMs;
+    }
+    TEST_ASSERT_GREATER_THAN(endMs - 100, previousMs);
+}
+
+// Load is constant after the first readings, so a minute leaves every bin idle
+static void settleIdle(Rig& rig) {
+    rig.run(60000);
+    for (int i = 0; i < rig.manager.getChannelCount(); i++) {
+        TEST_ASSERT_FALSE(rig.manager.isBinActive(i));
+    }
+}
+
+static void test_calibration_capture_reads_an_idle_bin_at_every_conversion() {
+    Rig rig(2);
+    settleIdle(rig);
+
+    // 20 conversions at 10 SPS; at the idle interval they would take 20 s
+    TEST_ASSERT_TRUE(rig.manager.beginCalibration(1));
+    uint32_t startMs = rig.clock.millis();
+    int32_t average = 0;
+    TEST_ASSERT_TRUE(rig.manager.addCalibrationPoint(3.0f, &average));
+    TEST_ASSERT_LESS_THAN_UINT32(CALIBRATION_CAPTURE_TIMEOUT / 2, rig.clock.millis() - startMs);
+    TEST_ASSERT_INT32_WITHIN(2000, rig.bank.cell(1).zeroCounts + (int32_t)(3.0f * rig.bank.cell(1).countsPerKg), average);
+    rig.manager.cancelCalibration();
+}
+
+static void test_tare_request_reads_an_idle_bin_at_once() {
+    Rig rig(2);
+    settleIdle(rig);
+
+    // One reading is HX711_SAMPLES_PER_READING conversions: 0.6 s, not 6 s
+    TEST_ASSERT_TRUE(rig.manager.requestTare(1));
+    rig.run(800);
+    SensorReading* readings = rig.manager.getAllReadings();
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, readings[1].weight);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 2.0f, readings[0].weight);
+}
+
+static void test_idle_bin_wakes_on_the_first_read_after_a_load_change() {
+    Rig rig(2);
+    settleIdle(rig);
+
+    // Seen on the next idle read, not once the Hampel window has moved over
+    rig.bank.setLoad(0, 7.0f);
+    uint32_t startMs = rig.clock.millis();
+    while (!rig.manager.isBinActive(0) && rig.clock.millis() - startMs < 10000) {
+        rig.run(10);
+    }
+    TEST_ASSERT_TRUE(rig.manager.isBinActive(0));
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(ADAPTIVE_IDLE_INTERVAL_MS + 200, rig.clock.millis() - startMs);
+    TEST_ASSERT_FALSE(rig.manager.isBinActive(1));
+}
+
+static void test_lone_glitches_do_not_wake_an_idle_bin() {
+    Rig rig(2);
+    settleIdle(rig);
+
+    // Activity sees the raw conversions, spikes included; each one costs a
+    // confirming read rather than a wake for ADAPTIVE_HOLD_MS
+    rig.bank.cell(0).glitchRate = 0.01f;
+    rig.bank.cell(0).glitchCounts = 50000;
+    for (int second = 0; second < 600; second++) {
+        rig.run(1000);
+        TEST_ASSERT_FALSE(rig.manager.isBinActive(0));
+    }
+}
+
+static void test_single_point_calibration_reports_failure() {
+    Rig rig(2);
+    settleIdle(rig);
+    float before = rig.manager.getScaleFactor(1);
+
+    // Bin 1 holds 3 kg: the factor comes from the change since tare
+    TEST_ASSERT_TRUE(rig.manager.calibrateSensor(1, 3.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f * before, rig.bank.cell(1).countsPerKg, rig.manager.getScaleFactor(1));
+    float saved = 0.0f;
+    TEST_ASSERT_TRUE(rig.config.getScaleFactor(1, saved));
+    TEST_ASSERT_EQUAL_FLOAT(rig.manager.getScaleFactor(1), saved);
+    TEST_ASSERT_EQUAL_UINT32(0, rig.config.getDirtyFields());
+    float calibrated = saved;
+
+    // Nothing on the bin: no change from tare, factor kept
+    rig.bank.setLoad(1, 0.0f);
+    rig.run(2000);
+    TEST_ASSERT_FALSE(rig.manager.calibrateSensor(1, 3.0f));
+    TEST_ASSERT_EQUAL_FLOAT(calibrated, rig.manager.getScaleFactor(1));
+
+    // A factor that cannot be saved is not kept either
+    rig.bank.setLoad(1, 6.0f);
+    rig.run(2000);
+    rig.store.setFull(true);
+    TEST_ASSERT_FALSE(rig.manager.calibrateSensor(1, 3.0f));
+    TEST_ASSERT_EQUAL_FLOAT(calibrated, rig.manager.getScaleFactor(1));
+    TEST_ASSERT_TRUE(rig.config.getScaleFactor(1, saved));
+    TEST_ASSERT_EQUAL_FLOAT(calibrated, saved);
+
+    // No readings at all
+    rig.store.setFull(false);
+    rig.bank.cell(1).present = false;
+    TEST_ASSERT_FALSE(rig.manager.calibrateSensor(1, 3.0f));
+    TEST_ASSERT_EQUAL_FLOAT(calibrated, rig.manager.getScaleFactor(1));
+}
+
+static void test_activity_threshold_follows_the_scale_factor() {
+    Rig rig(2);
+    settleIdle(rig);
+
+    // At ten times the counts per kg, a 0.5 kg step reads as 0.05 kg: below
+    // ADAPTIVE_ACTIVITY_KG, so the bin stays idle
+    float scale = rig.manager.getScaleFactor(0);
+    rig.manager.setScaleFactor(0, scale * 10.0f);
+    rig.run(2000);
+    rig.bank.setLoad(0, 2.5f);
+    rig.run(5000);
+    TEST_ASSERT_FALSE(rig.manager.isBinActive(0));
+
+    // Back at the real scale the same step wakes it
+    rig.manager.setScaleFactor(0, scale);
+    rig.run(2000);
+    rig.bank.setLoad(0, 2.0f);
+    rig.run(ADAPTIVE_IDLE_INTERVAL_MS + 200);
+    TEST_ASSERT_TRUE(rig.manager.isBinActive(0));
+}
+
+int main(int argc, char** argv) {
+    // Traces land in the working directory; keep them out of the project
+    strcpy(workDir, "/tmp/sensor_manager_test.XXXXXX");
+    if (mkdtemp(workDir) == nullptr || chdir(workDir) != 0) {
+        return 1;
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_trace_timestamps_follow_millis_across_the_micros_wrap);
+    RUN_TEST(test_calibration_capture_reads_an_idle_bin_at_every_conversion);
+    RUN_TEST(test_tare_request_reads_an_idle_bin_at_once);
+    RUN_TEST(test_idle_bin_wakes_on_the_first_read_after_a_load_change);
+    RUN_TEST(test_lone_glitches_do_not_wake_an_idle_bin);
+    RUN_TEST(test_single_point_calibration_reports_failure);
+    RUN_TEST(test_activity_threshold_follows_the_scale_factor);
+    return UNITY_END();
+}
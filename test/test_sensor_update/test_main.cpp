@@ -0,0 +1,92 @@
+// SensorManager::update() on the simulated HX711 bank: it must never wait
+// for a conversion (the virtual clock only moves when delay() is called)
+// and must cost microseconds, not the ~600 ms of a blocking get_units().
+#include <unity.h>
+#include <chrono>
+#include "config.h"
+#include "config_store.h"
+#include "hal_native.h"
+#include "sensor_manager.h"
+
+static const uint32_t STEP_US = 1000;
+static const double MAX_MEAN_UPDATE_NS = 50000.0;  // Host time; ~0.2-0.6 us in practice
+static const double MAX_UPDATE_NS = 5000000.0;     // One slow call (logging) is allowed
+
+struct Rig {
+    VirtualClock clock;
+    MemoryKeyValueStore store;
+    ConfigStore config;
+    SimulatedLoadCellBank bank;
+    SensorManager manager;
+
+    explicit Rig(int bins) : config(store), bank(clock, bins, 7), manager(bank, clock, config) {
+        config.load();
+        float scaleFactors[] = HX711_DEFAULT_SCALE_FACTORS;
+        int scaleCount = sizeof(scaleFactors) / sizeof(scaleFactors[0]);
+        for (int i = 0; i < bins; i++) {
+            bank.cell(i).countsPerKg = i < scaleCount ? scaleFactors[i] : HX711_DEFAULT_SCALE_FACTOR;
+            bank.cell(i).noiseCounts = 50.0f;
+        }
+        manager.init();
+        for (int i = 0; i < bins; i++) {
+            bank.setLoad(i, 2.0f + i);
+        }
+    }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_update_never_waits_for_a_conversion() {
+    Rig rig(MAX_BINS);
+    for (int i = 0; i < 10000; i++) {
+        rig.clock.advanceMicros(STEP_US);
+        uint64_t before = rig.clock.nowMicros();
+        rig.manager.update();
+        TEST_ASSERT_EQUAL_UINT64(before, rig.clock.nowMicros());
+    }
+
+    // ...and still publishes every bin
+    SensorReading* readings = rig.manager.getAllReadings();
+    for (int i = 0; i < MAX_BINS; i++) {
+        TEST_ASSERT_TRUE(readings[i].valid);
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, 2.0f + i, readings[i].weight);
+    }
+}
+
+static void check_update_cost(int bins) {
+    Rig rig(bins);
+    double totalNs = 0.0;
+    double maxNs = 0.0;
+    const int updates = 20000;
+    for (int i = 0; i < updates; i++) {
+        rig.clock.advanceMicros(STEP_US);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        rig.manager.update();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        totalNs += ns;
+        if (ns > maxNs) maxNs = ns;
+    }
+
+    char message[96];
+    snprintf(message, sizeof(message), "%d bins: update() %.0f ns mean, %.0f ns max", bins, totalNs / updates, maxNs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(MAX_MEAN_UPDATE_NS, totalNs / updates);
+    TEST_ASSERT_LESS_THAN(MAX_UPDATE_NS, maxNs);
+}
+
+static void test_update_costs_microseconds() {
+    check_update_cost(MAX_BINS);
+}
+
+static void test_update_costs_microseconds_with_full_registry() {
+    check_update_cost(SENSOR_MAX_CHANNELS);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_update_never_waits_for_a_conversion);
+    RUN_TEST(test_update_costs_microseconds);
+    RUN_TEST(test_update_costs_microseconds_with_full_registry);
+    return UNITY_END();
+}
@@ -0,0 +1,362 @@
+// Host benchmark of the compressed reading encoding used by the reading log
+// (see reading_codec.h). Builds streams of readings the way the device logs
+// them and reports, per stream, the bytes per reading of:
+//
+//   struct   the in-RAM SensorReading (16 bytes on the ESP32)
+//   record   the fixed 10-byte flash record used before compression
+//   xor      delta-of-delta timestamps with Gorilla-style XOR of the float
+//            weight bits (size only, for comparison)
+//   codec    ReadingEncoder: delta-of-delta timestamps, fixed-point weight
+//            deltas; also with the reading log's 12-byte batch headers
+//
+// plus encode and decode time per reading and the largest weight error of
+// the codec. Streams are cut into blocks the way ReadingLog cuts them
+// (MAX_BUFFERED_READINGS or READING_LOG_BLOCK_BYTES, whichever is first).
+//
+//   synthetic          every bin's noisy weight once per SENSOR_READ_INTERVAL
+//   synthetic-settled  the same through StabilityTracker (UPLOAD_SETTLED_ONLY)
+//   trace              every published reading of a recorded raw trace
+//
+// Build:  g++ -std=c++11 -O2 -Iinclude tools/codec_bench/codec_bench.cpp src/reading_codec.cpp src/synthetic_scenario.cpp src/stability_tracker.cpp src/sample_processor.cpp -o codec_bench
+// Usage:  codec_bench [--bins 1..32] [--seconds N] [--seed N] [--trace PATH] [--repeat N]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "config.h"
+#include "reading_codec.h"
+#include "sample_processor.h"
+#include "sample_trace.h"
+#include "stability_tracker.h"
+#include "synthetic_scenario.h"
+
+#define BATCH_HEADER_BYTES 12
+#define DEVICE_READING_BYTES 16     // sizeof(SensorReading) with a 32-bit unsigned long
+
+typedef std::vector<SensorReading> ReadingStream;
+
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void makeSynthetic(uint32_t bins, uint32_t seconds, uint64_t seed, ReadingStream& noisy, ReadingStream& settled) {
+    SyntheticScenario scenario;
+    scenario.begin(bins, seed, 0);
+    std::vector<StabilityTracker> trackers(bins);
+    uint32_t rng = (uint32_t)seed | 1;
+
+    for (uint32_t nowMs = SENSOR_READ_INTERVAL; nowMs <= seconds * 1000; nowMs += SENSOR_READ_INTERVAL) {
+        scenario.step(nowMs);
+        for (uint32_t b = 0; b < bins; b++) {
+            // Readings reach the main loop a few ms apart
+            SensorReading reading;
+            reading.bin_id = b;
+            reading.weight = scenario.weight(b);
+            reading.timestamp = nowMs + nextRandom(rng) % 40;
+            reading.valid = true;
+            noisy.push_back(reading);
+
+            trackers[b].addReading(reading.weight, reading.timestamp);
+            uint32_t settledMs;
+            if (trackers[b].getLastSettled(reading.weight, &settledMs)) {
+                reading.timestamp = settledMs;
+                settled.push_back(reading);
+            }
+        }
+    }
+    scenario.end();
+}
+
+static bool makeFromTrace(const char* path, ReadingStream& stream) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    std::vector<uint8_t> trace;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        trace.insert(trace.end(), chunk, chunk + n);
+    }
+    fclose(f);
+
+    SampleTraceHeader header;
+    size_t headerSize = trace.size() >= 6 ? traceHeaderSize((uint16_t)(trace[4] | (trace[5] << 8))) : 0;
+    if (headerSize <= 12 || trace.size() < headerSize || memcmp(trace.data(), SAMPLE_TRACE_MAGIC, 4) != 0 ||
+        !decodeTraceHeader(trace.data(), header)) {
+        return false;
+    }
+
+    SampleProcessor processors[SAMPLE_TRACE_MAX_BINS];
+    size_t recordCount = (trace.size() - headerSize) / SAMPLE_TRACE_RECORD_SIZE;
+    for (size_t i = 0; i < recordCount; i++) {
+        SampleTraceRecord record;
+        decodeTraceRecord(trace.data() + headerSize + i * SAMPLE_TRACE_RECORD_SIZE, record);
+        int32_t filtered;
+        if (record.binId >= header.binCount || !processors[record.binId].addConversion(record.raw, filtered)) {
+            continue;
+        }
+        SensorReading reading;
+        reading.bin_id = record.binId;
+        reading.weight = SampleProcessor::toWeight(filtered, header.offsets[record.binId], header.scales[record.binId]);
+        reading.timestamp = record.timestampMs;
+        reading.valid = SampleProcessor::isValidWeight(reading.weight);
+        if (reading.valid) {
+            stream.push_back(reading);
+        }
+    }
+    return true;
+}
+
+// Gorilla-style float compression of the weight, with the bin, valid and
+// timestamp fields coded as in ReadingEncoder. Only the size is of interest
+class XorEncoder {
+public:
+    XorEncoder(uint8_t* buffer, size_t capacity) : bits(buffer, capacity) {
+        reset();
+    }
+
+    void reset() {
+        bits.reset();
+        count = 0;
+        lastBin = -1;
+        for (int b = 0; b < SENSOR_MAX_CHANNELS; b++) {
+            seen[b] = false;
+        }
+    }
+
+    bool add(const SensorReading& reading) {
+        if (bits.getRemainingBits() < 6 + 1 + 36 + 2 + 5 + 5 + 32) {
+            return false;
+        }
+        int bin = reading.bin_id;
+        uint32_t timestamp = (uint32_t)reading.timestamp;
+        uint32_t value;
+        memcpy(&value, &reading.weight, sizeof(value));
+
+        if (bin == lastBin + 1) {
+            bits.write(0, 1);
+        } else {
+            bits.write(1, 1);
+            bits.write(bin, 5);
+        }
+        bits.write(reading.valid ? 1 : 0, 1);
+
+        if (!seen[bin]) {
+            bits.write(timestamp, 32);
+            bits.write(value, 32);
+            seen[bin] = true;
+            prevDelta[bin] = 0;
+            leading[bin] = -1;
+        } else {
+            int32_t delta = (int32_t)(timestamp - prevTimestamp[bin]);
+            int32_t dod = (int32_t)((uint32_t)delta - (uint32_t)prevDelta[bin]);
+            uint32_t z = ((uint32_t)dod << 1) ^ (uint32_t)(dod >> 31);
+            if (z == 0) bits.write(0, 1);
+            else if (z < 128) { bits.write(2, 2); bits.write(z, 7); }
+            else if (z < 512) { bits.write(6, 3); bits.write(z, 9); }
+            else if (z < 4096) { bits.write(14, 4); bits.write(z, 12); }
+            else { bits.write(15, 4); bits.write(z, 32); }
+            prevDelta[bin] = delta;
+
+            uint32_t x = value ^ previous[bin];
+            if (x == 0) {
+                bits.write(0, 1);
+            } else {
+                int lead = __builtin_clz(x);
+                int trail = __builtin_ctz(x);
+                if (lead > 31) lead = 31;
+                if (leading[bin] >= 0 && leading[bin] <= lead && trailing[bin] <= trail) {
+                    // Meaningful bits fit the previous window
+                    bits.write(2, 2);
+                    bits.write(x >> trailing[bin], 32 - leading[bin] - trailing[bin]);
+                } else {
+                    int length = 32 - lead - trail;
+                    bits.write(3, 2);
+                    bits.write(lead, 5);
+                    bits.write(length - 1, 5);
+                    bits.write(x >> trail, length);
+                    leading[bin] = lead;
+                    trailing[bin] = trail;
+                }
+            }
+        }
+        prevTimestamp[bin] = timestamp;
+        previous[bin] = value;
+        lastBin = bin;
+        count++;
+        return true;
+    }
+
+    int getCount() const { return count; }
+    size_t getByteCount() const { return bits.getByteCount(); }
+
+private:
+    BitWriter bits;
+    int count;
+    int lastBin;
+    bool seen[SENSOR_MAX_CHANNELS];
+    uint32_t prevTimestamp[SENSOR_MAX_CHANNELS];
+    int32_t prevDelta[SENSOR_MAX_CHANNELS];
+    uint32_t previous[SENSOR_MAX_CHANNELS];
+    int leading[SENSOR_MAX_CHANNELS];
+    int trailing[SENSOR_MAX_CHANNELS];
+};
+
+struct Result {
+    size_t readings;
+    size_t blocks;
+    size_t codecBytes;
+    size_t xorBytes;
+    double maxErrorKg;
+    double encodeNs;
+    double decodeNs;
+};
+
+static void encodeBlocks(const ReadingStream& stream, std::vector<std::vector<uint8_t> >& blocks, std::vector<int>& counts) {
+    uint8_t buffer[READING_LOG_BLOCK_BYTES];
+    ReadingEncoder encoder(buffer, sizeof(buffer));
+    blocks.clear();
+    counts.clear();
+    for (size_t i = 0; i <= stream.size(); i++) {
+        bool last = i == stream.size();
+        if (last || encoder.getCount() == MAX_BUFFERED_READINGS || !encoder.add(stream[i])) {
+            if (encoder.getCount() > 0) {
+                blocks.push_back(std::vector<uint8_t>(buffer, buffer + encoder.getByteCount()));
+                counts.push_back(encoder.getCount());
+            }
+            encoder.reset();
+            if (!last && !encoder.add(stream[i])) {
+                continue;
+            }
+        }
+    }
+}
+
+static Result measure(const ReadingStream& stream, int repeat) {
+    Result result;
+    memset(&result, 0, sizeof(result));
+    result.readings = stream.size();
+
+    std::vector<std::vector<uint8_t> > blocks;
+    std::vector<int> counts;
+    auto started = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < repeat; pass++) {
+        encodeBlocks(stream, blocks, counts);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.encodeNs = stream.empty() ? 0.0 : seconds * 1e9 / (stream.size() * (double)repeat);
+    result.blocks = blocks.size();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        result.codecBytes += blocks[b].size();
+    }
+
+    // Decode, checking every reading against its source
+    size_t index = 0;
+    started = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < repeat; pass++) {
+        index = 0;
+        for (size_t b = 0; b < blocks.size(); b++) {
+            ReadingDecoder decoder(blocks[b].data(), blocks[b].size(), counts[b]);
+            SensorReading reading;
+            while (decoder.next(reading)) {
+                if (pass == 0) {
+                    const SensorReading& source = stream[index];
+                    double error = fabs((double)reading.weight - source.weight);
+                    if (error > result.maxErrorKg) result.maxErrorKg = error;
+                    if (reading.bin_id != source.bin_id || (uint32_t)reading.timestamp != (uint32_t)source.timestamp ||
+                        reading.valid != source.valid) {
+                        fprintf(stderr, "Mismatch at reading %zu\n", index);
+                        exit(1);
+                    }
+                }
+                index++;
+            }
+        }
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.decodeNs = stream.empty() ? 0.0 : seconds * 1e9 / (stream.size() * (double)repeat);
+    if (index != stream.size()) {
+        fprintf(stderr, "Decoded %zu of %zu readings\n", index, stream.size());
+        exit(1);
+    }
+
+    // XOR variant, cut into blocks of the same size
+    uint8_t buffer[READING_LOG_BLOCK_BYTES];
+    XorEncoder xorEncoder(buffer, sizeof(buffer));
+    for (size_t i = 0; i <= stream.size(); i++) {
+        bool last = i == stream.size();
+        if (last || xorEncoder.getCount() == MAX_BUFFERED_READINGS || !xorEncoder.add(stream[i])) {
+            result.xorBytes += xorEncoder.getByteCount();
+            xorEncoder.reset();
+            if (!last) xorEncoder.add(stream[i]);
+        }
+    }
+    return result;
+}
+
+static void report(const char* name, const Result& r) {
+    if (r.readings == 0) {
+        printf("%-18s no readings\n", name);
+        return;
+    }
+    double n = (double)r.readings;
+    printf("%-18s %8zu %7.2f %7.2f %7.2f %7.2f %9.2f %8.1f %8.1f %9.4f\n", name, r.readings,
+           (double)DEVICE_READING_BYTES, 10.0 + BATCH_HEADER_BYTES * (double)r.blocks / n,
+           r.xorBytes / n, r.codecBytes / n, (r.codecBytes + BATCH_HEADER_BYTES * r.blocks) / n,
+           r.encodeNs, r.decodeNs, r.maxErrorKg);
+}
+
+int main(int argc, char** argv) {
+    uint32_t bins = 4;
+    uint32_t seconds = 86400;
+    uint64_t seed = SYNTHETIC_SEED;
+    const char* tracePath = nullptr;
+    int repeat = 5;
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--bins") == 0) bins = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--seconds") == 0) seconds = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--seed") == 0) seed = strtoull(value, nullptr, 10);
+        else if (strcmp(argv[i], "--trace") == 0) tracePath = value;
+        else if (strcmp(argv[i], "--repeat") == 0) repeat = atoi(value);
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        i++;
+    }
+    if (bins < 1 || bins > SENSOR_MAX_CHANNELS || repeat < 1) {
+        fprintf(stderr, "--bins must be 1..%d and --repeat at least 1\n", SENSOR_MAX_CHANNELS);
+        return 1;
+    }
+
+    ReadingStream noisy;
+    ReadingStream settled;
+    makeSynthetic(bins, seconds, seed, noisy, settled);
+
+    printf("%-18s %8s %7s %7s %7s %7s %9s %8s %8s %9s\n", "stream", "readings", "struct", "record",
+           "xor", "codec", "codec+hdr", "enc ns", "dec ns", "max err");
+    report("synthetic", measure(noisy, repeat));
+    report("synthetic-settled", measure(settled, repeat));
+
+    if (tracePath) {
+        ReadingStream traced;
+        if (!makeFromTrace(tracePath, traced)) {
+            fprintf(stderr, "Cannot read trace %s\n", tracePath);
+            return 1;
+        }
+        report("trace", measure(traced, repeat));
+    }
+    printf("(bytes per reading; record includes batch headers; max err in kg)\n");
+    return 0;
+}
@@ -0,0 +1,281 @@
+// Host benchmark of the raw-count filter stages. Feeds a synthetic HX711
+// signal (noise, load steps and in-range bit-slip spikes) through each stage
+// and reports the cost per sample, plus how many spikes the Hampel stage
+// caught and how many clean samples it replaced. Most of the latter are the
+// first half window after each load step, which the stage holds back.
+//
+// The float path the integer chain replaced (block average of
+// HX711_SAMPLES_PER_READING conversions, conversion to kg, then a float
+// moving average) runs against the integer chain with the same
+// conversion, on a spike-free copy of the signal. Both report the cost per
+// conversion and the RMS error of their published readings, skipping the
+// settling time after each load step.
+//
+// Build:  g++ -std=c++11 -O2 -Iinclude tools/filter_bench/filter_bench.cpp src/sample_processor.cpp -o filter_bench
+// Usage:  filter_bench [--samples N] [--seed N] [--noise COUNTS] [--spike-rate RATE]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "config.h"
+#include "filter_pipeline.h"
+#include "sample_processor.h"
+
+struct Signal {
+    std::vector<int32_t> raw;
+    std::vector<bool> spike;
+    std::vector<int32_t> level;     // Noise-free value
+};
+
+#define BENCH_SCALE 140400.0f           // Counts per kg
+#define BENCH_SETTLE_SAMPLES 60         // Skipped after a step for the error figure
+#define FLOAT_SMOOTHING_SAMPLES 3       // WEIGHT_SMOOTHING_SAMPLES of the float path
+
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static Signal makeSignal(size_t samples, uint32_t seed, int32_t noise, double spikeRate) {
+    Signal signal;
+    signal.raw.resize(samples);
+    signal.spike.resize(samples);
+    signal.level.resize(samples);
+
+    uint32_t state = seed ? seed : 1;
+    int32_t level = 8000;
+    for (size_t i = 0; i < samples; i++) {
+        // A load step every 600 conversions (one minute at 10 SPS)
+        if (i % 600 == 599) {
+            level += (int32_t)(nextRandom(state) % 200000) - 100000;
+        }
+
+        // Triangular noise of +/- noise counts
+        int32_t n = (int32_t)(nextRandom(state) % (noise + 1)) - (int32_t)(nextRandom(state) % (noise + 1));
+        int32_t value = level + n;
+
+        // A bit slip flips one of bits 12..20: large, but still a valid count
+        bool spike = (nextRandom(state) % 1000000) < spikeRate * 1000000;
+        if (spike) {
+            value ^= 1 << (12 + nextRandom(state) % 9);
+        }
+        signal.raw[i] = value;
+        signal.spike[i] = spike;
+        signal.level[i] = level;
+    }
+    return signal;
+}
+
+// Reference: copy and sort the window for every sample, O(N log N)
+template <int N>
+class SortingHampel {
+public:
+    SortingHampel() : count(0), pos(0), rejected(false) {}
+
+    int32_t process(int32_t sample) {
+        window[pos] = sample;
+        pos = (pos + 1) % N;
+        if (count < N) count++;
+
+        rejected = false;
+        if (count < N) return sample;
+
+        int32_t sorted[N];
+        memcpy(sorted, window, sizeof(sorted));
+        std::sort(sorted, sorted + N);
+        int32_t median = sorted[N / 2];
+        for (int i = 0; i < N; i++) sorted[i] = abs(sorted[i] - median);
+        std::sort(sorted, sorted + N);
+        int32_t mad = std::max(sorted[N / 2], (int32_t)FILTER_HAMPEL_MIN_MAD);
+
+        int64_t deviation = llabs((int64_t)sample - median);
+        if (deviation * 100000 > (int64_t)FILTER_HAMPEL_K10 * 14826 * mad) {
+            rejected = true;
+            return median;
+        }
+        return sample;
+    }
+
+    bool lastRejected() const { return rejected; }
+
+private:
+    int32_t window[N];
+    int count;
+    int pos;
+    bool rejected;
+};
+
+template <typename Stage>
+static void benchStage(const char* name, const Signal& signal) {
+    Stage stage;
+    size_t caught = 0;
+    size_t falseRejects = 0;
+    size_t spikes = 0;
+    int64_t sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < signal.raw.size(); i++) {
+        sink += stage.process(signal.raw[i]);
+        if (signal.spike[i]) spikes++;
+        if (stage.lastRejected()) {
+            if (signal.spike[i]) caught++;
+            else falseRejects++;
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%-24s %7.1f ns/sample  spikes %zu, caught %zu, clean replaced %zu  (%lld)\n",
+           name, ns / signal.raw.size(), spikes, caught, falseRejects, (long long)(sink & 0xFF));
+}
+
+template <typename Stage>
+static void benchFilter(const char* name, const Signal& signal) {
+    Stage stage;
+    int64_t sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < signal.raw.size(); i++) {
+        sink += stage.process(signal.raw[i]);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%-24s %7.1f ns/sample  (%lld)\n", name, ns / signal.raw.size(), (long long)(sink & 0xFF));
+}
+
+// The float path before the integer chain: HX711_SAMPLES_PER_READING
+// conversions averaged, converted to kg, smoothed as
+// (last * (n - 1) + new) / n. Its state started at 0 kg
+class FloatSmoothing {
+public:
+    FloatSmoothing() : sum(0), count(0), last(0.0f) {}
+
+    bool process(int32_t raw, float& weight) {
+        sum += raw;
+        if (++count < HX711_SAMPLES_PER_READING) return false;
+        float rawWeight = (float)(sum / count) / BENCH_SCALE;
+        sum = 0;
+        count = 0;
+        last = (last * (FLOAT_SMOOTHING_SAMPLES - 1) + rawWeight) / FLOAT_SMOOTHING_SAMPLES;
+        weight = last;
+        return true;
+    }
+
+private:
+    int64_t sum;
+    int count;
+    float last;
+};
+
+// The integer chain as it replaced it: SensorFilter on every conversion,
+// the kg conversion once per reading
+class IntegerChain {
+public:
+    IntegerChain() : count(0) {}
+
+    bool process(int32_t raw, float& weight) {
+        int32_t filtered = filter.process(raw);
+        if (++count < HX711_SAMPLES_PER_READING) return false;
+        count = 0;
+        weight = SampleProcessor::toWeight(filtered, 0, BENCH_SCALE);
+        return true;
+    }
+
+private:
+    SensorFilter filter;
+    int count;
+};
+
+template <typename Path>
+static void benchPath(const char* name, const Signal& signal) {
+    Path path;
+    double sink = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < signal.raw.size(); i++) {
+        float weight;
+        if (path.process(signal.raw[i], weight)) sink += weight;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    // Accuracy in a separate pass, so it does not weigh on the timing
+    Path check;
+    double squares = 0.0;
+    size_t readings = 0;
+    size_t sinceStep = 0;
+    for (size_t i = 0; i < signal.raw.size(); i++) {
+        sinceStep = i > 0 && signal.level[i] != signal.level[i - 1] ? 0 : sinceStep + 1;
+        float weight;
+        if (check.process(signal.raw[i], weight) && sinceStep >= BENCH_SETTLE_SAMPLES) {
+            double error = weight - signal.level[i] / BENCH_SCALE;
+            squares += error * error;
+            readings++;
+        }
+    }
+
+    printf("%-24s %7.1f ns/sample  rms error %.2f g over %zu readings  (%lld)\n", name,
+           ns / signal.raw.size(), readings ? sqrt(squares / readings) * 1000.0 : 0.0, readings,
+           (long long)sink & 0xFF);
+}
+
+static void benchProcessor(const Signal& signal) {
+    SampleProcessor processor;
+    int64_t sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < signal.raw.size(); i++) {
+        int32_t filtered;
+        if (processor.addConversion(signal.raw[i], filtered)) sink += filtered;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%-24s %7.1f ns/sample  (%lld)\n", "SampleProcessor", ns / signal.raw.size(), (long long)(sink & 0xFF));
+}
+
+int main(int argc, char** argv) {
+    size_t samples = 2000000;
+    uint32_t seed = 1;
+    int32_t noise = 40;
+    double spikeRate = 0.001;
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--samples") == 0) samples = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--seed") == 0) seed = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--noise") == 0) noise = atoi(value);
+        else if (strcmp(argv[i], "--spike-rate") == 0) spikeRate = atof(value);
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        i++;
+    }
+    if (samples == 0 || noise < 0) {
+        fprintf(stderr, "--samples must be non-zero and --noise non-negative\n");
+        return 1;
+    }
+
+    Signal signal = makeSignal(samples, seed, noise, spikeRate);
+    printf("%zu samples, noise +/-%d counts, spike rate %g\n\n", samples, noise, spikeRate);
+
+    benchStage<HampelStage<7, FILTER_HAMPEL_K10, FILTER_HAMPEL_MIN_MAD> >("HampelStage<7>", signal);
+    benchStage<OutlierStage>("HampelStage (config)", signal);
+    benchStage<HampelStage<31, FILTER_HAMPEL_K10, FILTER_HAMPEL_MIN_MAD> >("HampelStage<31>", signal);
+    benchStage<SortingHampel<FILTER_HAMPEL_WINDOW> >("sorting Hampel (config)", signal);
+    benchFilter<SensorFilter>("SensorFilter", signal);
+    benchProcessor(signal);
+
+    Signal clean = makeSignal(samples, seed, noise, 0.0);
+    printf("\nFloat path against the integer chain (no spikes):\n");
+    benchPath<FloatSmoothing>("float smoothing (old)", clean);
+    benchPath<IntegerChain>("SensorFilter + toWeight", clean);
+    return 0;
+}
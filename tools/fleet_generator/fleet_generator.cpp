@@ -0,0 +1,110 @@
+// Host generator of synthetic fleet traffic for load-testing the ingestion
+// backend. Drives the firmware's SyntheticScenario for any number of bins,
+// grouped into devices of MAX_BINS, and writes one sensor-data payload per
+// device and interval (the same JSON the device posts), or CSV rows.
+// A timing summary goes to stderr.
+//
+// Build:  g++ -std=c++11 -O3 -Iinclude tools/fleet_generator/fleet_generator.cpp src/synthetic_scenario.cpp -o fleet_generator
+// Usage:  fleet_generator [--bins N] [--seconds N] [--interval-ms N] [--seed N]
+//                         [--format json|csv|none]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "config.h"
+#include "synthetic_scenario.h"
+
+enum OutputFormat { FORMAT_JSON, FORMAT_CSV, FORMAT_NONE };
+
+int main(int argc, char** argv) {
+    uint32_t bins = 6000;
+    uint32_t seconds = 300;
+    uint32_t intervalMs = SENSOR_READ_INTERVAL;
+    uint64_t seed = SYNTHETIC_SEED;
+    OutputFormat format = FORMAT_JSON;
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 2;
+        }
+
+        if (strcmp(argv[i], "--bins") == 0) bins = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--seconds") == 0) seconds = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--interval-ms") == 0) intervalMs = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--seed") == 0) seed = strtoull(value, nullptr, 10);
+        else if (strcmp(argv[i], "--format") == 0) {
+            if (strcmp(value, "json") == 0) format = FORMAT_JSON;
+            else if (strcmp(value, "csv") == 0) format = FORMAT_CSV;
+            else if (strcmp(value, "none") == 0) format = FORMAT_NONE;
+            else {
+                fprintf(stderr, "Unknown format: %s\n", value);
+                return 2;
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+        i++;
+    }
+
+    if (bins == 0 || intervalMs == 0) {
+        fprintf(stderr, "--bins and --interval-ms must be non-zero\n");
+        return 2;
+    }
+
+    SyntheticScenario scenario;
+    if (!scenario.begin(bins, seed, 0)) {
+        fprintf(stderr, "Cannot allocate %u bins\n", bins);
+        return 1;
+    }
+
+    if (format == FORMAT_CSV) {
+        printf("timestamp_ms,device_id,bin_id,weight_kg,profile\n");
+    }
+
+    uint32_t steps = seconds * 1000 / intervalMs;
+    double stepSeconds = 0.0;
+    auto started = std::chrono::steady_clock::now();
+
+    for (uint32_t s = 1; s <= steps; s++) {
+        uint32_t nowMs = s * intervalMs;
+
+        auto stepStart = std::chrono::steady_clock::now();
+        scenario.step(nowMs);
+        stepSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStart).count();
+
+        if (format == FORMAT_NONE) continue;
+
+        const float* weights = scenario.weights();
+        for (uint32_t first = 0; first < bins; first += MAX_BINS) {
+            uint32_t device = first / MAX_BINS;
+            uint32_t last = first + MAX_BINS < bins ? first + MAX_BINS : bins;
+
+            if (format == FORMAT_CSV) {
+                for (uint32_t b = first; b < last; b++) {
+                    printf("%u,SIM-%06u,%u,%.3f,%d\n", nowMs, device, b - first, weights[b], (int)scenario.profile(b));
+                }
+                continue;
+            }
+
+            printf("{\"sensor_data\":[");
+            for (uint32_t b = first; b < last; b++) {
+                printf("%s{\"bin_id\":%u,\"weight\":%.3f,\"timestamp\":%u,\"unit\":\"kg\"}",
+                       b == first ? "" : ",", b - first, weights[b], nowMs);
+            }
+            printf("],\"device_id\":\"SIM-%06u\",\"timestamp\":%u}\n", device, nowMs);
+        }
+    }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    double binSteps = (double)bins * steps;
+
+    fprintf(stderr, "bins: %u (%u devices), steps: %u, events: %u\n",
+            bins, (bins + MAX_BINS - 1) / MAX_BINS, steps, scenario.getEventCount());
+    fprintf(stderr, "generation: %.3f ms, %.2f ns/bin-step; total with output: %.3f s\n",
+            stepSeconds * 1000.0, binSteps > 0 ? stepSeconds * 1e9 / binSteps : 0.0, wallSeconds);
+    return 0;
+}
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+# Local stand-in for the Smart Bins API, for checking the device's HTTPS
+# connection reuse and request compression. Answers /health and every POST
+# with 200 over HTTP/1.1 keep-alive and logs, per TLS connection, the
+# handshake, whether the TLS session was resumed and how many requests it
+# carried. A body sent with "Content-Encoding: gzip" is decompressed, and a
+# JSON body must parse; the sizes before and after are logged, and a body
+# that fails either check gets 400.
+#
+# Certificate (the device does not verify it):
+#   openssl req -x509 -newkey rsa:2048 -nodes -days 365 -subj /CN=smartbin-stub -keyout stub.key -out stub.pem
+# Usage:
+#   python3 tools/https_stub/https_stub.py [--port 8443] [--cert stub.pem] [--key stub.key]
+#       [--close-after N] [--idle-timeout S] [--refuse-gzip]
+# then send {"command": "set_api", "api_url": "https://<host ip>:8443", ...}
+# over Bluetooth. --close-after N answers the Nth request on a connection
+# with "Connection: close", and --idle-timeout drops idle connections, to
+# exercise the device's reconnect path. --refuse-gzip answers compressed
+# bodies with 415, to exercise the fallback to uncompressed requests.
+
+import argparse
+import gzip
+import http.server
+import json
+import ssl
+import sys
+import threading
+import time
+
+stats_lock = threading.Lock()
+stats = {"connections": 0, "resumed": 0, "requests": 0, "gzipped": 0, "wire_bytes": 0, "body_bytes": 0}
+
+
+def make_handler(options):
+    class StubHandler(http.server.BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+        timeout = options.idle_timeout
+
+        def setup(self):
+            super().setup()
+            self.requests_on_connection = 0
+            started = time.monotonic()
+            self.connection.do_handshake()
+            resumed = self.connection.session_reused
+            with stats_lock:
+                stats["connections"] += 1
+                stats["resumed"] += 1 if resumed else 0
+            self.log_message("TLS connection %d: handshake %.1f ms, %s, %s",
+                             stats["connections"], (time.monotonic() - started) * 1000,
+                             self.connection.version(), "resumed" if resumed else "full")
+
+        def finish(self):
+            super().finish()
+            self.log_message("connection closed after %d requests", self.requests_on_connection)
+
+        def respond(self, body, status=200):
+            self.requests_on_connection += 1
+            with stats_lock:
+                stats["requests"] += 1
+                total = dict(stats)
+            close = options.close_after and self.requests_on_connection >= options.close_after
+            data = body.encode()
+            self.send_response(status)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(data)))
+            self.send_header("Connection", "close" if close else "keep-alive")
+            self.end_headers()
+            self.wfile.write(data)
+            if close:
+                self.close_connection = True
+            self.log_message("%s %s (request %d on this connection; %d requests over %d connections)",
+                             self.command, self.path, self.requests_on_connection,
+                             total["requests"], total["connections"])
+
+        def do_GET(self):
+            self.respond('{"status": "ok"}')
+
+        def do_POST(self):
+            length = int(self.headers.get("Content-Length", 0))
+            body = self.rfile.read(length)
+            encoding = self.headers.get("Content-Encoding", "identity")
+            if encoding == "gzip" and options.refuse_gzip:
+                self.respond('{"error": "Content-Encoding gzip not supported"}', 415)
+                return
+            if encoding == "gzip":
+                try:
+                    data = gzip.decompress(body)
+                except (OSError, EOFError) as error:
+                    self.log_message("bad gzip body: %s", error)
+                    self.respond('{"error": "bad gzip body"}', 400)
+                    return
+            elif encoding == "identity":
+                data = body
+            else:
+                self.respond('{"error": "unsupported Content-Encoding"}', 415)
+                return
+
+            content_type = self.headers.get("Content-Type", "")
+            if content_type.startswith("application/json"):
+                try:
+                    json.loads(data)
+                except ValueError as error:
+                    self.log_message("bad JSON body: %s", error)
+                    self.respond('{"error": "bad JSON body"}', 400)
+                    return
+            with stats_lock:
+                stats["gzipped"] += 1 if encoding == "gzip" else 0
+                stats["wire_bytes"] += len(body)
+                stats["body_bytes"] += len(data)
+            self.log_message("%s body, %s: %d bytes on the wire, %d bytes decoded",
+                             content_type, encoding, len(body), len(data))
+            self.respond('{"success": true}')
+
+    return StubHandler
+
+
+def main():
+    parser = argparse.ArgumentParser(description="HTTPS keep-alive stub for the Smart Bins API")
+    parser.add_argument("--port", type=int, default=8443)
+    parser.add_argument("--cert", default="stub.pem")
+    parser.add_argument("--key", default="stub.key")
+    parser.add_argument("--close-after", type=int, default=0)
+    parser.add_argument("--idle-timeout", type=float, default=60.0)
+    parser.add_argument("--refuse-gzip", action="store_true")
+    options = parser.parse_args()
+
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(options.cert, options.key)
+
+    server = http.server.ThreadingHTTPServer(("", options.port), make_handler(options))
+    server.socket = context.wrap_socket(server.socket, server_side=True, do_handshake_on_connect=False)
+    print("Listening on https://0.0.0.0:%d" % options.port, file=sys.stderr)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print("%d requests over %d connections, %d resumed" %
+          (stats["requests"], stats["connections"], stats["resumed"]), file=sys.stderr)
+    print("%d bodies gzipped, %d bytes on the wire for %d bytes of body" %
+          (stats["gzipped"], stats["wire_bytes"], stats["body_bytes"]), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,97 @@
+// Host benchmark of the lockstep HX711 readout kernel. Times
+// HX711ParallelReader::unpackFrames (24 port snapshots -> one signed value
+// per channel) for several channel counts, and counts the GPIO port
+// operations of one lockstep read() against reading the same channels one
+// after another, as the HX711 library does.
+//
+// Build:  g++ -std=c++11 -O2 -Iinclude tools/hx711_bench/hx711_bench.cpp src/hx711_parallel_reader.cpp -o hx711_bench
+// Usage:  hx711_bench [--iterations N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "hx711_parallel_reader.h"
+
+// Every DOUT low (ready, all-zero data); counts what the reader asks of it
+class CountingPort : public GpioPort {
+public:
+    uint32_t writes = 0;
+    uint32_t reads = 0;
+    void setOutputs(uint32_t pinMask) override { writes++; }
+    void clearOutputs(uint32_t pinMask) override { writes++; }
+    uint32_t readInputs() override { reads++; return 0; }
+};
+
+static volatile long sink;     // Keeps the unpacked values live
+
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+int main(int argc, char** argv) {
+    long iterations = 2000000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--iterations N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iterations < 1) iterations = 1;
+
+    // Random snapshots; DOUT pins are whatever the channel count needs
+    uint32_t state = 1;
+    uint32_t frames[HX711_DATA_BITS];
+    for (int bit = 0; bit < HX711_DATA_BITS; bit++) {
+        frames[bit] = nextRandom(state);
+    }
+    uint8_t pins[HX711_PARALLEL_MAX_CHANNELS];
+    for (int i = 0; i < HX711_PARALLEL_MAX_CHANNELS; i++) {
+        pins[i] = (uint8_t)i;
+    }
+
+    printf("%-9s %12s %12s %14s %14s\n", "channels", "unpack ns", "ns/channel", "lockstep ops", "one-by-one ops");
+    const int channelCounts[] = { 1, 4, 6, 16, 32 };
+    for (size_t c = 0; c < sizeof(channelCounts) / sizeof(channelCounts[0]); c++) {
+        int channels = channelCounts[c];
+        uint32_t mask = channels < 32 ? (1UL << channels) - 1 : 0xFFFFFFFFUL;
+        long values[HX711_PARALLEL_MAX_CHANNELS];
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; i++) {
+            frames[i % HX711_DATA_BITS] ^= (uint32_t)i;     // Defeat hoisting
+            HX711ParallelReader::unpackFrames(frames, pins, channels, mask, values);
+            sink += values[channels - 1];
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                    iterations;
+
+        // Port operations: every channel on its own CLK/DOUT pair, gain 128
+        int clk[HX711_PARALLEL_MAX_CHANNELS];
+        int dout[HX711_PARALLEL_MAX_CHANNELS];
+        for (int i = 0; i < channels; i++) {
+            clk[i] = i;
+            dout[i] = i;
+        }
+        CountingPort lockstepPort;
+        HX711ParallelReader lockstep;
+        lockstep.begin(&lockstepPort, clk, dout, channels, 1);
+        lockstep.read(mask, values);
+
+        CountingPort singlePort;
+        HX711ParallelReader single;
+        single.begin(&singlePort, clk, dout, channels, 1);
+        for (int i = 0; i < channels; i++) {
+            single.read(1UL << i, values);
+        }
+
+        printf("%-9d %12.1f %12.2f %14u %14u\n", channels, ns, ns / channels,
+               lockstepPort.writes + lockstepPort.reads, singlePort.writes + singlePort.reads);
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# Fetches the single-header ArduinoJson release that the firmware builds
+# against, for the arduinojson baseline of payload_bench on a host without
+# a PlatformIO build. The version is the one pinned in platformio.ini
+# unless --version is given; the header lands in
+# tools/payload_bench/arduinojson/ArduinoJson.h, which git ignores.
+#
+# Usage:
+#   python3 tools/payload_bench/fetch_arduinojson.py [--version 7.4.2]
+# then build payload_bench with -Itools/payload_bench/arduinojson.
+
+import argparse
+import os
+import re
+import sys
+import urllib.request
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+URL = "https://github.com/bblanchon/ArduinoJson/releases/download/v{0}/ArduinoJson-v{0}.h"
+
+
+def pinned_version():
+    with open(os.path.join(ROOT, "platformio.ini")) as ini:
+        match = re.search(r"bblanchon/ArduinoJson@\D*([\d.]+)", ini.read())
+    return match.group(1) if match else None
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--version", default=pinned_version())
+    args = parser.parse_args()
+    if not args.version:
+        sys.exit("No ArduinoJson version in platformio.ini; pass --version")
+
+    url = URL.format(args.version)
+    try:
+        with urllib.request.urlopen(url, timeout=30) as response:
+            header = response.read()
+    except OSError as error:
+        sys.exit("Could not fetch {}: {}".format(url, error))
+    if b"ARDUINOJSON_VERSION" not in header:
+        sys.exit("{} is not an ArduinoJson header".format(url))
+
+    out_dir = os.path.join(HERE, "arduinojson")
+    os.makedirs(out_dir, exist_ok=True)
+    path = os.path.join(out_dir, "ArduinoJson.h")
+    with open(path, "wb") as out:
+        out.write(header)
+    print("ArduinoJson {} -> {}".format(args.version, os.path.relpath(path, ROOT)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,358 @@
+// Host benchmark of the sensor-data request bodies (see sensor_payload.h).
+// Builds the payloads APIClient sends and reports, per path and payload
+// kind, the payload size, encode time, payloads and bytes per second, and
+// heap allocations per payload:
+//
+//   json         writeSensorData / writeSensorFrames as JSON into a fixed
+//                buffer (the firmware path)
+//   msgpack      the same schema as MessagePack
+//   +gzip        the body then gzipped by GzipWriter, as APIClient sends
+//                bodies of API_GZIP_MIN_BYTES or more
+//   arduinojson  a JsonDocument serialized into a fresh string, as
+//                APIClient built payloads before; only when ArduinoJson 7
+//                is found, either fetched next to this file by
+//                fetch_arduinojson.py or on the include path (e.g.
+//                .pio/libdeps/esp32dev/ArduinoJson/src after a firmware build)
+//
+//   snapshot     one reading of every bin
+//   batch        UPLOAD_BATCH_FRAMES snapshots as a frames array
+//
+// Readings come from synthetic bins, or with --trace from a recorded raw
+// trace replayed through SampleProcessor: every SENSOR_READ_INTERVAL a
+// frame takes the latest reading of each bin, as the device does. With
+// several frames' worth of trace, every payload encodes the next ones.
+// --dump writes the first batch body to stdout, gzipped with --gzip.
+// Allocations are counted by wrapping malloc, so glibc is required.
+//
+// Build:  [python3 tools/payload_bench/fetch_arduinojson.py]
+//         g++ -std=gnu++17 -O2 -Iinclude tools/payload_bench/payload_bench.cpp src/sensor_payload.cpp src/json_writer.cpp src/msgpack_writer.cpp src/gzip_writer.cpp src/synthetic_scenario.cpp src/sample_processor.cpp -o payload_bench
+// Usage:  payload_bench [--bins 1..32] [--payloads N] [--seed N] [--trace PATH] [--dump json|msgpack [--gzip]]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "gzip_writer.h"
+#include "sample_processor.h"
+#include "sample_trace.h"
+#include "sensor_payload.h"
+#include "synthetic_scenario.h"
+
+#if __has_include("arduinojson/ArduinoJson.h")
+#include "arduinojson/ArduinoJson.h"
+#define HAVE_ARDUINOJSON 1
+#elif __has_include(<ArduinoJson.h>)
+#include <ArduinoJson.h>
+#define HAVE_ARDUINOJSON 1
+#else
+#define HAVE_ARDUINOJSON 0
+#endif
+
+#if HAVE_ARDUINOJSON && ARDUINOJSON_VERSION_MAJOR < 7
+#error "The arduinojson baseline needs ArduinoJson 7, as the firmware uses"
+#endif
+
+#define DEVICE_ID "smartbin_a1b2c3d4e5f6"
+#define BOOT 42
+
+// Every allocation in the process goes through these
+static unsigned long allocationCount = 0;
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    allocationCount++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocationCount++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    allocationCount++;
+    return __libc_realloc(ptr, size);
+}
+
+// Consecutive batches of UPLOAD_BATCH_FRAMES frames
+struct Workload {
+    std::vector<SensorReading> readings;
+    std::vector<SensorFrame> frames;
+    int bins;
+
+    int batchCount() const { return frames.size() / UPLOAD_BATCH_FRAMES; }
+    const SensorFrame* batch(int i) const { return &frames[(i % batchCount()) * UPLOAD_BATCH_FRAMES]; }
+};
+
+struct Result {
+    double bytes;               // Mean per payload
+    double encodeNs;            // Mean per payload
+    double payloadsPerSecond;
+    double bytesPerSecond;
+    double allocationsPerPayload;
+};
+
+static void addFrame(Workload& work, uint32_t nowMs, const SensorReading* latest) {
+    SensorFrame frame;
+    frame.timestamp = nowMs;
+    frame.first = work.readings.size();
+    frame.count = work.bins;
+    work.readings.insert(work.readings.end(), latest, latest + work.bins);
+    work.frames.push_back(frame);
+}
+
+static void makeSynthetic(int bins, uint64_t seed, Workload& work) {
+    SyntheticScenario scenario;
+    scenario.begin(bins, seed, 0);
+    work.bins = bins;
+    SensorReading latest[SENSOR_MAX_CHANNELS];
+    for (int f = 0; f < UPLOAD_BATCH_FRAMES * 64; f++) {
+        uint32_t nowMs = 3600000 + f * SENSOR_READ_INTERVAL;
+        scenario.step(nowMs);
+        for (int b = 0; b < bins; b++) {
+            latest[b].bin_id = b;
+            latest[b].weight = scenario.weight(b);
+            latest[b].timestamp = nowMs - 3 * (bins - b);
+            latest[b].valid = true;
+        }
+        addFrame(work, nowMs, latest);
+    }
+}
+
+static bool makeFromTrace(const char* path, Workload& work) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    std::vector<uint8_t> trace;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        trace.insert(trace.end(), chunk, chunk + n);
+    }
+    fclose(f);
+
+    SampleTraceHeader header;
+    size_t headerSize = trace.size() >= 6 ? traceHeaderSize((uint16_t)(trace[4] | (trace[5] << 8))) : 0;
+    if (headerSize <= 12 || trace.size() < headerSize || memcmp(trace.data(), SAMPLE_TRACE_MAGIC, 4) != 0 ||
+        !decodeTraceHeader(trace.data(), header)) {
+        return false;
+    }
+
+    SampleProcessor processors[SAMPLE_TRACE_MAX_BINS];
+    SensorReading latest[SAMPLE_TRACE_MAX_BINS];
+    for (int b = 0; b < header.binCount; b++) {
+        latest[b].bin_id = b;
+        latest[b].weight = 0.0f;
+        latest[b].timestamp = 0;
+        latest[b].valid = false;
+    }
+    work.bins = header.binCount;
+
+    size_t recordCount = (trace.size() - headerSize) / SAMPLE_TRACE_RECORD_SIZE;
+    uint32_t nextFrameMs = 0;
+    for (size_t i = 0; i < recordCount; i++) {
+        SampleTraceRecord record;
+        decodeTraceRecord(trace.data() + headerSize + i * SAMPLE_TRACE_RECORD_SIZE, record);
+        if (i == 0) nextFrameMs = record.timestampMs + SENSOR_READ_INTERVAL;
+        while (record.timestampMs >= nextFrameMs) {
+            addFrame(work, nextFrameMs, latest);
+            nextFrameMs += SENSOR_READ_INTERVAL;
+        }
+
+        int32_t filtered;
+        if (record.binId >= header.binCount || !processors[record.binId].addConversion(record.raw, filtered)) {
+            continue;
+        }
+        SensorReading& reading = latest[record.binId];
+        reading.weight = SampleProcessor::toWeight(filtered, header.offsets[record.binId], header.scales[record.binId]);
+        reading.timestamp = record.timestampMs;
+        reading.valid = SampleProcessor::isValidWeight(reading.weight);
+    }
+    return work.batchCount() > 0;
+}
+
+template <typename Build>
+static Result measure(int payloads, Build build) {
+    build(0);   // Warm-up, so one-off allocations are not counted
+    unsigned long allocationsBefore = allocationCount;
+    size_t totalBytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < payloads; i++) {
+        totalBytes += build(i);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Result result;
+    result.bytes = (double)totalBytes / payloads;
+    result.encodeNs = seconds * 1e9 / payloads;
+    result.payloadsPerSecond = payloads / seconds;
+    result.bytesPerSecond = totalBytes / seconds;
+    result.allocationsPerPayload = (double)(allocationCount - allocationsBefore) / payloads;
+    return result;
+}
+
+static void report(const char* path, const char* kind, const Result& result) {
+    printf("%-13s %-9s %8.0f %10.0f %12.0f %8.1f %14.2f\n", path, kind, result.bytes, result.encodeNs,
+           result.payloadsPerSecond, result.bytesPerSecond / 1e6, result.allocationsPerPayload);
+}
+
+#if HAVE_ARDUINOJSON
+static void addReadings(JsonArray dataArray, const SensorReading* readings, int count) {
+    for (int i = 0; i < count; i++) {
+        if (readings[i].valid) {
+            JsonObject reading = dataArray.add<JsonObject>();
+            reading["bin_id"] = readings[i].bin_id;
+            reading["weight"] = readings[i].weight;
+            reading["timestamp"] = (uint32_t)readings[i].timestamp;
+            reading["unit"] = "kg";
+        }
+    }
+}
+
+static size_t arduinoJsonSnapshot(const Workload& work, int i) {
+    JsonDocument doc;
+    JsonArray dataArray = doc["sensor_data"].to<JsonArray>();
+    doc["device_id"] = DEVICE_ID;
+    doc["boot"] = BOOT;
+    doc["timestamp"] = 3700000;
+    addReadings(dataArray, work.readings.data() + work.batch(i)->first, work.bins);
+
+    std::string payload;
+    serializeJson(doc, payload);
+    return payload.size();
+}
+
+static size_t arduinoJsonBatch(const Workload& work, int i) {
+    JsonDocument doc;
+    doc["device_id"] = DEVICE_ID;
+    doc["boot"] = BOOT;
+    doc["timestamp"] = 3700000;
+    JsonArray frameArray = doc["frames"].to<JsonArray>();
+    const SensorFrame* frames = work.batch(i);
+    for (int f = 0; f < UPLOAD_BATCH_FRAMES; f++) {
+        JsonObject frame = frameArray.add<JsonObject>();
+        frame["timestamp"] = frames[f].timestamp;
+        addReadings(frame["sensor_data"].to<JsonArray>(), work.readings.data() + frames[f].first, frames[f].count);
+    }
+
+    std::string payload;
+    serializeJson(doc, payload);
+    return payload.size();
+}
+#endif
+
+int main(int argc, char** argv) {
+    int bins = MAX_BINS;
+    int payloads = 20000;
+    uint64_t seed = SYNTHETIC_SEED;
+    const char* tracePath = nullptr;
+    const char* dump = nullptr;
+    bool gzipDump = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--gzip") == 0) {
+            gzipDump = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--bins") == 0) bins = atoi(value);
+        else if (strcmp(argv[i], "--payloads") == 0) payloads = atoi(value);
+        else if (strcmp(argv[i], "--seed") == 0) seed = strtoull(value, nullptr, 10);
+        else if (strcmp(argv[i], "--trace") == 0) tracePath = value;
+        else if (strcmp(argv[i], "--dump") == 0) dump = value;
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        i++;
+    }
+
+    Workload work;
+    if (tracePath) {
+        if (!makeFromTrace(tracePath, work)) {
+            fprintf(stderr, "Cannot read trace %s, or it is shorter than one batch\n", tracePath);
+            return 1;
+        }
+    } else {
+        makeSynthetic(bins, seed, work);
+    }
+    if (work.bins < 1 || work.bins > SENSOR_MAX_CHANNELS || payloads < 1 ||
+        work.bins * UPLOAD_BATCH_FRAMES > UPLOAD_BATCH_MAX_READINGS) {
+        fprintf(stderr, "--bins must be 1..%d (and fit a batch) and --payloads at least 1\n", SENSOR_MAX_CHANNELS);
+        return 1;
+    }
+
+    static uint8_t buffer[API_PAYLOAD_BUFFER_BYTES];
+    static uint8_t compressed[API_GZIP_BUFFER_BYTES];
+    static GzipWriter gzip;
+    const SensorReading* readings = work.readings.data();
+
+    // Size of the gzipped body, or 0 when it would not be sent compressed
+    auto compress = [&](size_t length) -> size_t {
+        gzip.begin(compressed, sizeof(compressed));
+        gzip.write(buffer, length);
+        gzip.finish();
+        return gzip.overflowed() || gzip.length() >= length ? 0 : gzip.length();
+    };
+
+    if (dump) {
+        PayloadFormat format = strcmp(dump, "msgpack") == 0 ? PAYLOAD_MSGPACK : PAYLOAD_JSON;
+        size_t length = writeSensorFrames(format, buffer, sizeof(buffer), DEVICE_ID, BOOT, 3700000, work.batch(0),
+                                          UPLOAD_BATCH_FRAMES, readings);
+        if (gzipDump) {
+            size_t compressedLength = compress(length);
+            if (compressedLength == 0) {
+                fprintf(stderr, "Body does not shrink into API_GZIP_BUFFER_BYTES\n");
+                return 1;
+            }
+            fwrite(compressed, 1, compressedLength, stdout);
+        } else {
+            fwrite(buffer, 1, length, stdout);
+        }
+        return 0;
+    }
+
+    printf("%s: %d bins, %d batches of %d frames, %d payloads per run\n\n", tracePath ? tracePath : "synthetic",
+           work.bins, work.batchCount(), UPLOAD_BATCH_FRAMES, payloads);
+    printf("%-13s %-9s %8s %10s %12s %8s %14s\n", "path", "payload", "bytes", "encode ns", "payloads/s", "MB/s",
+           "allocs/payload");
+
+    const PayloadFormat formats[] = { PAYLOAD_JSON, PAYLOAD_MSGPACK };
+    const char* names[] = { "json", "msgpack" };
+    const char* gzipNames[] = { "json+gzip", "msgpack+gzip" };
+    for (int f = 0; f < 2; f++) {
+        PayloadFormat format = formats[f];
+        report(names[f], "snapshot", measure(payloads, [&](int i) {
+            return writeSensorData(format, buffer, sizeof(buffer), DEVICE_ID, BOOT, 3700000,
+                                   readings + work.batch(i)->first, work.bins);
+        }));
+        report(names[f], "batch", measure(payloads, [&](int i) {
+            return writeSensorFrames(format, buffer, sizeof(buffer), DEVICE_ID, BOOT, 3700000, work.batch(i),
+                                     UPLOAD_BATCH_FRAMES, readings);
+        }));
+        report(gzipNames[f], "batch", measure(payloads, [&](int i) {
+            size_t length = writeSensorFrames(format, buffer, sizeof(buffer), DEVICE_ID, BOOT, 3700000, work.batch(i),
+                                              UPLOAD_BATCH_FRAMES, readings);
+            size_t compressedLength = compress(length);
+            return compressedLength ? compressedLength : length;
+        }));
+    }
+
+#if HAVE_ARDUINOJSON
+    printf("(arduinojson: ArduinoJson %s)\n", ARDUINOJSON_VERSION);
+    report("arduinojson", "snapshot", measure(payloads, [&](int i) { return arduinoJsonSnapshot(work, i); }));
+    report("arduinojson", "batch", measure(payloads, [&](int i) { return arduinoJsonBatch(work, i); }));
+#else
+    printf("(ArduinoJson not found, baseline skipped; see tools/payload_bench/fetch_arduinojson.py)\n");
+#endif
+    return 0;
+}
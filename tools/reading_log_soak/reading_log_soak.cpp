@@ -0,0 +1,261 @@
+// Power-cut soak test of the store-and-forward reading log on a file-backed
+// flash image. Each cycle mounts the log (a reboot), runs random appends,
+// flushes and drains, and cuts power after a random number of flash bytes,
+// possibly in the middle of a write or an erase. Every reading carries a
+// unique id in its timestamp, and delivery is checked against a model:
+//
+//   - readings come out in append order, with no gaps in what was durable
+//     (flush() returned with the reading on flash) and no corrupted data;
+//   - a reading only comes out again if power was cut before its batch was
+//     marked sent, and readings never come out of thin air;
+//   - each cycle mounts with the next boot number, and every reading comes
+//     out with the boot it was appended in.
+//
+// At the end the log is drained and the flash bytes written per reading
+// and the erase count spread over the sectors are reported.
+//
+// Build:  g++ -std=gnu++17 -O2 -Iinclude tools/reading_log_soak/reading_log_soak.cpp src/reading_log.cpp src/reading_codec.cpp src/hal_native.cpp -o reading_log_soak
+// Usage:  reading_log_soak [--cycles N] [--seed N] [--sectors 4..64] [--image PATH]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+#include <vector>
+#include "config.h"
+#include "hal_native.h"
+#include "reading_log.h"
+
+#define SOAK_SECTOR_SIZE 4096
+
+struct Model {
+    std::set<uint32_t> durable;     // On flash and not yet consumed
+    std::set<uint32_t> maybe;       // Outcome unknown after a power cut
+    std::vector<uint32_t> buffered; // Appended, still in the log's RAM buffer
+    std::vector<uint32_t> bootOf;   // Boot each id was appended in
+    uint32_t lastConsumed;
+    uint32_t nextId;
+    uint64_t delivered;
+    uint64_t uncertain;
+    uint64_t failures;
+};
+
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Bin weight derived from the id, kept small enough for float to hold grams
+static float weightFor(uint32_t id) {
+    return (id % 100000) * 0.001f;
+}
+
+static void fail(Model& model, const char* what, uint32_t id) {
+    if (model.failures++ < 10) {
+        fprintf(stderr, "FAIL: %s (id %u)\n", what, id);
+    }
+}
+
+// Readings the log no longer holds in RAM have reached flash. After a cut
+// nothing in the buffer is known: a flush may have been partway through
+static void settleBuffered(Model& model, ReadingLog& log, bool powerLost) {
+    size_t flushed = powerLost ? 0 : model.buffered.size() - log.getBufferedCount();
+    for (size_t i = 0; i < model.buffered.size(); i++) {
+        if (i < flushed) {
+            model.durable.insert(model.buffered[i]);
+        } else if (powerLost) {
+            model.maybe.insert(model.buffered[i]);
+        }
+    }
+    model.buffered.erase(model.buffered.begin(), powerLost ? model.buffered.end() : model.buffered.begin() + flushed);
+}
+
+// Check one peek against the model; returns false if power went away
+static bool drainOnce(Model& model, ReadingLog& log, FileFlashDevice& flash) {
+    static SensorReading out[MAX_BUFFERED_READINGS];
+    uint32_t boot;
+    int count = log.peek(out, MAX_BUFFERED_READINGS, boot);
+    if (!flash.isPowered()) {
+        return false;
+    }
+
+    uint32_t previous = model.lastConsumed;
+    for (int i = 0; i < count; i++) {
+        uint32_t id = out[i].timestamp;
+        if (id <= previous) {
+            fail(model, "reading out of order or repeated", id);
+        } else if (!model.durable.count(id) && !model.maybe.count(id)) {
+            fail(model, "reading that was never durable", id);
+        } else {
+            std::set<uint32_t>::iterator skipped = model.durable.upper_bound(previous);
+            if (skipped != model.durable.end() && *skipped < id) {
+                fail(model, "durable reading skipped", *skipped);
+            }
+        }
+        // Weights come back rounded to the codec resolution
+        if (out[i].bin_id != (int)(id % 32) || fabsf(out[i].weight - weightFor(id)) > 0.0005f) {
+            fail(model, "reading data corrupted", id);
+        }
+        if (id < model.bootOf.size() && model.bootOf[id] != boot) {
+            fail(model, "reading returned with the wrong boot", id);
+        }
+        if (model.maybe.count(id) && !model.durable.count(id)) {
+            model.uncertain++;
+        }
+        previous = id;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    bool consumed = log.consume();
+    if (!flash.isPowered() || !consumed) {
+        // Some of the batches may have been marked; any may come back
+        for (int i = 0; i < count; i++) {
+            if (model.durable.erase(out[i].timestamp)) {
+                model.maybe.insert(out[i].timestamp);
+            }
+        }
+        return flash.isPowered();
+    }
+
+    model.delivered += count;
+    model.lastConsumed = previous;
+    model.durable.erase(model.durable.begin(), model.durable.upper_bound(previous));
+    model.maybe.erase(model.maybe.begin(), model.maybe.upper_bound(previous));
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t cycles = 2000;
+    uint32_t seed = 1;
+    uint32_t sectors = 16;
+    const char* image = "reading_log_soak.img";
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--cycles") == 0) cycles = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--seed") == 0) seed = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--sectors") == 0) sectors = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--image") == 0) image = value;
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        i++;
+    }
+    // Fewer sectors than this and the random backlog outgrows the ring
+    if (sectors < 4 || sectors > READING_LOG_MAX_SECTORS) {
+        fprintf(stderr, "--sectors must be 4..%d\n", READING_LOG_MAX_SECTORS);
+        return 1;
+    }
+
+    remove(image);
+    FileFlashDevice flash(image, sectors * SOAK_SECTOR_SIZE, SOAK_SECTOR_SIZE);
+    VirtualClock clock;
+    uint32_t rng = seed ? seed : 1;
+
+    Model model;
+    model.lastConsumed = 0;
+    model.nextId = 1;
+    model.delivered = 0;
+    model.uncertain = 0;
+    model.failures = 0;
+    model.bootOf.push_back(0);      // Ids start at 1
+
+    uint32_t cuts = 0;
+    uint32_t dropped = 0;
+    for (uint32_t cycle = 0; cycle < cycles; cycle++) {
+        // Reboot: a fresh log object over the same flash
+        flash.restorePower();
+        ReadingLog log(flash, clock);
+        if (!log.mount(cycle + 1)) {
+            fprintf(stderr, "Mount failed in cycle %u\n", cycle);
+            return 1;
+        }
+        model.buffered.clear();
+        flash.cutPowerAfter(nextRandom(rng) % 40000);
+
+        while (flash.isPowered()) {
+            uint32_t op = nextRandom(rng) % 100;
+            uint32_t droppedBefore = log.getDroppedCount();
+            if (op < 60) {
+                SensorReading readings[12];
+                int count = 1 + nextRandom(rng) % 12;
+                for (int i = 0; i < count; i++) {
+                    uint32_t id = model.nextId++;
+                    readings[i].bin_id = id % 32;
+                    readings[i].weight = weightFor(id);
+                    readings[i].timestamp = id;
+                    readings[i].valid = true;
+                    model.buffered.push_back(id);
+                    model.bootOf.push_back(cycle + 1);
+                }
+                clock.advanceMicros(1000000);
+                log.append(readings, count);
+                log.service();
+            } else if (op < 70) {
+                log.flush();
+            } else {
+                settleBuffered(model, log, !flash.isPowered());
+                if (!drainOnce(model, log, flash)) {
+                    break;
+                }
+                continue;
+            }
+            settleBuffered(model, log, !flash.isPowered());
+
+            // Readings turned away after the cut do not count; a full ring does
+            if (flash.isPowered()) {
+                dropped += log.getDroppedCount() - droppedBefore;
+            }
+        }
+        cuts++;
+    }
+
+    // Final reboot without a cut: everything durable must come out
+    flash.restorePower();
+    ReadingLog log(flash, clock);
+    log.mount(cycles + 1);
+    while (!log.isEmpty()) {
+        log.flush();
+        uint64_t before = model.delivered;
+        drainOnce(model, log, flash);
+        if (model.delivered == before) break;
+    }
+    if (!model.durable.empty()) {
+        fail(model, "durable readings never delivered", *model.durable.begin());
+    }
+    dropped += log.getDroppedCount();
+    if (dropped > 0) {
+        fail(model, "readings dropped by a full log", dropped);
+    }
+
+    uint32_t minErase = 0xFFFFFFFF;
+    uint32_t maxErase = 0;
+    uint64_t totalErase = 0;
+    for (uint32_t s = 0; s < sectors; s++) {
+        uint32_t erases = flash.getEraseCount(s);
+        if (erases < minErase) minErase = erases;
+        if (erases > maxErase) maxErase = erases;
+        totalErase += erases;
+    }
+
+    printf("cycles: %u (%u power cuts), readings: %u appended, %llu delivered, %llu of them from cut operations\n",
+           cycles, cuts, model.nextId - 1, (unsigned long long)model.delivered,
+           (unsigned long long)model.uncertain);
+    printf("flash: %llu bytes written (%.2f per delivered reading), erases per sector %u..%u (mean %.1f)\n",
+           (unsigned long long)flash.getBytesWritten(),
+           model.delivered ? (double)flash.getBytesWritten() / model.delivered : 0.0,
+           minErase, maxErase, (double)totalErase / sectors);
+    printf("%s\n", model.failures ? "FAILED" : "OK");
+    remove(image);
+    return model.failures ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+// Host replay of raw HX711 traces recorded by the firmware (see sample_trace.h).
+//
+// Feeds every conversion through the same SampleProcessor the device uses and
+// prints the published readings as CSV, then a timing summary on stderr.
+// With --events the valid readings also go through the WeightEventDetector
+// and the detected deposits/removals/collections are printed instead.
+// Input is either the binary trace file or a serial log containing the
+// TRACE BEGIN/END hex dump produced by the trace_dump BLE command.
+//
+// Build:  g++ -std=c++11 -O2 -Iinclude tools/trace_replay/trace_replay.cpp src/sample_processor.cpp src/weight_event_detector.cpp -o trace_replay
+// Usage:  trace_replay <trace> [--quiet] [--events] [--repeat N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "sample_trace.h"
+#include "sample_processor.h"
+#include "weight_event_detector.h"
+
+static bool loadFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(f);
+    return true;
+}
+
+// Extract the bytes between "TRACE BEGIN" and "TRACE END" of a serial log
+static bool decodeHexDump(const std::vector<uint8_t>& text, std::vector<uint8_t>& data) {
+    std::string log(text.begin(), text.end());
+    size_t begin = log.find("TRACE BEGIN");
+    size_t end = log.find("TRACE END", begin);
+    if (begin == std::string::npos || end == std::string::npos) return false;
+
+    begin = log.find('\n', begin);
+    int high = -1;
+    for (size_t i = begin; i < end; i++) {
+        char c = log[i];
+        int nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else continue;
+
+        if (high < 0) {
+            high = nibble;
+        } else {
+            data.push_back((uint8_t)((high << 4) | nibble));
+            high = -1;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <trace> [--quiet] [--events] [--repeat N]\n", argv[0]);
+        return 2;
+    }
+
+    bool quiet = false;
+    bool events = false;
+    int repeat = 1;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--events") == 0) {
+            events = true;
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+            if (repeat < 1) repeat = 1;
+        }
+    }
+
+    std::vector<uint8_t> raw;
+    if (!loadFile(argv[1], raw)) {
+        fprintf(stderr, "Cannot read %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<uint8_t> trace;
+    if (raw.size() >= 4 && memcmp(raw.data(), SAMPLE_TRACE_MAGIC, 4) == 0) {
+        trace.swap(raw);
+    } else if (!decodeHexDump(raw, trace)) {
+        fprintf(stderr, "%s is neither a trace file nor a log with a trace dump\n", argv[1]);
+        return 1;
+    }
+
+    // Version 1 traces have a shorter header
+    SampleTraceHeader header;
+    size_t headerSize = trace.size() >= 6 ? traceHeaderSize((uint16_t)(trace[4] | (trace[5] << 8))) : 0;
+    if (headerSize <= 12 || trace.size() < headerSize || !decodeTraceHeader(trace.data(), header)) {
+        fprintf(stderr, "Invalid or unsupported trace header\n");
+        return 1;
+    }
+
+    size_t recordCount = (trace.size() - headerSize) / SAMPLE_TRACE_RECORD_SIZE;
+    const uint8_t* records = trace.data() + headerSize;
+
+    if (quiet) {
+        // Nothing on stdout
+    } else if (events) {
+        printf("start_ms,settled_ms,bin_id,type,before_kg,after_kg,delta_kg\n");
+    } else {
+        printf("timestamp_ms,bin_id,filtered_raw,weight_kg,valid\n");
+    }
+
+    uint32_t firstMs = 0;
+    uint32_t lastMs = 0;
+    size_t readingCount = 0;
+    size_t invalidCount = 0;
+    size_t rejectedCounts[SAMPLE_TRACE_MAX_BINS] = {0};
+    size_t eventCount = 0;
+
+    auto started = std::chrono::steady_clock::now();
+
+    for (int pass = 0; pass < repeat; pass++) {
+        SampleProcessor processors[SAMPLE_TRACE_MAX_BINS];
+        WeightEventDetector detectors[SAMPLE_TRACE_MAX_BINS];
+        bool emit = !quiet && pass == 0;
+
+        for (size_t i = 0; i < recordCount; i++) {
+            SampleTraceRecord record;
+            decodeTraceRecord(records + i * SAMPLE_TRACE_RECORD_SIZE, record);
+            if (record.binId >= header.binCount) continue;
+
+            if (i == 0) firstMs = record.timestampMs;
+            lastMs = record.timestampMs;
+
+            int32_t filtered;
+            bool due = processors[record.binId].addConversion(record.raw, filtered);
+            if (processors[record.binId].lastRejected()) rejectedCounts[record.binId]++;
+            if (!due) continue;
+
+            float weight = SampleProcessor::toWeight(filtered, header.offsets[record.binId], header.scales[record.binId]);
+            bool valid = SampleProcessor::isValidWeight(weight);
+
+            readingCount++;
+            if (!valid) invalidCount++;
+
+            if (emit && !events) {
+                printf("%u,%u,%d,%.4f,%d\n", record.timestampMs, record.binId, filtered, weight, valid ? 1 : 0);
+            }
+
+            WeightEvent event;
+            if (events && valid && detectors[record.binId].addReading(weight, record.timestampMs, event)) {
+                eventCount++;
+                if (emit) {
+                    printf("%u,%u,%u,%s,%.3f,%.3f,%.3f\n", event.startMs, event.settledMs, record.binId,
+                           WeightEventDetector::typeName(event.type), event.beforeKg, event.afterKg,
+                           event.afterKg - event.beforeKg);
+                }
+            }
+        }
+    }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    double traceSeconds = (lastMs - firstMs) / 1000.0;
+    double samples = (double)recordCount * repeat;
+
+    fprintf(stderr, "records: %zu, bins: %u, trace duration: %.1f s, passes: %d\n",
+            recordCount, header.binCount, traceSeconds, repeat);
+    fprintf(stderr, "readings: %zu (%zu invalid)\n", readingCount / repeat, invalidCount / repeat);
+    if (events) {
+        fprintf(stderr, "events: %zu\n", eventCount / repeat);
+    }
+    fprintf(stderr, "outliers rejected:");
+    for (int b = 0; b < header.binCount; b++) {
+        fprintf(stderr, " bin%d %zu", b, rejectedCounts[b] / repeat);
+    }
+    fprintf(stderr, "\n");
+    fprintf(stderr, "replay: %.3f ms, %.1f ns/sample, %.0fx real time\n",
+            wallSeconds * 1000.0, samples > 0 ? wallSeconds * 1e9 / samples : 0.0,
+            wallSeconds > 0 ? traceSeconds * repeat / wallSeconds : 0.0);
+    return 0;
+}